@@ -5,15 +5,73 @@
 #include <SDL2/SDL_image.h>
 #include <vector>
 #include <ctime>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include "board.h"
+#include "hamilton.h"
+#include "mcts.h"
+#include "policy.h"
+#include "heuristic.h"
+#include "foodfield.h"
+#include "obstacles.h"
+#include "timerwheel.h"
+#include "particles.h"
+#include "maze.h"
+#include "world.h"
+#include "camera.h"
+#include "levels.h"
+#include "filewatch.h"
+#include "distfield.h"
+#include "pacer.h"
+#include "triplebuffer.h"
+#include "input.h"
+#include "difficulty.h"
 
 using namespace std;
 
 const int SCREEN_WIDTH = 800;
 const int SCREEN_HEIGHT = 600;
 const int CELL_SIZE = 20;
-
-enum class Direction { UP, DOWN, LEFT, RIGHT };
+const int GRID_WIDTH = SCREEN_WIDTH / CELL_SIZE;
+const int GRID_HEIGHT = SCREEN_HEIGHT / CELL_SIZE;
+const int FOOD_FIELD_ITEMS = 60;
+const int TIMED_FOOD_TICKS = 50;
+const int OBSTACLE_PERIOD = 2;
+const int POWERUP_TICKS = 80;
+const int POWERUP_EFFECT_TICKS = 50;
+const int POWERUP_RESPAWN_TICKS = 100;
+const int PARTICLE_CAPACITY = 20000;
+// Per maze style; tuned so the 40x30 board stays playable.
+const float MAZE_DENSITY[MAZE_STYLES] = { 0.5f, 0.4f, 0.3f };
+// A generated maze or scatter of movers the reference bots lose more than
+// FAIR_MAX_EARLY of short games on is drawn again, up to FAIR_TRIES times.
+// Boards past FIELD_MAX_CELLS are too big to check on the spot.
+const int FAIR_TRIES = 8;
+// Endless mode keeps chunks this many chunks around the head requested and
+// never evicts them; beyond that, at most WORLD_BUDGET bytes of chunks.
+const int WORLD_PREFETCH = 2;
+const size_t WORLD_BUDGET = 1 << 20;
+const int ENDLESS_FOOD_RANGE = 12;
+// Board sizes in cells the b key cycles through; only the first fits the
+// window, the others scroll and show a minimap of at most MINIMAP_WIDTH x
+// MINIMAP_HEIGHT pixels.
+const int BOARD_SIZES[][2] = { { GRID_WIDTH, GRID_HEIGHT }, { 400, 300 }, { 2000, 1500 } };
+const int BOARD_SIZE_COUNT = 3;
+const int MINIMAP_WIDTH = 200;
+const int MINIMAP_HEIGHT = 150;
+// Rows of level names on one page of the level menu.
+const int LEVELS_PER_PAGE = 6;
+// Each point scored takes 1% off the level's tick, down to MIN_TICK_MS.
+const double TICK_RAMP = 0.99;
+const double MIN_TICK_MS = 4;
 enum GameState { MENU, LEVEL_MENU, PLAYING, PAUSED, GAME_OVER, EXIT };
+enum PilotMode { PILOT_MANUAL, PILOT_HAMILTON, PILOT_MCTS, PILOT_NEURAL, PILOT_HEURISTIC };
+enum TimerKind { TIMER_BONUS_EXPIRES, TIMER_POWERUP_SPAWN, TIMER_POWERUP_EXPIRES, TIMER_EFFECT_ENDS };
+enum PowerUpType { POWERUP_SPEED, POWERUP_GHOST, POWERUP_SHRINK, POWERUP_NONE };
 
 struct SnakeSegment {
     int x, y;
@@ -29,17 +87,149 @@ struct Obstacle {
     Direction direction;
 };
 
+struct PowerUp {
+    int x, y;
+    PowerUpType type;
+};
+
+// A file the watcher thread has loaded, waiting for applyReloads() to swap
+// it in between frames. Exactly one of the resources is set.
+struct Reload {
+    std::string name;
+    SDL_Surface* surface = nullptr;
+    Mix_Chunk* chunk = nullptr;
+    std::string fontBytes;
+    std::unique_ptr<LevelCatalog> levels;
+};
+
+// What a Frame draws with; the textures themselves belong to the render
+// thread.
+enum FrameTexture { TEXTURE_NONE, TEXTURE_BACKGROUND, TEXTURE_SNAKE, TEXTURE_FRUIT, TEXTURE_BONUS_FRUIT, TEXTURE_OBSTACLE, TEXTURE_MINIMAP };
+
+// COPY draws `texture` over `rect` at color.a opacity; FILL and OUTLINE draw
+// `rect` in `color`; GEOMETRY draws `count` quads of Frame::vertices from
+// quad `first`, with `texture` or plain; TEXT writes `count` characters of
+// Frame::text from `first` at rect.x, rect.y.
+struct DrawCommand {
+    enum Kind { COPY, FILL, OUTLINE, GEOMETRY, TEXT } kind;
+    FrameTexture texture;
+    SDL_Rect rect;
+    SDL_Color color;
+    int first, count;
+};
+
+// Milliseconds per frame a thread spends: simulation thread on events and
+// ticks, then building the frame; render thread drawing, then presenting.
+struct ThreadTiming {
+    double busyMs = 0;
+    double extraMs = 0;
+    double intervalMs = 0;
+    double lateMs = 0;
+};
+
+// One frame of the game as render() lays it out. The simulation thread
+// writes it, the render thread draws it and never looks at the game state
+// itself.
+struct Frame {
+    uint64_t sequence = 0;
+    std::vector<DrawCommand> commands;
+    std::vector<SDL_Vertex> vertices;
+    std::string text;
+    // Minimap size, 0 when there is none, and the rectangle of it changed
+    // since the last frame the render thread uploaded, rows packed.
+    int minimapWidth = 0, minimapHeight = 0;
+    SDL_Rect minimapDirty = { 0, 0, 0, 0 };
+    std::vector<uint32_t> minimapPixels;
+    // The timing overlay, which the render thread finishes with its own.
+    bool showTiming = false;
+    double tickMs = 0;
+    int ticksPerSecond = 0;
+    double tickJitterMs = 0, tickJitterWorstMs = 0;
+    double inputMs = 0, inputWorstMs = 0;
+    ThreadTiming sim;
+};
+
+// An event as the input thread took it from SDL, with the performance
+// counter reading of when that was.
+struct InputEvent {
+    SDL_Event event;
+    Uint64 stamp;
+};
+
+// TickPacer's clock: the performance counter, and SDL_Delay to sleep.
+struct SdlClock {
+    uint64_t now() const { return SDL_GetPerformanceCounter(); }
+    uint64_t frequency() const { return SDL_GetPerformanceFrequency(); }
+    void sleepMs(uint32_t ms) const { SDL_Delay(ms); }
+};
+
 void initSDL();
 void closeSDL();
 void generateFood(bool isBonus = false);
 void render();
 void handleEvents();
+void simLoop();
+void queueTurn(Direction turn, Uint64 stamp);
 void update();
 bool checkCollision(int x, int y);
 void gameOver();
 void resetGame(bool showMenu);
 void renderText(const std::string& message, int x, int y, SDL_Color color);
 void generateObstacles();
+void buildCycle();
+void attachFields();
+bool fairFood(int x, int y, bool isBonus);
+void generateMazeLevel();
+bool fairLayout(const Layout& candidate);
+Direction autopilotDirection();
+void captureGame(Game& game);
+void togglePilot(PilotMode mode);
+void fillFoodField();
+void renderFoodField();
+void toggleFoodField();
+void moveObstacles();
+void onTimer(int kind, int data);
+void spawnPowerUp();
+void applyPowerUp(PowerUpType type);
+bool pushSnake(Direction d);
+void spawnParticles(int x, int y, int n, float speed, uint32_t rgb);
+void renderParticles();
+void toggleEndless();
+void updateView(int headX, int headY);
+bool endlessFreeCell(int& x, int& y);
+int viewCell(int pixel);
+void renderWorld();
+void renderBoard();
+void renderMinimap();
+void occupy(const SnakeSegment& segment, int delta);
+void popTail();
+void toggleWrap();
+void loadLevels();
+bool openLevels(LevelCatalog& catalog, const std::string& name, std::string& error);
+void startHotReload();
+void loadReload(const std::string& name);
+void applyReloads(bool renderSide);
+void dropReloads();
+void startLevel(int index);
+bool boardScrolls();
+bool windowSizedBoard();
+SDL_Rect levelMenuRow(int row);
+std::string levelMenuLabel(int row);
+int screenX(int x);
+int screenY(int y);
+double tickInterval();
+SnakeSegment drawnAt(const SnakeSegment& from, const SnakeSegment& to);
+void pushCopy(FrameTexture texture, const SDL_Rect& rect, Uint8 alpha = 255);
+void pushFill(const SDL_Rect& rect, SDL_Color color);
+void pushOutline(const SDL_Rect& rect, SDL_Color color);
+Uint8 snakeAlpha();
+void renderLoop();
+void initRenderer();
+void closeRenderer();
+void drawFrame(const Frame& f);
+void drawTiming(const Frame& f, const ThreadTiming& t, int skipped);
+void drawText(const std::string& message, int x, int y, SDL_Color color);
+void timeFrame(ThreadTiming& t, Uint64 start, Uint64 middle, Uint64 end, const TickStats& pacing);
 
 SDL_Window* window = nullptr;
 SDL_Renderer* renderer = nullptr;
@@ -53,6 +243,7 @@ SDL_Texture* snakeBodyTexture = nullptr;
 SDL_Texture* fruitTexture = nullptr;
 SDL_Texture* bonusFruitTexture = nullptr;
 SDL_Texture* obstacleTexture = nullptr;
+SDL_Texture* minimapTexture = nullptr;
 
 std::vector<SnakeSegment> snake;
 std::vector<Obstacle> obstacles;
@@ -60,27 +251,240 @@ Food food;
 Direction snakeDirection = Direction::RIGHT;
 GameState gameState = MENU;
 int score = 0;
-int level = 1;
-bool quit = false;
+// Index into `levels`.
+int level = 0;
+// Set by the simulation thread on q or a closed window; the input thread
+// stops pumping events and the other two follow.
+std::atomic<bool> quit(false);
+bool boardComplete = false;
+PilotMode pilotMode = PILOT_MANUAL;
+Layout levelLayout;
+HamiltonCycle cycle;
+HamiltonPilot pilot;
+MctsPlayer mctsPlayer;
+Game pilotGame;
+Policy policy;
+HeuristicBot heuristicBot;
+bool foodFieldMode = false;
+FoodField foodField;
+Rng fieldRng;
+int tickCount = 0;
+MovingObstacles movingObstacles;
+TimerWheel timers;
+TimerWheel::TimerId bonusTimer = 0;
+TimerWheel::TimerId powerUpTimer = 0;
+TimerWheel::TimerId speedTimer = 0;
+TimerWheel::TimerId ghostTimer = 0;
+PowerUp powerUp = { 0, 0, POWERUP_NONE };
+ParticlePool particles(PARTICLE_CAPACITY);
+Rng particleRng;
+MazeStyle mazeStyle = MAZE_DIVISION;
+uint64_t levelSeed = 0;
+bool fixedSeed = false;
+bool endlessMode = false;
+ChunkWorld world;
+// Pixel offset of the top-left corner of the window on the board.
+int viewX = 0, viewY = 0;
+int boardSize = 0;
+int boardWidth = GRID_WIDTH, boardHeight = GRID_HEIGHT;
+// Snake segments on each cell of a bounded board (a ghost snake can cross
+// itself), kept in step with `snake` by occupy() and popTail().
+std::vector<uint16_t> snakeCells;
+Minimap minimap;
+// Leaving the board on one edge re-enters it on the opposite one.
+bool wrapMode = false;
+// levels.bin, or levels.txt compiled at startup if that is missing or invalid.
+LevelCatalog levels;
+int levelPage = 0;
+FileWatcher assetWatcher;
+// Distance tables for the static walls of each layout played, kept across
+// runs in fields.cache; see attachFields().
+FieldCache fieldCache;
+// Loaded by the watcher thread, taken by applyReloads(); under reloadMutex.
+std::mutex reloadMutex;
+std::vector<Reload> reloads;
+// What `font` reads from once it has been reloaded; TTF keeps reading the
+// file as it renders new glyphs.
+std::string fontBytes;
+// The simulation thread runs a frame per display refresh, paced by
+// framePacer; the render thread keeps to the display by vsync, or its own
+// pacer when the renderer has none. F3 shows both threads' timings and the
+// input latency.
+TickPacer<SdlClock> framePacer;
+bool showTiming = false;
+double frameMs = 1000.0 / 60;
+// render() fills frames.back() (through `frame`) and publishes it; the
+// render thread draws frames.front(). Neither ever waits for the other.
+TripleBuffer<Frame> frames;
+Frame* frame = nullptr;
+ThreadTiming simTiming;
+std::thread simThread;
+std::thread renderThread;
+std::atomic<bool> renderQuit(false);
+// Render thread only: vsync granted, the quad index buffer shared by every
+// GEOMETRY command (it only ever grows), and the minimap texture's size.
+bool vsync = false;
+std::vector<int> quadIndices;
+int minimapTextureWidth = 0, minimapTextureHeight = 0;
+// The last frame whose minimap changes the render thread uploaded, and the
+// changes taken from `minimap` since, by the frame they were taken in; see
+// renderMinimap().
+std::atomic<uint64_t> minimapUploaded(0);
+std::vector<std::pair<uint64_t, SDL_Rect>> minimapChanges;
+// Game ticks of tickInterval() taken out of the time between frames; what is
+// left over, tickAlpha of a tick, is how far render() draws the snake from
+// where it was before the last tick (head and tail at lastHead and lastTail)
+// towards where it is now.
+FixedStep simStep;
+double tickAlpha = 0;
+SnakeSegment lastHead = { 0, 0 }, lastTail = { 0, 0 };
+// Ticks run in the last whole second, for the timing overlay.
+int ticksPerSecond = 0;
+// How far apart consecutive ticks really ran, against the interval asked
+// for: a running mean, and the worst in the last whole second and in this
+// one. Ticks run in a batch at the start of a frame, so at short intervals
+// this is about a frame, not the pacer's lateness.
+double tickJitterMs = 0, tickJitterWorstMs = 0, tickJitterWorstNow = 0;
+Uint64 lastTickAt = 0;
+// The main thread only pumps SDL's events, which SDL wants done on the
+// thread that made the window, and hands them to the simulation thread
+// through inputEvents as they arrive; handleEvents() queues the arrow keys
+// in `turns` for update() to take one a tick. Milliseconds from a key
+// press to the tick that turned on it: a running mean, and the worst in
+// the last whole second (inputWorstMs) and in this one.
+SpscRing<InputEvent, 256> inputEvents;
+TurnQueue turns;
+double inputMs = 0, inputWorstMs = 0, inputWorstNow = 0;
+
+struct TextureAsset { const char* file; SDL_Texture** texture; };
+struct SoundAsset { const char* file; Mix_Chunk** chunk; };
+const TextureAsset TEXTURE_ASSETS[] = {
+    { "back.png", &backgroundTexture }, { "snakebody.jpg", &snakeBodyTexture }, { "fruit3.png", &fruitTexture },
+    { "bonusfruit.png", &bonusFruitTexture }, { "obstacle.jpg", &obstacleTexture },
+};
+const SoundAsset SOUND_ASSETS[] = {
+    { "eating-sound-effect-36186.mp3", &eatSound }, { "gameover.mp3", &gameoverSound },
+    { "bonus_eat.mp3", &bonusSound }, { "bonus.mp3", &bonusAppearSound },
+};
+const char* FONT_FILE = "font.ttf";
+const int FONT_SIZE = 28;
+
+int cellOf(int x, int y) {
+    return (y / CELL_SIZE) * boardWidth + x / CELL_SIZE;
+}
 
 int main(int argc, char* argv[]) {
     srand(static_cast<unsigned>(time(0)));
+    // "--seed N" replays the maze layout printed by an earlier game.
+    if (argc > 2 && std::string(argv[1]) == "--seed") {
+        levelSeed = strtoull(argv[2], nullptr, 10);
+        fixedSeed = true;
+    }
+    fieldRng = Rng(static_cast<uint64_t>(time(0)));
+    particleRng = Rng(static_cast<uint64_t>(time(0)) + 1);
     initSDL();
+    if (policy.load("policy.bin") && (policy.width != GRID_WIDTH || policy.height != GRID_HEIGHT)) {
+        cout << "policy.bin is for a " << policy.width << "x" << policy.height << " board, ignoring it" << endl;
+        policy = Policy();
+    }
+    heuristicBot.load("bot_weights.txt");
+    loadLevels();
+    startHotReload();
+    fieldCache.open("fields.cache");
+    world.start(max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1));
     resetGame(true);
 
+    renderThread = std::thread(renderLoop);
+    simThread = std::thread(simLoop);
+    while (!quit) {
+        SDL_Event e;
+        if (SDL_WaitEventTimeout(&e, 10) == 0 || (e.type != SDL_QUIT && e.type != SDL_KEYDOWN && e.type != SDL_MOUSEBUTTONDOWN)) {
+            continue;
+        }
+        // A full ring means the simulation thread is stuck in a long tick;
+        // the event waits for room rather than being lost.
+        InputEvent input = { e, SDL_GetPerformanceCounter() };
+        while (!inputEvents.push(input) && !quit) {
+            SDL_Delay(1);
+        }
+    }
+
+    simThread.join();
+    renderQuit = true;
+    renderThread.join();
+    world.stop();
+    assetWatcher.stop();
+    dropReloads();
+    closeSDL();
+    return 0;
+}
+
+// Simulation thread, until quit.
+void simLoop() {
+    // One frame per display refresh: the events the input thread has
+    // queued, as many game ticks as are due, then a Frame for the render
+    // thread. Particles move in real time, not in game ticks.
+    Uint64 lastFrame = SDL_GetPerformanceCounter();
+    Uint64 rateStart = lastFrame;
+    int ticks = 0;
+    uint64_t sequence = 0;
+    framePacer.restart();
     while (!quit) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        applyReloads(false);
         handleEvents();
+        double elapsed = static_cast<double>(start - lastFrame) / SDL_GetPerformanceFrequency();
+        lastFrame = start;
         if (gameState == PLAYING) {
-            update();
+            simStep.add(elapsed * 1000);
+            while (gameState == PLAYING && simStep.next(tickInterval())) {
+                lastHead = snake.front();
+                lastTail = snake.back();
+                Uint64 tickAt = SDL_GetPerformanceCounter();
+                if (lastTickAt != 0) {
+                    double gap = (tickAt - lastTickAt) * 1000.0 / SDL_GetPerformanceFrequency();
+                    double off = std::fabs(gap - tickInterval());
+                    tickJitterMs += (off - tickJitterMs) / 16;
+                    tickJitterWorstNow = max(tickJitterWorstNow, off);
+                }
+                lastTickAt = tickAt;
+                update();
+                ticks++;
+                // Ticks slower than a frame (an MCTS pilot thinking) slow the
+                // game down rather than the frame rate.
+                if ((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency() > frameMs) {
+                    simStep.drop();
+                }
+            }
+            tickAlpha = simStep.alpha(tickInterval());
         }
+        else {
+            // A pause or a menu is not a late tick.
+            lastTickAt = 0;
+            if (gameState != PAUSED) {
+                simStep.reset();
+            }
+        }
+        if (start - rateStart >= SDL_GetPerformanceFrequency()) {
+            ticksPerSecond = ticks;
+            ticks = 0;
+            inputWorstMs = inputWorstNow;
+            inputWorstNow = 0;
+            tickJitterWorstMs = tickJitterWorstNow;
+            tickJitterWorstNow = 0;
+            rateStart = start;
+        }
+        particles.update(static_cast<float>(elapsed), 300.0f, 1.5f);
+        Uint64 simulated = SDL_GetPerformanceCounter();
         if (gameState != EXIT) {
+            frame = &frames.back();
+            frame->sequence = ++sequence;
             render();
+            frames.publish();
         }
-        SDL_Delay(100);
+        timeFrame(simTiming, start, simulated, SDL_GetPerformanceCounter(), framePacer.stats());
+        framePacer.wait(frameMs);
     }
-
-    closeSDL();
-    return 0;
 }
 
 void initSDL() {
@@ -105,13 +509,12 @@ void initSDL() {
         exit(1);
     }
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-    if (renderer == nullptr) {
-        cout<< "Renderer could not be created! SDL Error: " << SDL_GetError() ; cout<< endl;
-        exit(1);
+    SDL_DisplayMode mode;
+    if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode) == 0 && mode.refresh_rate > 0) {
+        frameMs = 1000.0 / mode.refresh_rate;
     }
 
-    font = TTF_OpenFont("font.ttf", 28);
+    font = TTF_OpenFont(FONT_FILE, FONT_SIZE);
     if (font == nullptr) {
         cout<<  "Failed to load font! SDL_ttf Error: " << TTF_GetError() ; cout<< endl;
         exit(1);
@@ -145,6 +548,18 @@ void initSDL() {
         cout<<  "Failed to load sound effect! SDL_mixer Error: " << Mix_GetError()  ; cout<< endl;
         exit(1);
     }
+}
+
+// Render thread. SDL wants a renderer, and its textures, used only on the
+// thread that made them.
+void initRenderer() {
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    if (renderer == nullptr) {
+        cout<< "Renderer could not be created! SDL Error: " << SDL_GetError() ; cout<< endl;
+        exit(1);
+    }
+    SDL_RendererInfo rendererInfo;
+    vsync = SDL_GetRendererInfo(renderer, &rendererInfo) == 0 && (rendererInfo.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
 
     SDL_Surface* loadedSurface = IMG_Load("back.png");
     if (loadedSurface == nullptr) {
@@ -207,13 +622,17 @@ void initSDL() {
     }
 }
 
-void closeSDL() {
+void closeRenderer() {
     SDL_DestroyTexture(backgroundTexture);
     SDL_DestroyTexture(snakeBodyTexture);
     SDL_DestroyTexture(fruitTexture);
     SDL_DestroyTexture(bonusFruitTexture);
     SDL_DestroyTexture(obstacleTexture);
+    SDL_DestroyTexture(minimapTexture);
     SDL_DestroyRenderer(renderer);
+}
+
+void closeSDL() {
     SDL_DestroyWindow(window);
     Mix_FreeChunk(eatSound);
     Mix_FreeChunk(gameoverSound);
@@ -226,39 +645,78 @@ void closeSDL() {
     SDL_Quit();
 }
 
+bool foodAllowed(int x, int y) {
+    if (endlessMode && world.cell(x / CELL_SIZE, y / CELL_SIZE) != CELL_OPEN) {
+        return false;
+    }
+    if (!endlessMode && levelLayout.blocked[cellOf(x, y)] != CELL_OPEN) {
+        return false;
+    }
+    if (checkCollision(x, y)) {
+        return false;
+    }
+    return pilotMode != PILOT_HAMILTON || cycle.contains(cellOf(x, y));
+}
+
 void generateFood(bool isBonus) {
     bool validPosition = false;
-    while (!validPosition) {
-        validPosition = true;
-        food.x = rand() % (SCREEN_WIDTH / CELL_SIZE) * CELL_SIZE;
-        food.y = rand() % (SCREEN_HEIGHT / CELL_SIZE) * CELL_SIZE;
-        
-        for (const auto &obstacle : obstacles) {
-            if (food.x == obstacle.x && food.y == obstacle.y) {
-                validPosition = false;
-                break;
-            }
+    if (endlessMode) {
+        if (!endlessFreeCell(food.x, food.y)) {
+            // Nothing free nearby; leave the food where it is.
+            return;
         }
+        validPosition = true;
+    }
+    for (int tries = 0; tries < 64 && !validPosition; tries++) {
+        food.x = rand() % boardWidth * CELL_SIZE;
+        food.y = rand() % boardHeight * CELL_SIZE;
+        validPosition = foodAllowed(food.x, food.y) && fairFood(food.x, food.y, isBonus);
+    }
 
-        for (const auto& segment : snake) {
-            if (food.x == segment.x && food.y == segment.y) {
-                validPosition = false;
-                break;
+    if (!validPosition) {
+        vector<int> freeCells;
+        for (int c = 0; c < levelLayout.cells(); c++) {
+            if (levelLayout.blocked[c] == CELL_OPEN && snakeCells[c] == 0 && (pilotMode != PILOT_HAMILTON || cycle.contains(c))) {
+                freeCells.push_back(c);
             }
         }
+        if (freeCells.empty()) {
+            boardComplete = true;
+            gameOver();
+            return;
+        }
+        int c = freeCells[rand() % freeCells.size()];
+        food.x = c % boardWidth * CELL_SIZE;
+        food.y = c / boardWidth * CELL_SIZE;
     }
+
+    // Bonus food only stays for a while; see onTimer().
     food.isBonus = isBonus;
+    timers.cancel(bonusTimer);
+    bonusTimer = isBonus ? timers.schedule(static_cast<int>(levels.level(level).bonusTicks), TIMER_BONUS_EXPIRES) : 0;
     if (isBonus) {
         Mix_PlayChannel(-1, bonusAppearSound, 0); 
+        spawnParticles(food.x, food.y, 40, 120.0f, 0xFFE060);
     }
 }
 
+// Lays the game out into `frame`, which the render thread puts on screen.
 void render() {
-    SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF);
-    SDL_RenderClear(renderer);
+    frame->commands.clear();
+    frame->vertices.clear();
+    frame->text.clear();
+    frame->minimapWidth = frame->minimapHeight = 0;
+    frame->showTiming = showTiming;
+    frame->tickMs = tickInterval();
+    frame->ticksPerSecond = ticksPerSecond;
+    frame->tickJitterMs = tickJitterMs;
+    frame->tickJitterWorstMs = tickJitterWorstMs;
+    frame->inputMs = inputMs;
+    frame->inputWorstMs = inputWorstMs;
+    frame->sim = simTiming;
 
     SDL_Rect renderQuad = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
-    SDL_RenderCopy(renderer, backgroundTexture, NULL, &renderQuad);
+    pushCopy(TEXTURE_BACKGROUND, renderQuad);
 
     if (gameState == MENU) {
         renderText(" Snake Game ", SCREEN_WIDTH / 2 - 85, SCREEN_HEIGHT / 2 - 100,{255, 255, 153, 255});
@@ -266,45 +724,109 @@ void render() {
         renderText("Quit", SCREEN_WIDTH / 2 - 30, SCREEN_HEIGHT / 2 + 100,  {255, 255, 153, 255});
     }
     else if (gameState == LEVEL_MENU) {
-        renderText("Select Level", SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 - 100,  {255, 255, 153, 255});
-        renderText("1. Level 1", SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 - 50, {255, 255, 153, 255});
-        renderText("2. Level 2", SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2,  {255, 255, 153, 255});
-        renderText("Main Menu", SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 + 100,  {255, 255, 153, 255});
+        renderText("Select Level", SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 - 210,  {255, 255, 153, 255});
+        for (int row = 0; row < LEVELS_PER_PAGE + 2; row++) {
+            std::string label = levelMenuLabel(row);
+            if (!label.empty()) {
+                SDL_Rect r = levelMenuRow(row);
+                renderText(label, r.x, r.y, {255, 255, 153, 255});
+            }
+        }
     }
     else if (gameState == PLAYING) {
-        for (const auto &segment : snake) {
-            SDL_Rect fillRect = { segment.x, segment.y, CELL_SIZE, CELL_SIZE };
-            SDL_RenderCopy(renderer, snakeBodyTexture, NULL, &fillRect);
+        // Between ticks only the head and the tail move: the head slides into
+        // its new cell, the tail out of the one it left.
+        SnakeSegment head = drawnAt(lastHead, snake.front());
+        SnakeSegment tail = drawnAt(lastTail, snake.back());
+        updateView(head.x, head.y);
+        if (endlessMode) {
+            renderWorld();
+            for (size_t i = 1; i < snake.size(); i++) {
+                SDL_Rect fillRect = { snake[i].x - viewX, snake[i].y - viewY, CELL_SIZE, CELL_SIZE };
+                pushCopy(TEXTURE_SNAKE, fillRect, snakeAlpha());
+            }
+        }
+        else {
+            renderBoard();
+        }
+        for (const SnakeSegment& end : { head, tail }) {
+            SDL_Rect endRect = { screenX(end.x), screenY(end.y), CELL_SIZE, CELL_SIZE };
+            pushCopy(TEXTURE_SNAKE, endRect, snakeAlpha());
         }
 
-        SDL_Rect foodRect = { food.x, food.y, CELL_SIZE, CELL_SIZE };
-        if (food.isBonus) {
-            SDL_RenderCopy(renderer, bonusFruitTexture, NULL, &foodRect);
+        if (foodFieldMode) {
+            renderFoodField();
         }
         else {
-            SDL_RenderCopy(renderer, fruitTexture, NULL, &foodRect);
+            SDL_Rect foodRect = { screenX(food.x), screenY(food.y), CELL_SIZE, CELL_SIZE };
+            if (food.isBonus) {
+                // Blinks for its last 15 ticks.
+                if (timers.remaining(bonusTimer) > 15 || tickCount % 2 == 0) {
+                    pushCopy(TEXTURE_BONUS_FRUIT, foodRect);
+                }
+            }
+            else {
+                pushCopy(TEXTURE_FRUIT, foodRect);
+            }
         }
 
-        for (const auto& obstacle : obstacles) {
-            SDL_Rect obstacleRect = { obstacle.x, obstacle.y, CELL_SIZE, CELL_SIZE };
-            SDL_RenderCopy(renderer, obstacleTexture, NULL, &obstacleRect);
+        if (powerUp.type != POWERUP_NONE) {
+            static const SDL_Color colors[] = { { 255, 140, 0, 255 }, { 150, 220, 255, 255 }, { 190, 90, 255, 255 } };
+            SDL_Rect powerUpRect = { screenX(powerUp.x) + 3, screenY(powerUp.y) + 3, CELL_SIZE - 6, CELL_SIZE - 6 };
+            pushFill(powerUpRect, colors[powerUp.type]);
+        }
+        renderMinimap();
+
+        renderText("Score: " + std::to_string(score) + (wrapMode ? "  Wrap" : ""), 10, 10,  {255, 255, 153, 255});
+        std::string effects;
+        if (timers.pending(speedTimer)) {
+            effects += "Speed " + std::to_string(timers.remaining(speedTimer)) + "  ";
+        }
+        if (timers.pending(ghostTimer)) {
+            effects += "Ghost " + std::to_string(timers.remaining(ghostTimer));
+        }
+        if (!effects.empty()) {
+            renderText(effects, 10, 40, {255, 255, 153, 255});
+        }
+        if (endlessMode) {
+            renderText("Endless  (" + std::to_string(snake.front().x / CELL_SIZE) + ", " + std::to_string(snake.front().y / CELL_SIZE) +
+                       ")  chunks " + std::to_string(world.loaded()) + " + " + std::to_string(world.pending()) + " queued",
+                       10, SCREEN_HEIGHT - 40, {255, 255, 153, 255});
+        }
+        else if (levels.level(level).mazeStyle >= 0) {
+            renderText(std::string(mazeStyleName(mazeStyle)) + " #" + std::to_string(levelSeed), 10, SCREEN_HEIGHT - 40, {255, 255, 153, 255});
+        }
+        if (pilotMode == PILOT_HAMILTON) {
+            renderText("Autopilot", SCREEN_WIDTH - 160, 10, {255, 255, 153, 255});
+        }
+        else if (pilotMode == PILOT_NEURAL) {
+            renderText("Neural", SCREEN_WIDTH - 130, 10, {255, 255, 153, 255});
+        }
+        else if (pilotMode == PILOT_HEURISTIC) {
+            renderText("Heuristic", SCREEN_WIDTH - 160, 10, {255, 255, 153, 255});
+        }
+        else if (pilotMode == PILOT_MCTS) {
+            renderText("MCTS " + std::to_string(static_cast<long long>(mctsPlayer.lastStats().playoutsPerSecond())) + " playouts/s",
+                       SCREEN_WIDTH - 420, 10, {255, 255, 153, 255});
         }
-        renderText("Score: " + std::to_string(score), 10, 10,  {255, 255, 153, 255});
     }
     else if (gameState == GAME_OVER) {
-        renderText("Game Over", SCREEN_WIDTH / 2 - 75, SCREEN_HEIGHT / 2 - 100,  {255, 255, 153, 255});
+        renderText(boardComplete ? "Board Complete" : "Game Over", SCREEN_WIDTH / 2 - 75, SCREEN_HEIGHT / 2 - 100,  {255, 255, 153, 255});
         renderText("Restart", SCREEN_WIDTH / 2 - 60, SCREEN_HEIGHT / 2,  {255, 255, 153, 255});
         renderText("Quit", SCREEN_WIDTH / 2 - 45, SCREEN_HEIGHT / 2 + 50, {255, 255, 153, 255});
         renderText("Final Score: " + std::to_string(score), SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 - 50, {255, 255, 153, 255});
         renderText("Main Menu", SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 + 100,  {255, 255, 153, 255});
     }
 
-    SDL_RenderPresent(renderer);
+    if (gameState == PLAYING || gameState == GAME_OVER) {
+        renderParticles();
+    }
 }
 
 void handleEvents() {
-    SDL_Event e;
-    while (SDL_PollEvent(&e) != 0) {
+    InputEvent input;
+    while (inputEvents.pop(input)) {
+        const SDL_Event& e = input.event;
         if (e.type == SDL_QUIT) {
             quit = true;
         } else if (e.type == SDL_KEYDOWN) {
@@ -313,16 +835,60 @@ void handleEvents() {
                     quit = true;
                     break;
                 case SDLK_UP:
-                    if (snakeDirection != Direction::DOWN) snakeDirection = Direction::UP;
+                    queueTurn(Direction::UP, input.stamp);
                     break;
                 case SDLK_DOWN:
-                    if (snakeDirection != Direction::UP) snakeDirection = Direction::DOWN;
+                    queueTurn(Direction::DOWN, input.stamp);
                     break;
                 case SDLK_LEFT:
-                    if (snakeDirection != Direction::RIGHT) snakeDirection = Direction::LEFT;
+                    queueTurn(Direction::LEFT, input.stamp);
                     break;
                 case SDLK_RIGHT:
-                    if (snakeDirection != Direction::LEFT) snakeDirection = Direction::RIGHT;
+                    queueTurn(Direction::RIGHT, input.stamp);
+                    break;
+                case SDLK_a:
+                    togglePilot(PILOT_HAMILTON);
+                    break;
+                case SDLK_m:
+                    togglePilot(PILOT_MCTS);
+                    break;
+                case SDLK_n:
+                    togglePilot(PILOT_NEURAL);
+                    break;
+                case SDLK_h:
+                    togglePilot(PILOT_HEURISTIC);
+                    break;
+                case SDLK_f:
+                    toggleFoodField();
+                    break;
+                case SDLK_e:
+                    toggleEndless();
+                    break;
+                case SDLK_w:
+                    toggleWrap();
+                    break;
+                case SDLK_b:
+                    if (!endlessMode && (gameState == PLAYING || gameState == PAUSED)) {
+                        if (levels.level(level).width != 0) {
+                            cout << levels.level(level).name << " has its own board size" << endl;
+                            break;
+                        }
+                        boardSize = (boardSize + 1) % BOARD_SIZE_COUNT;
+                        boardWidth = BOARD_SIZES[boardSize][0];
+                        boardHeight = BOARD_SIZES[boardSize][1];
+                        pilotMode = PILOT_MANUAL;
+                        cout << "Board " << boardWidth << "x" << boardHeight << endl;
+                        resetGame(false);
+                    }
+                    break;
+                case SDLK_g:
+                    if (levels.level(level).mazeStyle >= 0 && (gameState == PLAYING || gameState == PAUSED)) {
+                        mazeStyle = static_cast<MazeStyle>((mazeStyle + 1) % MAZE_STYLES);
+                        resetGame(false);
+                    }
+                    break;
+                case SDLK_F3:
+                    showTiming = !showTiming;
                     break;
                 case SDLK_p:
                     if (gameState == PLAYING) {
@@ -346,21 +912,21 @@ void handleEvents() {
                     quit = true;
                 }
             } else if (gameState == LEVEL_MENU) {
-                if (mouseX >= SCREEN_WIDTH / 2 - 150 && mouseX <= SCREEN_WIDTH / 2 + 150 &&
-                    mouseY >= SCREEN_HEIGHT / 2 - 50 && mouseY <= SCREEN_HEIGHT / 2) {
-                    level = 1;
-                    gameState = PLAYING;
-                    resetGame(false);
-                }
-                else if (mouseX >= SCREEN_WIDTH / 2 - 100 && mouseX <= SCREEN_WIDTH / 2 + 150 &&
-                         mouseY >= SCREEN_HEIGHT / 2 + 10 && mouseY <= SCREEN_HEIGHT / 2 + 60) {
-                    level = 2;
-                    gameState = PLAYING;
-                    resetGame(false);
-                }
-                else if (mouseX >= SCREEN_WIDTH / 2 - 100 && mouseX <= SCREEN_WIDTH / 2 + 150 &&
-                         mouseY >= SCREEN_HEIGHT / 2 + 100 && mouseY <= SCREEN_HEIGHT / 2 + 180) {
-                    gameState = MENU;
+                for (int row = 0; row < LEVELS_PER_PAGE + 2; row++) {
+                    SDL_Rect r = levelMenuRow(row);
+                    if (mouseX < r.x || mouseX >= r.x + r.w || mouseY < r.y || mouseY >= r.y + r.h || levelMenuLabel(row).empty()) {
+                        continue;
+                    }
+                    if (row < LEVELS_PER_PAGE) {
+                        startLevel(levelPage * LEVELS_PER_PAGE + row);
+                    }
+                    else if (row == LEVELS_PER_PAGE) {
+                        levelPage = (levelPage + 1) * LEVELS_PER_PAGE < levels.count() ? levelPage + 1 : 0;
+                    }
+                    else {
+                        gameState = MENU;
+                    }
+                    break;
                 }
             } else if (gameState == GAME_OVER) {
                 if (mouseX >= SCREEN_WIDTH / 2 - 60 && mouseX <= SCREEN_WIDTH / 2 + 120 &&
@@ -380,51 +946,124 @@ void handleEvents() {
     }
 }
 
+// Reversing is checked against the turn queued last, so up then left while
+// heading right is two turns, not a turn into the snake's own neck.
+void queueTurn(Direction turn, Uint64 stamp) {
+    turns.push(turn, snakeDirection, stamp);
+}
 
 void update() {
-    SnakeSegment newHead = snake.front();
+    tickCount++;
+    timers.advance(1, onTimer);
+    if (gameState != PLAYING) {
+        return;
+    }
+    bool ghost = timers.pending(ghostTimer);
+    if (pilotMode == PILOT_HAMILTON) {
+        snakeDirection = autopilotDirection();
+    }
+    else if (pilotMode == PILOT_MCTS) {
+        captureGame(pilotGame);
+        snakeDirection = mctsPlayer.think(pilotGame);
+    }
+    else if (pilotMode == PILOT_NEURAL) {
+        captureGame(pilotGame);
+        snakeDirection = policy.act(pilotGame);
+    }
+    else if (pilotMode == PILOT_HEURISTIC) {
+        captureGame(pilotGame);
+        snakeDirection = heuristicBot.choose(pilotGame);
+    }
+    Direction turn;
+    uint64_t stamp;
+    if (pilotMode != PILOT_MANUAL) {
+        turns.clear();
+    }
+    else if (turns.take(turn, stamp)) {
+        snakeDirection = turn;
+        double ms = (SDL_GetPerformanceCounter() - stamp) * 1000.0 / SDL_GetPerformanceFrequency();
+        inputMs += (ms - inputMs) / 16;
+        inputWorstNow = max(inputWorstNow, ms);
+    }
 
-    switch (snakeDirection) {
-        case Direction::UP:
-            newHead.y -= CELL_SIZE;
-            break;
-        case Direction::DOWN:
-            newHead.y += CELL_SIZE;
-            break;
-        case Direction::LEFT:
-            newHead.x -= CELL_SIZE;
-            break;
-        case Direction::RIGHT:
-            newHead.x += CELL_SIZE;
-            break;
+    // Indexed by Direction.
+    static const int stepX[4] = { 0, 0, -CELL_SIZE, CELL_SIZE };
+    static const int stepY[4] = { -CELL_SIZE, CELL_SIZE, 0, 0 };
+    SnakeSegment newHead = snake.front();
+    newHead.x += stepX[static_cast<int>(snakeDirection)];
+    newHead.y += stepY[static_cast<int>(snakeDirection)];
+    if (wrapMode) {
+        newHead.x = wrapCoord(newHead.x, boardWidth * CELL_SIZE);
+        newHead.y = wrapCoord(newHead.y, boardHeight * CELL_SIZE);
     }
 
-    if (newHead.x < 0 || newHead.x >= SCREEN_WIDTH || newHead.y < 0 || newHead.y >= SCREEN_HEIGHT || checkCollision(newHead.x, newHead.y)) {
+    bool blocked;
+    if (endlessMode) {
+        // The board has no edge, only chunks that may still be generating:
+        // the snake waits a tick rather than the loop waiting for a worker.
+        int headX = snake.front().x / CELL_SIZE, headY = snake.front().y / CELL_SIZE;
+        world.poll();
+        world.request(headX, headY, WORLD_PREFETCH);
+        world.evict(headX, headY, WORLD_PREFETCH);
+        uint8_t ahead = world.cell(newHead.x / CELL_SIZE, newHead.y / CELL_SIZE);
+        if (ahead == CELL_UNLOADED) {
+            return;
+        }
+        blocked = ahead != CELL_OPEN && !ghost;
+    }
+    else {
+        blocked = newHead.x < 0 || newHead.x >= boardWidth * CELL_SIZE || newHead.y < 0 || newHead.y >= boardHeight * CELL_SIZE ||
+                  (!ghost && levelLayout.blocked[cellOf(newHead.x, newHead.y)] != CELL_OPEN);
+    }
+    if (blocked || (!ghost && checkCollision(newHead.x, newHead.y))) {
         gameOver();
         return;
     }
 
     snake.insert(snake.begin(), newHead);
+    occupy(newHead, 1);
 
-    if (newHead.x == food.x && newHead.y == food.y) {
+    if (foodFieldMode) {
+        int slot = foodField.at(cellOf(newHead.x, newHead.y));
+        FoodType type = slot >= 0 ? foodField.types[slot] : FOOD_TYPES;
+        if (slot >= 0) {
+            foodField.despawn(cellOf(newHead.x, newHead.y));
+            score = max(0, score + foodPoints(type));
+            Mix_PlayChannel(-1, type == FOOD_NORMAL ? eatSound : type == FOOD_POISONED ? gameoverSound : bonusSound, 0);
+            spawnParticles(newHead.x, newHead.y, type == FOOD_BONUS ? 60 : 25, 150.0f, type == FOOD_POISONED ? 0x78FF78 : 0xFF5040);
+        }
+        if (slot < 0 || type == FOOD_POISONED) {
+            popTail();
+        }
+        // Poison also takes two more segments, never the head.
+        for (int i = 0; type == FOOD_POISONED && i < 2 && snake.size() > 1; i++) {
+            popTail();
+        }
+        foodField.expire(tickCount);
+        fillFoodField();
+    } else if (newHead.x == food.x && newHead.y == food.y) {
         score += (food.isBonus) ? 5 : 1;
         Mix_PlayChannel(-1, food.isBonus ? bonusSound : eatSound, 0);
-        generateFood(rand() % 10 == 0);
+        spawnParticles(food.x, food.y, food.isBonus ? 60 : 25, 150.0f, food.isBonus ? 0xFFE060 : 0xFF5040);
+        generateFood(rand() % 100 < static_cast<int>(levels.level(level).bonusPercent));
     } else {
-        snake.pop_back();
+        popTail();
     }
 
-    for (auto& obstacle : obstacles) {
+    if (powerUp.type != POWERUP_NONE && newHead.x == powerUp.x && newHead.y == powerUp.y) {
+        applyPowerUp(powerUp.type);
+    }
 
-        if (newHead.x == obstacle.x && newHead.y == obstacle.y) {
-            gameOver();
-            return;
-        }
+    if (!obstacles.empty() && tickCount % OBSTACLE_PERIOD == 0) {
+        moveObstacles();
     }
 }
 
 
 bool checkCollision(int x, int y) {
+    if (!endlessMode) {
+        return x >= 0 && x < boardWidth * CELL_SIZE && y >= 0 && y < boardHeight * CELL_SIZE && snakeCells[cellOf(x, y)] > 0;
+    }
     for (const auto &segment : snake) {
         if (segment.x == x && segment.y == y) {
             return true;
@@ -435,25 +1074,105 @@ bool checkCollision(int x, int y) {
 
 void gameOver() {
     Mix_PlayChannel(-1, gameoverSound, 0);
+    for (const auto& segment : snake) {
+        spawnParticles(segment.x, segment.y, 30, 220.0f, 0x40C040);
+    }
     gameState = GAME_OVER;
 }
 
 void resetGame(bool showMenu) {
     snake.clear();
-    snake.push_back({ SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 });
-    snake.push_back({ SCREEN_WIDTH / 2 - CELL_SIZE, SCREEN_HEIGHT / 2 });
-    snake.push_back({ SCREEN_WIDTH / 2 - 2 * CELL_SIZE, SCREEN_HEIGHT / 2 });
+    const LevelInfo& info = levels.level(level);
+    if (info.width != 0) {
+        boardWidth = static_cast<int>(info.width);
+        boardHeight = static_cast<int>(info.height);
+    }
+    else {
+        boardWidth = BOARD_SIZES[boardSize][0];
+        boardHeight = BOARD_SIZES[boardSize][1];
+    }
     snakeDirection = Direction::RIGHT;
+    turns.clear();
+    if (endlessMode) {
+        // Start in the middle of chunk (0, 0), which is always empty, so
+        // neither the snake nor the first food waits for a worker.
+        int start = CHUNK_SIZE / 2 * CELL_SIZE;
+        world.reset((static_cast<uint64_t>(rand()) << 32) ^ static_cast<uint64_t>(rand()), WORLD_BUDGET);
+        world.request(CHUNK_SIZE / 2, CHUNK_SIZE / 2, WORLD_PREFETCH);
+        for (int i = 0; i < 3; i++) {
+            snake.push_back({ start - i * CELL_SIZE, start });
+        }
+    }
+    else {
+        // The body trails behind the head; validate() has checked it fits.
+        int headX = info.spawnX < 0 ? boardWidth / 2 : info.spawnX;
+        int headY = info.spawnY < 0 ? boardHeight / 2 : info.spawnY;
+        snakeDirection = static_cast<Direction>(info.spawnDirection);
+        int dx = snakeDirection == Direction::LEFT ? -1 : snakeDirection == Direction::RIGHT ? 1 : 0;
+        int dy = snakeDirection == Direction::UP ? -1 : snakeDirection == Direction::DOWN ? 1 : 0;
+        for (int i = 0; i < 3; i++) {
+            snake.push_back({ (headX - i * dx) * CELL_SIZE, (headY - i * dy) * CELL_SIZE });
+        }
+    }
     score = 0;
-    obstacles.clear();
+    boardComplete = false;
     generateObstacles();
-    generateFood();
+    attachFields();
+    buildCycle();
+    // A pilot left on from the last game may not fit this one.
+    if (!windowSizedBoard() || (pilotMode == PILOT_HAMILTON && (!obstacles.empty() || cycle.length == 0))) {
+        pilotMode = PILOT_MANUAL;
+    }
+    if (!endlessMode) {
+        snakeCells.assign(levelLayout.cells(), 0);
+        minimap.reset(levelLayout, MINIMAP_WIDTH, MINIMAP_HEIGHT);
+        for (const auto& segment : snake) {
+            occupy(segment, 1);
+        }
+    }
+    lastHead = snake.front();
+    lastTail = snake.back();
+    tickCount = 0;
+    timers.reset();
+    bonusTimer = speedTimer = ghostTimer = 0;
+    powerUp.type = POWERUP_NONE;
+    powerUpTimer = timers.schedule(POWERUP_RESPAWN_TICKS + rand() % POWERUP_RESPAWN_TICKS, TIMER_POWERUP_SPAWN);
+    if (foodFieldMode) {
+        foodField.reset(boardWidth * boardHeight);
+        fillFoodField();
+    } else {
+        generateFood();
+    }
     if (showMenu) {
         gameState = MENU;
     }
 }
 
 void renderText(const std::string& message, int x, int y, SDL_Color color) {
+    frame->commands.push_back({ DrawCommand::TEXT, TEXTURE_NONE, { x, y, 0, 0 }, color, static_cast<int>(frame->text.size()),
+                                static_cast<int>(message.size()) });
+    frame->text += message;
+}
+
+void pushCopy(FrameTexture texture, const SDL_Rect& rect, Uint8 alpha) {
+    frame->commands.push_back({ DrawCommand::COPY, texture, rect, { 255, 255, 255, alpha }, 0, 0 });
+}
+
+void pushFill(const SDL_Rect& rect, SDL_Color color) {
+    frame->commands.push_back({ DrawCommand::FILL, TEXTURE_NONE, rect, color, 0, 0 });
+}
+
+void pushOutline(const SDL_Rect& rect, SDL_Color color) {
+    frame->commands.push_back({ DrawCommand::OUTLINE, TEXTURE_NONE, rect, color, 0, 0 });
+}
+
+// The ghost power-up makes the snake see-through.
+Uint8 snakeAlpha() {
+    return timers.pending(ghostTimer) ? 110 : 255;
+}
+
+// Render thread.
+void drawText(const std::string& message, int x, int y, SDL_Color color) {
     SDL_Surface* textSurface = TTF_RenderText_Solid(font, message.c_str(), color);
     SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
     SDL_Rect renderQuad = { x, y, textSurface->w, textSurface->h };
@@ -462,39 +1181,948 @@ void renderText(const std::string& message, int x, int y, SDL_Color color) {
     SDL_DestroyTexture(textTexture);
 }
 
+// The level's walls into a fresh levelLayout, its maze if it has one, then
+// its movers: those placed by the map and as many random ones per 40x30
+// cells as it asks for.
 void generateObstacles() {
-    obstacles.clear(); 
-
-    int numObstacles;
-    if (level == 1) {
-        numObstacles = 0; 
-    } 
-    if (level == 2) {
-        numObstacles = 10; 
-    }
-
-    for (int i = 0; i < numObstacles; i++) {
-        Obstacle obstacle;
-        bool validPosition = false;
-        while (!validPosition) {
-            validPosition = true;
-            obstacle.x = rand() % (SCREEN_WIDTH / CELL_SIZE) * CELL_SIZE;
-            obstacle.y = rand() % (SCREEN_HEIGHT / CELL_SIZE) * CELL_SIZE;
-
-            for (const auto &segment : snake) {
-                if (obstacle.x == segment.x && obstacle.y == segment.y) {
-                    validPosition = false;
-                    break;
+    obstacles.clear();
+    levelLayout = Layout(boardWidth, boardHeight);
+    levelLayout.wrap = wrapMode;
+    if (endlessMode) {
+        return;
+    }
+    const LevelInfo& info = levels.level(level);
+    if (info.width != 0) {
+        levels.loadWalls(level, levelLayout.blocked);
+    }
+    if (info.mazeStyle >= 0) {
+        generateMazeLevel();
+    }
+
+    vector<uint8_t> taken(levelLayout.blocked);
+    for (const auto &segment : snake) {
+        taken[cellOf(segment.x, segment.y)] = 1;
+    }
+    const LevelMover* movers = levels.movers(level);
+    for (uint32_t i = 0; i < info.moverCount; i++) {
+        obstacles.push_back({ movers[i].x * CELL_SIZE, movers[i].y * CELL_SIZE, static_cast<Direction>(movers[i].direction) });
+        taken[levelLayout.cell(movers[i].x, movers[i].y)] = 1;
+    }
+    long long numObstacles = static_cast<long long>(info.randomMovers) * (boardWidth * boardHeight) / (GRID_WIDTH * GRID_HEIGHT);
+    if (numObstacles == 0) {
+        return;
+    }
+    // The random movers are judged where they start, as walls.
+    size_t placed = obstacles.size();
+    vector<uint8_t> fixed(taken);
+    for (int attempt = 1;; attempt++) {
+        obstacles.resize(placed);
+        taken = fixed;
+        for (long long i = 0; i < numObstacles; i++) {
+            Obstacle obstacle;
+            int tries = 0;
+            do {
+                obstacle.x = rand() % boardWidth * CELL_SIZE;
+                obstacle.y = rand() % boardHeight * CELL_SIZE;
+            } while (taken[cellOf(obstacle.x, obstacle.y)] && ++tries < 1000);
+            if (tries == 1000) {
+                break;
+            }
+            taken[cellOf(obstacle.x, obstacle.y)] = 1;
+
+            obstacle.direction = static_cast<Direction>(rand() % 4);
+            obstacles.push_back(obstacle);
+        }
+        Layout candidate(levelLayout);
+        for (const auto& obstacle : obstacles) {
+            candidate.blocked[cellOf(obstacle.x, obstacle.y)] = CELL_WALL;
+        }
+        if (attempt == FAIR_TRIES || fairLayout(candidate)) {
+            return;
+        }
+    }
+}
+
+// A generated maze over the level's own walls. The cells the snake starts
+// on and the run ahead of it are cleared, which can only join regions, never
+// split them.
+// A seed given on the command line is kept whatever the check says, so the
+// level it names can always be replayed.
+void generateMazeLevel() {
+    const LevelInfo& info = levels.level(level);
+    int headX = snake.front().x / CELL_SIZE, headY = snake.front().y / CELL_SIZE;
+    int dx = snakeDirection == Direction::LEFT ? -1 : snakeDirection == Direction::RIGHT ? 1 : 0;
+    int dy = snakeDirection == Direction::UP ? -1 : snakeDirection == Direction::DOWN ? 1 : 0;
+    Layout candidate;
+    for (int attempt = 1;; attempt++) {
+        if (!fixedSeed) {
+            levelSeed = (static_cast<uint64_t>(rand()) << 32) ^ static_cast<uint64_t>(rand());
+        }
+        Layout maze(boardWidth, boardHeight);
+        generateMaze(maze, mazeStyle, mazeStyle == info.mazeStyle ? info.mazeDensity : MAZE_DENSITY[mazeStyle], levelSeed);
+        for (int i = -3; i <= 5; i++) {
+            int x = headX + i * dx, y = headY + i * dy;
+            if (x >= 0 && x < boardWidth && y >= 0 && y < boardHeight) {
+                maze.blocked[maze.cell(x, y)] = 0;
+            }
+        }
+        candidate = levelLayout;
+        for (int c = 0; c < maze.cells(); c++) {
+            candidate.blocked[c] |= maze.blocked[c] ? CELL_WALL : CELL_OPEN;
+        }
+        if (fixedSeed || attempt == FAIR_TRIES || fairLayout(candidate)) {
+            break;
+        }
+    }
+    levelLayout = candidate;
+    cout << mazeStyleName(mazeStyle) << " level, seed " << levelSeed << endl;
+}
+
+// Few enough of the reference bots' short games from the snake's start lost
+// early; estimateDifficulty() without its tables, on this thread.
+bool fairLayout(const Layout& candidate) {
+    if (candidate.cells() > FIELD_MAX_CELLS) {
+        return true;
+    }
+    SpawnPoint spawn = { cellOf(snake.front().x, snake.front().y), snakeDirection };
+    return fairStart(candidate, spawn, FAIR_MAX_EARLY, heuristicBot.weights);
+}
+
+// Called before the movers are added, so the tables only know the walls
+// that stay put. Fixed layouts are kept in fields.cache; generated mazes
+// are new every game and only kept in memory.
+void attachFields() {
+    if (endlessMode) {
+        return;
+    }
+    int threads = max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    fieldCache.get(levelLayout, levels.level(level).mazeStyle < 0, threads).attach(levelLayout);
+}
+
+// Food the snake can get to, and bonus food it can get to before it goes.
+// Without tables (large boards) any allowed cell will do.
+bool fairFood(int x, int y, bool isBonus) {
+    if (endlessMode || levelLayout.pathSteps == nullptr) {
+        return true;
+    }
+    int d = pathDistance(levelLayout, cellOf(snake.front().x, snake.front().y), cellOf(x, y));
+    return d != PATH_UNREACHABLE && (!isBonus || d < static_cast<int>(levels.level(level).bonusTicks));
+}
+
+void buildCycle() {
+    // The cycle keeps clear of where the movers start.
+    for (const auto& obstacle : obstacles) {
+        levelLayout.blocked[cellOf(obstacle.x, obstacle.y)] = CELL_WALL;
+    }
+    // Pilots only play the window-sized board; see togglePilot().
+    if (windowSizedBoard() && !endlessMode) {
+        cycle.build(levelLayout);
+    }
+    else {
+        cycle = HamiltonCycle();
+    }
+    pilot.reset(cycle);
+
+    // Movers step every OBSTACLE_PERIOD ticks; levelLayout then tracks where
+    // they are.
+    movingObstacles.reset(levelLayout);
+    for (const auto& obstacle : obstacles) {
+        int c = cellOf(obstacle.x, obstacle.y);
+        levelLayout.blocked[c] = CELL_OPEN;
+        movingObstacles.add(c, obstacle.direction);
+    }
+}
+
+Direction autopilotDirection() {
+    vector<uint8_t> occupied(levelLayout.cells(), 0);
+    for (const auto& segment : snake) {
+        occupied[cellOf(segment.x, segment.y)] = 1;
+    }
+    auto segment = [](int i) { return cellOf(snake[i].x, snake[i].y); };
+    auto isFree = [&](int c) { return !levelLayout.blocked[c] && !occupied[c]; };
+    int next = pilot.nextCell(levelLayout, segment, static_cast<int>(snake.size()), cellOf(food.x, food.y), isFree);
+    if (next < 0) {
+        return snakeDirection;
+    }
+    return directionTo(levelLayout, cellOf(snake.front().x, snake.front().y), next);
+}
+
+void captureGame(Game& game) {
+    game.reset(levelLayout, rand());
+    for (int i = static_cast<int>(snake.size()) - 1; i >= 0; i--) {
+        game.pushHead(cellOf(snake[i].x, snake[i].y));
+    }
+    game.food = cellOf(food.x, food.y);
+    game.foodBonus = food.isBonus;
+    game.score = score;
+    game.direction = snakeDirection;
+}
+
+void togglePilot(PilotMode mode) {
+    if (gameState != PLAYING && gameState != PAUSED) {
+        return;
+    }
+    if (foodFieldMode) {
+        cout << "Pilots play the single-food game, press f to leave food field mode" << endl;
+        return;
+    }
+    if (endlessMode) {
+        cout << "Pilots play the fixed board, press e to leave endless mode" << endl;
+        return;
+    }
+    if (!windowSizedBoard()) {
+        cout << "Pilots play the window-sized board" << endl;
+        return;
+    }
+    if (mode == PILOT_HAMILTON && !obstacles.empty()) {
+        cout << "The autopilot cycle needs obstacles that stay put" << endl;
+        return;
+    }
+    if (mode == PILOT_HAMILTON && cycle.length == 0) {
+        cout << "No autopilot cycle fits this level" << endl;
+        return;
+    }
+    if (mode == PILOT_NEURAL && !policy.loaded()) {
+        cout << "No policy.bin loaded" << endl;
+        return;
+    }
+    pilotMode = (pilotMode == mode) ? PILOT_MANUAL : mode;
+    pilot.reset(cycle);
+    if (pilotMode == PILOT_HAMILTON && !cycle.contains(cellOf(food.x, food.y))) {
+        generateFood(food.isBonus);
+    }
+}
+
+void fillFoodField() {
+    auto isFree = [](int c) {
+        return !levelLayout.blocked[c] && snakeCells[c] == 0;
+    };
+    while (foodField.count() < FOOD_FIELD_ITEMS) {
+        int c = foodField.randomFreeCell(levelLayout.cells(), fieldRng, isFree);
+        if (c < 0) {
+            break;
+        }
+        foodField.spawn(c, randomFoodType(fieldRng), tickCount, TIMED_FOOD_TICKS);
+    }
+}
+
+// One GEOMETRY command per texture: normal, timed and poisoned items share
+// the fruit texture and differ only in vertex colour.
+void renderFoodField() {
+    for (int b = 0; b < 2; b++) {
+        int first = static_cast<int>(frame->vertices.size() / 4), quads = 0;
+        for (int i = 0; i < foodField.count(); i++) {
+            FoodType type = foodField.types[i];
+            if ((type == FOOD_BONUS) != (b == 1)) {
+                continue;
+            }
+            // Timed food blinks for its last 15 ticks.
+            if (type == FOOD_TIMED && foodField.expiry[i] - tickCount < 15 && tickCount % 2 == 1) {
+                continue;
+            }
+            SDL_Color color = { 255, 255, 255, 255 };
+            if (type == FOOD_TIMED) {
+                color = { 255, 210, 80, 255 };
+            }
+            else if (type == FOOD_POISONED) {
+                color = { 120, 255, 120, 255 };
+            }
+            float x = static_cast<float>(screenX(foodField.cells[i] % boardWidth * CELL_SIZE));
+            float y = static_cast<float>(screenY(foodField.cells[i] / boardWidth * CELL_SIZE));
+            if (x <= -CELL_SIZE || x >= SCREEN_WIDTH || y <= -CELL_SIZE || y >= SCREEN_HEIGHT) {
+                continue;
+            }
+            frame->vertices.push_back({ { x, y }, color, { 0, 0 } });
+            frame->vertices.push_back({ { x + CELL_SIZE, y }, color, { 1, 0 } });
+            frame->vertices.push_back({ { x + CELL_SIZE, y + CELL_SIZE }, color, { 1, 1 } });
+            frame->vertices.push_back({ { x, y + CELL_SIZE }, color, { 0, 1 } });
+            quads++;
+        }
+        if (quads > 0) {
+            frame->commands.push_back({ DrawCommand::GEOMETRY, b ? TEXTURE_BONUS_FRUIT : TEXTURE_FRUIT, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, first, quads });
+        }
+    }
+}
+
+// A burst from the centre of the cell at pixel (x, y); what does not fit in
+// the pool is dropped.
+void spawnParticles(int x, int y, int n, float speed, uint32_t rgb) {
+    particles.burst(screenX(x) + CELL_SIZE * 0.5f, screenY(y) + CELL_SIZE * 0.5f, n, speed, 0.8f, rgb, particleRng);
+}
+
+// Every live particle in one untextured GEOMETRY command.
+void renderParticles() {
+    if (particles.count() == 0) {
+        return;
+    }
+    size_t first = frame->vertices.size();
+    frame->vertices.resize(first + static_cast<size_t>(particles.count()) * 4);
+    particles.buildQuads(&frame->vertices[first], 4.0f);
+    frame->commands.push_back({ DrawCommand::GEOMETRY, TEXTURE_NONE, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, static_cast<int>(first / 4), particles.count() });
+}
+
+void toggleEndless() {
+    endlessMode = !endlessMode;
+    foodFieldMode = false;
+    wrapMode = false;
+    pilotMode = PILOT_MANUAL;
+    if (gameState == PLAYING || gameState == PAUSED) {
+        resetGame(false);
+    }
+}
+
+// Endless mode keeps the head in the middle of the window; a bounded board
+// larger than the window follows the head but stops at the board's edges,
+// unless they wrap.
+// Follows the head as drawn, so the board scrolls as smoothly as it moves.
+void updateView(int headX, int headY) {
+    if (endlessMode || (wrapMode && boardScrolls())) {
+        viewX = headX - SCREEN_WIDTH / 2;
+        viewY = headY - SCREEN_HEIGHT / 2;
+    }
+    else {
+        viewX = followAxis(headX, boardWidth * CELL_SIZE, SCREEN_WIDTH);
+        viewY = followAxis(headY, boardHeight * CELL_SIZE, SCREEN_HEIGHT);
+    }
+}
+
+// A random open, loaded cell within ENDLESS_FOOD_RANGE of the head, in pixels.
+bool endlessFreeCell(int& x, int& y) {
+    int headX = snake.front().x / CELL_SIZE, headY = snake.front().y / CELL_SIZE;
+    int span = 2 * ENDLESS_FOOD_RANGE + 1;
+    for (int tries = 0; tries < 64; tries++) {
+        int cx = headX - ENDLESS_FOOD_RANGE + rand() % span;
+        int cy = headY - ENDLESS_FOOD_RANGE + rand() % span;
+        if (foodAllowed(cx * CELL_SIZE, cy * CELL_SIZE)) {
+            x = cx * CELL_SIZE;
+            y = cy * CELL_SIZE;
+            return true;
+        }
+    }
+    return false;
+}
+
+// The cell a view coordinate falls in, rounding down: the view follows the
+// drawn head, so it can start part way into a cell, or left of or above 0.
+int viewCell(int pixel) {
+    return pixel >= 0 ? pixel / CELL_SIZE : (pixel + 1) / CELL_SIZE - 1;
+}
+
+// Walls of the chunks under the window; cells still being generated are
+// drawn dark. A view part way into a cell shows one more column and row.
+void renderWorld() {
+    int x0 = viewCell(viewX), y0 = viewCell(viewY);
+    for (int y = y0; y <= y0 + GRID_HEIGHT; y++) {
+        for (int x = x0; x <= x0 + GRID_WIDTH; x++) {
+            uint8_t c = world.cell(x, y);
+            if (c == CELL_OPEN) {
+                continue;
+            }
+            SDL_Rect rect = { x * CELL_SIZE - viewX, y * CELL_SIZE - viewY, CELL_SIZE, CELL_SIZE };
+            if (c == CELL_UNLOADED) {
+                pushFill(rect, { 30, 30, 30, 255 });
+            }
+            else {
+                pushCopy(TEXTURE_OBSTACLE, rect);
+            }
+        }
+    }
+}
+
+// Walls and snake of the bounded board under the window, looked up per cell
+// in levelLayout and snakeCells, so drawing costs the same however large the
+// board or the snake is. A wrapped board's window can hang over an edge and
+// shows the cells from the opposite side there. The head's cell is left to
+// render(), which draws the head on its way in.
+void renderBoard() {
+    int headCell = cellOf(snake.front().x, snake.front().y);
+    Uint8 alpha = snakeAlpha();
+    int x0 = viewCell(viewX), y0 = viewCell(viewY);
+    int x1 = x0 + GRID_WIDTH + 1, y1 = y0 + GRID_HEIGHT + 1;
+    if (!wrapMode) {
+        x1 = min(boardWidth, x1);
+        y1 = min(boardHeight, y1);
+    }
+    for (int y = y0; y < y1; y++) {
+        int row = wrapCoord(y, boardHeight) * boardWidth;
+        const uint8_t* walls = &levelLayout.blocked[row];
+        const uint16_t* body = &snakeCells[row];
+        for (int x = x0; x < x1; x++) {
+            int bx = wrapCoord(x, boardWidth);
+            if (walls[bx] == CELL_OPEN && body[bx] == 0) {
+                continue;
+            }
+            SDL_Rect rect = { x * CELL_SIZE - viewX, y * CELL_SIZE - viewY, CELL_SIZE, CELL_SIZE };
+            if (walls[bx] != CELL_OPEN) {
+                pushCopy(TEXTURE_OBSTACLE, rect);
+            }
+            if (body[bx] > (row + bx == headCell ? 1 : 0)) {
+                pushCopy(TEXTURE_SNAKE, rect, alpha);
+            }
+        }
+    }
+}
+
+// Bottom-right corner of a board larger than the window: the minimap, with
+// the window outlined and the food marked on top. Only pixels that changed
+// go to the render thread: every change since the last frame it uploaded,
+// as it may not have drawn the frames in between.
+void renderMinimap() {
+    if (endlessMode || !boardScrolls()) {
+        return;
+    }
+    int x, y, w, h;
+    if (minimap.takeDirty(x, y, w, h)) {
+        minimapChanges.push_back({ frame->sequence, { x, y, w, h } });
+    }
+    uint64_t uploaded = minimapUploaded.load(std::memory_order_acquire);
+    minimapChanges.erase(std::remove_if(minimapChanges.begin(), minimapChanges.end(),
+                                        [uploaded](const std::pair<uint64_t, SDL_Rect>& c) { return c.first <= uploaded; }),
+                         minimapChanges.end());
+    // Changes from before a reset can be off a smaller new minimap.
+    SDL_Rect dirty = { 0, 0, 0, 0 }, bounds = { 0, 0, minimap.width, minimap.height };
+    for (const auto& c : minimapChanges) {
+        SDL_Rect part, grown;
+        if (!SDL_IntersectRect(&c.second, &bounds, &part)) {
+            continue;
+        }
+        SDL_UnionRect(&dirty, &part, &grown);
+        dirty = dirty.w == 0 ? part : grown;
+    }
+    frame->minimapWidth = minimap.width;
+    frame->minimapHeight = minimap.height;
+    frame->minimapDirty = dirty;
+    frame->minimapPixels.resize(static_cast<size_t>(dirty.w) * dirty.h);
+    for (int row = 0; row < dirty.h; row++) {
+        const uint32_t* from = &minimap.pixels[static_cast<size_t>(dirty.y + row) * minimap.width + dirty.x];
+        std::copy(from, from + dirty.w, &frame->minimapPixels[static_cast<size_t>(row) * dirty.w]);
+    }
+
+    SDL_Rect mapRect = { SCREEN_WIDTH - minimap.width - 10, SCREEN_HEIGHT - minimap.height - 10, minimap.width, minimap.height };
+    pushCopy(TEXTURE_MINIMAP, mapRect);
+    int scale = minimap.scale * CELL_SIZE;
+    int mapViewX = wrapCoord(viewX, boardWidth * CELL_SIZE), mapViewY = wrapCoord(viewY, boardHeight * CELL_SIZE);
+    SDL_Rect viewRect = { mapRect.x + mapViewX / scale, mapRect.y + mapViewY / scale, max(1, SCREEN_WIDTH / scale), max(1, SCREEN_HEIGHT / scale) };
+    pushOutline(viewRect, { 255, 255, 153, 255 });
+    if (!foodFieldMode) {
+        SDL_Rect foodRect = { mapRect.x + food.x / scale - 1, mapRect.y + food.y / scale - 1, 3, 3 };
+        pushFill(foodRect, { 255, 80, 64, 255 });
+    }
+}
+
+// Every change to `snake` on a bounded board goes through here.
+void occupy(const SnakeSegment& segment, int delta) {
+    if (endlessMode) {
+        return;
+    }
+    snakeCells[cellOf(segment.x, segment.y)] += delta;
+    minimap.addSnake(segment.x / CELL_SIZE, segment.y / CELL_SIZE, delta);
+}
+
+void popTail() {
+    occupy(snake.back(), -1);
+    snake.pop_back();
+}
+
+// Window position of board pixel x (or y). On a wrapped board it is
+// whichever copy of the position falls right of (below) the window's left
+// (top) edge, so things just across an edge are drawn next to the head.
+int screenX(int x) {
+    if (!wrapMode) {
+        return x - viewX;
+    }
+    int w = boardWidth * CELL_SIZE;
+    return ((x - viewX) % w + w) % w;
+}
+
+int screenY(int y) {
+    if (!wrapMode) {
+        return y - viewY;
+    }
+    int h = boardHeight * CELL_SIZE;
+    return ((y - viewY) % h + h) % h;
+}
+
+void toggleWrap() {
+    wrapMode = !wrapMode;
+    endlessMode = false;
+    if (gameState == PLAYING || gameState == PAUSED) {
+        resetGame(false);
+    }
+}
+
+void toggleFoodField() {
+    foodFieldMode = !foodFieldMode;
+    endlessMode = false;
+    pilotMode = PILOT_MANUAL;
+    if (gameState == PLAYING || gameState == PAUSED) {
+        resetGame(false);
+    }
+}
+
+// An obstacle walking into the snake shoves the whole snake one cell along;
+// if any segment has nowhere to go the snake is crushed.
+void moveObstacles() {
+    bool crushed = false;
+    movingObstacles.step([&](int, int cell, Direction d) {
+        // Food and power-ups are not in the blocked grid; an obstacle
+        // parked on one would hide it and kill the snake going for it.
+        int x = cell % boardWidth * CELL_SIZE, y = cell / boardWidth * CELL_SIZE;
+        bool onFood = foodFieldMode ? foodField.at(cell) >= 0 : food.x == x && food.y == y;
+        if (onFood || (powerUp.type != POWERUP_NONE && powerUp.x == x && powerUp.y == y)) {
+            return false;
+        }
+        if (crushed || timers.pending(ghostTimer) || !checkCollision(x, y)) {
+            return true;
+        }
+        crushed = !pushSnake(d);
+        return !crushed;
+    });
+    for (int i = 0; i < movingObstacles.count(); i++) {
+        if (obstacles[i].x != movingObstacles.x[i] * CELL_SIZE || obstacles[i].y != movingObstacles.y[i] * CELL_SIZE) {
+            minimap.addWall(obstacles[i].x / CELL_SIZE, obstacles[i].y / CELL_SIZE, -1);
+            minimap.addWall(movingObstacles.x[i], movingObstacles.y[i], 1);
+        }
+        obstacles[i].x = movingObstacles.x[i] * CELL_SIZE;
+        obstacles[i].y = movingObstacles.y[i] * CELL_SIZE;
+        obstacles[i].direction = movingObstacles.direction[i];
+    }
+    if (crushed) {
+        gameOver();
+    }
+}
+
+bool pushSnake(Direction d) {
+    int dx = d == Direction::LEFT ? -CELL_SIZE : d == Direction::RIGHT ? CELL_SIZE : 0;
+    int dy = d == Direction::UP ? -CELL_SIZE : d == Direction::DOWN ? CELL_SIZE : 0;
+    if (wrapMode) {
+        // Off one edge means back on at the other; only walls can crush.
+        for (const auto& segment : snake) {
+            int x = wrapCoord(segment.x + dx, boardWidth * CELL_SIZE), y = wrapCoord(segment.y + dy, boardHeight * CELL_SIZE);
+            if (levelLayout.blocked[cellOf(x, y)]) {
+                return false;
+            }
+        }
+        for (auto& segment : snake) {
+            occupy(segment, -1);
+            segment.x = wrapCoord(segment.x + dx, boardWidth * CELL_SIZE);
+            segment.y = wrapCoord(segment.y + dy, boardHeight * CELL_SIZE);
+        }
+        for (const auto& segment : snake) {
+            occupy(segment, 1);
+        }
+        return true;
+    }
+    for (const auto& segment : snake) {
+        int x = segment.x + dx, y = segment.y + dy;
+        if (x < 0 || x >= boardWidth * CELL_SIZE || y < 0 || y >= boardHeight * CELL_SIZE || levelLayout.blocked[cellOf(x, y)]) {
+            return false;
+        }
+    }
+    for (auto& segment : snake) {
+        occupy(segment, -1);
+        segment.x += dx;
+        segment.y += dy;
+    }
+    for (const auto& segment : snake) {
+        occupy(segment, 1);
+    }
+    return true;
+}
+
+void onTimer(int kind, int data) {
+    (void)data;
+    switch (kind) {
+        case TIMER_BONUS_EXPIRES:
+            // Uneaten bonus food turns into normal food somewhere else.
+            if (!foodFieldMode) {
+                generateFood(false);
+            }
+            break;
+        case TIMER_POWERUP_SPAWN:
+            spawnPowerUp();
+            break;
+        case TIMER_POWERUP_EXPIRES:
+            powerUp.type = POWERUP_NONE;
+            powerUpTimer = timers.schedule(POWERUP_RESPAWN_TICKS + rand() % POWERUP_RESPAWN_TICKS, TIMER_POWERUP_SPAWN);
+            break;
+    }
+}
+
+void spawnPowerUp() {
+    for (int tries = 0; tries < 64; tries++) {
+        int x = rand() % boardWidth * CELL_SIZE;
+        int y = rand() % boardHeight * CELL_SIZE;
+        if (endlessMode && !endlessFreeCell(x, y)) {
+            break;
+        }
+        if (foodAllowed(x, y) && !(x == food.x && y == food.y) && !(foodFieldMode && foodField.has(cellOf(x, y)))) {
+            powerUp = { x, y, static_cast<PowerUpType>(rand() % POWERUP_NONE) };
+            powerUpTimer = timers.schedule(POWERUP_TICKS, TIMER_POWERUP_EXPIRES);
+            return;
+        }
+    }
+    powerUpTimer = timers.schedule(POWERUP_RESPAWN_TICKS, TIMER_POWERUP_SPAWN);
+}
+
+// Speed and ghost last POWERUP_EFFECT_TICKS; taking the same one again
+// restarts the clock. Shrink halves the snake at once.
+void applyPowerUp(PowerUpType type) {
+    Mix_PlayChannel(-1, bonusSound, 0);
+    timers.cancel(powerUpTimer);
+    powerUp.type = POWERUP_NONE;
+    powerUpTimer = timers.schedule(POWERUP_RESPAWN_TICKS + rand() % POWERUP_RESPAWN_TICKS, TIMER_POWERUP_SPAWN);
+    if (type == POWERUP_SPEED) {
+        timers.cancel(speedTimer);
+        speedTimer = timers.schedule(POWERUP_EFFECT_TICKS, TIMER_EFFECT_ENDS);
+    }
+    else if (type == POWERUP_GHOST) {
+        timers.cancel(ghostTimer);
+        ghostTimer = timers.schedule(POWERUP_EFFECT_TICKS, TIMER_EFFECT_ENDS);
+    }
+    else if (type == POWERUP_SHRINK) {
+        size_t keep = max<size_t>(3, snake.size() / 2);
+        while (snake.size() > keep) {
+            popTail();
+        }
+    }
+}
+
+// Falls back to compiling levels.txt, so editing the text is enough during
+// development; without any levels there is nothing to play.
+void loadLevels() {
+    std::string error;
+    if (openLevels(levels, "levels.bin", error)) {
+        return;
+    }
+    cout << error << ", compiling levels.txt instead" << endl;
+    if (!openLevels(levels, "levels.txt", error)) {
+        cout << error << endl;
+        exit(1);
+    }
+}
+
+// levels.bin is mapped, levels.txt compiled in memory.
+bool openLevels(LevelCatalog& catalog, const std::string& name, std::string& error) {
+    if (name == "levels.bin") {
+        return catalog.open(name.c_str(), error);
+    }
+    std::string text;
+    std::vector<uint8_t> bytes;
+    if (!readTextFile(name.c_str(), text)) {
+        error = name + ": cannot read";
+        return false;
+    }
+    if (!compileLevels(text, bytes, error) || !catalog.adopt(std::move(bytes), error)) {
+        error = name + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+// Saving an image, sound, the font or a level file while the game runs
+// replaces it in the running game: the watcher thread reads and decodes it,
+// the main and render threads only swap handles. A file that fails to load
+// (say, saved half-way) leaves the old resource in place.
+void startHotReload() {
+    std::vector<std::string> names = { FONT_FILE, "levels.txt", "levels.bin" };
+    for (const TextureAsset& a : TEXTURE_ASSETS) {
+        names.push_back(a.file);
+    }
+    for (const SoundAsset& a : SOUND_ASSETS) {
+        names.push_back(a.file);
+    }
+    if (!assetWatcher.start(".", names, loadReload)) {
+        cout << "Cannot watch the asset files, hot reload is off" << endl;
+    }
+}
+
+// Watcher thread. Only decodes; nothing here touches the renderer, the
+// mixer's channels or anything the simulation thread reads.
+void loadReload(const std::string& name) {
+    Reload r;
+    r.name = name;
+    std::string error;
+    bool ok;
+    if (name == "levels.txt" || name == "levels.bin") {
+        r.levels.reset(new LevelCatalog());
+        ok = openLevels(*r.levels, name, error);
+    }
+    else if (name == FONT_FILE) {
+        ok = readTextFile(FONT_FILE, r.fontBytes) && !r.fontBytes.empty();
+    }
+    else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".mp3") == 0) {
+        r.chunk = Mix_LoadWAV(name.c_str());
+        ok = r.chunk != nullptr;
+        error = Mix_GetError();
+    }
+    else {
+        r.surface = IMG_Load(name.c_str());
+        ok = r.surface != nullptr;
+        error = IMG_GetError();
+    }
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    if (!ok) {
+        cout << "Reloading " << name << " failed, keeping the old one: " << error << endl;
+        return;
+    }
+    for (Reload& pending : reloads) {
+        if (pending.name == name) {
+            SDL_FreeSurface(pending.surface);
+            Mix_FreeChunk(pending.chunk);
+            pending = std::move(r);
+            return;
+        }
+    }
+    reloads.push_back(std::move(r));
+}
+
+// Between frames: images and the font on the render thread, which owns
+// them (renderSide), sounds and levels on the simulation thread. Each old
+// resource is released as soon as its replacement is in; Mix_FreeChunk()
+// stops any channel still playing it. A frame that finds the watcher holding the lock
+// leaves the reloads to the next one rather than wait.
+void applyReloads(bool renderSide) {
+    std::vector<Reload> ready;
+    {
+        std::unique_lock<std::mutex> lock(reloadMutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return;
+        }
+        for (size_t i = 0; i < reloads.size();) {
+            bool forRenderer = reloads[i].surface != nullptr || !reloads[i].fontBytes.empty();
+            if (forRenderer == renderSide) {
+                ready.push_back(std::move(reloads[i]));
+                reloads.erase(reloads.begin() + i);
+            }
+            else {
+                i++;
+            }
+        }
+    }
+    for (Reload& r : ready) {
+        if (r.surface != nullptr) {
+            SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, r.surface);
+            SDL_FreeSurface(r.surface);
+            if (texture == nullptr) {
+                cout << "Reloading " << r.name << " failed, keeping the old one: " << SDL_GetError() << endl;
+                continue;
+            }
+            for (const TextureAsset& a : TEXTURE_ASSETS) {
+                if (r.name == a.file) {
+                    SDL_DestroyTexture(*a.texture);
+                    *a.texture = texture;
                 }
             }
-            for (const auto& existingObstacle : obstacles) {
-                if (obstacle.x == existingObstacle.x && obstacle.y == existingObstacle.y) {
-                    validPosition = false;
-                    break;
+        }
+        else if (r.chunk != nullptr) {
+            for (const SoundAsset& a : SOUND_ASSETS) {
+                if (r.name == a.file) {
+                    Mix_FreeChunk(*a.chunk);
+                    *a.chunk = r.chunk;
                 }
             }
         }
+        else if (r.levels) {
+            // The game in progress restarts on the new version of its level.
+            levels.swap(*r.levels);
+            if (level >= levels.count()) {
+                level = 0;
+            }
+            if (levelPage * LEVELS_PER_PAGE >= levels.count()) {
+                levelPage = 0;
+            }
+            if (gameState == PLAYING || gameState == PAUSED) {
+                resetGame(false);
+            }
+        }
+        else {
+            TTF_Font* newFont = TTF_OpenFontRW(SDL_RWFromConstMem(r.fontBytes.data(), static_cast<int>(r.fontBytes.size())), 1, FONT_SIZE);
+            if (newFont == nullptr) {
+                cout << "Reloading " << r.name << " failed, keeping the old one: " << TTF_GetError() << endl;
+                continue;
+            }
+            TTF_CloseFont(font);
+            font = newFont;
+            fontBytes.swap(r.fontBytes);
+        }
+        cout << "Reloaded " << r.name << endl;
+    }
+}
+
+// Reloads that arrived after the last frame; the watcher must be stopped.
+void dropReloads() {
+    for (Reload& r : reloads) {
+        SDL_FreeSurface(r.surface);
+        Mix_FreeChunk(r.chunk);
+    }
+    reloads.clear();
+}
+
+void startLevel(int index) {
+    level = index;
+    const LevelInfo& info = levels.level(level);
+    if (info.mazeStyle >= 0) {
+        mazeStyle = static_cast<MazeStyle>(info.mazeStyle);
+    }
+    gameState = PLAYING;
+    resetGame(false);
+}
+
+bool boardScrolls() {
+    return boardWidth > GRID_WIDTH || boardHeight > GRID_HEIGHT;
+}
+
+bool windowSizedBoard() {
+    return boardWidth == GRID_WIDTH && boardHeight == GRID_HEIGHT;
+}
+
+// Level menu rows: a page of level names, "More levels" when there is more
+// than one page, then "Main Menu". Shared by render() and handleEvents().
+SDL_Rect levelMenuRow(int row) {
+    return { SCREEN_WIDTH / 2 - 150, SCREEN_HEIGHT / 2 - 150 + row * 45, 300, 40 };
+}
+
+std::string levelMenuLabel(int row) {
+    if (row < LEVELS_PER_PAGE) {
+        int index = levelPage * LEVELS_PER_PAGE + row;
+        return index < levels.count() ? std::to_string(index + 1) + ". " + levels.level(index).name : "";
+    }
+    if (row == LEVELS_PER_PAGE) {
+        return levels.count() > LEVELS_PER_PAGE ? "More levels" : "";
+    }
+    return "Main Menu";
+}
+
+// The level's tick, shortened as the score grows and halved by the speed
+// power-up, never below MIN_TICK_MS.
+double tickInterval() {
+    double ms = levels.level(level).tickMs;
+    if (gameState == PLAYING || gameState == PAUSED) {
+        ms = rampedTickMs(ms, score, TICK_RAMP, MIN_TICK_MS);
+    }
+    if (timers.pending(speedTimer)) {
+        ms = max(MIN_TICK_MS, ms / 2);
+    }
+    return ms;
+}
 
-        obstacles.push_back(obstacle);
+// Where a segment that moved from `from` to `to` on the last tick is drawn
+// tickAlpha of the way into the next. A jump of more than a cell (across a
+// wrapped board's edge, into a new game) is not drawn in between.
+SnakeSegment drawnAt(const SnakeSegment& from, const SnakeSegment& to) {
+    if (abs(to.x - from.x) + abs(to.y - from.y) > CELL_SIZE) {
+        return to;
     }
-}
\ No newline at end of file
+    return { from.x + static_cast<int>(lround((to.x - from.x) * tickAlpha)), from.y + static_cast<int>(lround((to.y - from.y) * tickAlpha)) };
+}
+
+// Render thread: draws the newest frame the simulation thread has
+// published, or the last one again if none has come since, so neither
+// thread ever waits for the other. Frames published in between are skipped.
+void renderLoop() {
+    initRenderer();
+    TickPacer<SdlClock> pacer;
+    pacer.restart();
+    ThreadTiming timing;
+    uint64_t shown = 0;
+    int skipped = 0;
+    while (!renderQuit.load(std::memory_order_acquire)) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        applyReloads(true);
+        if (frames.fetch()) {
+            uint64_t sequence = frames.front().sequence;
+            skipped += shown != 0 && sequence > shown + 1 ? static_cast<int>(sequence - shown - 1) : 0;
+            shown = sequence;
+        }
+        const Frame& f = frames.front();
+        if (f.sequence != 0) {
+            drawFrame(f);
+            if (f.showTiming) {
+                drawTiming(f, timing, skipped);
+            }
+        }
+        Uint64 drawn = SDL_GetPerformanceCounter();
+        SDL_RenderPresent(renderer);
+        timeFrame(timing, start, drawn, SDL_GetPerformanceCounter(), pacer.stats());
+        if (vsync) {
+            pacer.mark(frameMs);
+        }
+        else {
+            pacer.wait(frameMs);
+        }
+    }
+    closeRenderer();
+}
+
+// Render thread: everything a Frame says, in order. The minimap's changes
+// are uploaded once per frame, however often the frame is drawn.
+void drawFrame(const Frame& f) {
+    if (f.minimapWidth != 0 && (f.minimapWidth != minimapTextureWidth || f.minimapHeight != minimapTextureHeight)) {
+        SDL_DestroyTexture(minimapTexture);
+        minimapTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, f.minimapWidth, f.minimapHeight);
+        minimapTextureWidth = f.minimapWidth;
+        minimapTextureHeight = f.minimapHeight;
+    }
+    if (f.minimapWidth != 0 && f.sequence > minimapUploaded.load(std::memory_order_relaxed)) {
+        if (f.minimapDirty.w > 0) {
+            SDL_UpdateTexture(minimapTexture, &f.minimapDirty, f.minimapPixels.data(), f.minimapDirty.w * 4);
+        }
+        minimapUploaded.store(f.sequence, std::memory_order_release);
+    }
+
+    SDL_Texture* textures[] = { nullptr, backgroundTexture, snakeBodyTexture, fruitTexture, bonusFruitTexture, obstacleTexture, minimapTexture };
+    SDL_SetTextureBlendMode(snakeBodyTexture, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF);
+    SDL_RenderClear(renderer);
+    for (const DrawCommand& c : f.commands) {
+        SDL_Texture* texture = textures[c.texture];
+        switch (c.kind) {
+            case DrawCommand::COPY:
+                SDL_SetTextureAlphaMod(texture, c.color.a);
+                SDL_RenderCopy(renderer, texture, NULL, &c.rect);
+                break;
+            case DrawCommand::FILL:
+                SDL_SetRenderDrawColor(renderer, c.color.r, c.color.g, c.color.b, c.color.a);
+                SDL_RenderFillRect(renderer, &c.rect);
+                break;
+            case DrawCommand::OUTLINE:
+                SDL_SetRenderDrawColor(renderer, c.color.r, c.color.g, c.color.b, c.color.a);
+                SDL_RenderDrawRect(renderer, &c.rect);
+                break;
+            case DrawCommand::GEOMETRY:
+                extendQuadIndices(quadIndices, c.count);
+                SDL_RenderGeometry(renderer, texture, &f.vertices[static_cast<size_t>(c.first) * 4], c.count * 4, quadIndices.data(), c.count * 6);
+                break;
+            case DrawCommand::TEXT:
+                drawText(f.text.substr(c.first, c.count), c.rect.x, c.rect.y, c.color);
+                break;
+        }
+    }
+}
+
+// Busy, then extra, milliseconds of each thread's frame, and how often its
+// frames come: "Main 0.40 + 0.10 / 16.67" spent 0.4 ms on events and ticks
+// and 0.1 ms building a frame every 16.67 ms.
+void drawTiming(const Frame& f, const ThreadTiming& t, int skipped) {
+    char line[96];
+    snprintf(line, sizeof(line), "Input %.1f ms to the tick, worst %.1f", f.inputMs, f.inputWorstMs);
+    drawText(line, 10, SCREEN_HEIGHT - 180, {153, 255, 153, 255});
+    snprintf(line, sizeof(line), "Tick %.1f ms, %d/s, jitter %.2f, worst %.2f", f.tickMs, f.ticksPerSecond, f.tickJitterMs,
+             f.tickJitterWorstMs);
+    drawText(line, 10, SCREEN_HEIGHT - 145, {153, 255, 153, 255});
+    snprintf(line, sizeof(line), "Sim %.2f + %.2f / %.2f ms, late %.2f", f.sim.busyMs, f.sim.extraMs, f.sim.intervalMs, f.sim.lateMs);
+    drawText(line, 10, SCREEN_HEIGHT - 110, {153, 255, 153, 255});
+    snprintf(line, sizeof(line), "Render %.2f + %.2f / %.2f ms %s, %d skipped", t.busyMs, t.extraMs, t.intervalMs, vsync ? "vsync" : "paced", skipped);
+    drawText(line, 10, SCREEN_HEIGHT - 75, {153, 255, 153, 255});
+}
+
+// Averages over the last few dozen frames.
+void timeFrame(ThreadTiming& t, Uint64 start, Uint64 middle, Uint64 end, const TickStats& pacing) {
+    double perMs = SDL_GetPerformanceFrequency() / 1000.0;
+    t.busyMs += ((middle - start) / perMs - t.busyMs) / 16;
+    t.extraMs += ((end - middle) / perMs - t.extraMs) / 16;
+    t.intervalMs = pacing.meanIntervalMs;
+    t.lateMs = pacing.meanLateMs;
+}
@@ -0,0 +1,285 @@
+#pragma once
+
+#include "board.h"
+
+#include <cstdlib>
+#include <vector>
+
+// Many snakes on one board, all moving at once. Per-snake state is kept as
+// parallel arrays indexed by snake id; bodies live in the board itself: each
+// occupied cell knows its owner and the next cell towards that snake's head,
+// so a snake is just (head, tail, length) and moving it is O(1).
+//
+// A tick resolves every living snake together:
+//  - a head that leaves the board or enters an obstacle or any cell occupied
+//    at the start of the tick dies (tails included, as in update());
+//  - heads entering the same free cell: the longest survives, ties all die;
+//  - a survivor whose head lands on food eats it and grows.
+// Each step touches only the cells next to the heads, so a tick costs
+// O(snakes) plus the length of the snakes that died.
+struct Arena {
+    const Layout* layout = nullptr;
+    Rng rng;
+    int foodTarget = 0;
+    bool respawn = false;
+
+    // Per cell.
+    std::vector<int> owner;        // snake id + 1, 0 if free
+    std::vector<int> towardHead;   // next body cell towards the owner's head
+    std::vector<uint8_t> foodType; // 0 none, 1 normal, 2 bonus
+    std::vector<int> foodSlot;     // index into foods
+    std::vector<int> claim;        // snake taking the cell this tick, -1 none
+    std::vector<uint8_t> claimTie;
+
+    // Per snake.
+    std::vector<int> head;
+    std::vector<int> tail;
+    std::vector<int> length;
+    std::vector<int> score;
+    std::vector<int> target;
+    std::vector<int> goal;         // food cell the built-in bot heads for
+    std::vector<uint8_t> alive;
+    std::vector<uint8_t> direction;
+    std::vector<uint8_t> steered;  // 1 if direction comes from outside, not the bot
+
+    std::vector<int> foods;
+    std::vector<int> claimed;
+    int living = 0;
+
+    // Counts for the last tick.
+    int deaths = 0;
+    int headOns = 0;
+    int eats = 0;
+
+    void reset(const Layout& l, int snakes, int foodCount, uint64_t seed) {
+        layout = &l;
+        rng = Rng(seed);
+        int cells = l.cells();
+        owner.assign(cells, 0);
+        towardHead.assign(cells, -1);
+        foodType.assign(cells, 0);
+        foodSlot.assign(cells, -1);
+        claim.assign(cells, -1);
+        claimTie.assign(cells, 0);
+        head.assign(snakes, -1);
+        tail.assign(snakes, -1);
+        length.assign(snakes, 0);
+        score.assign(snakes, 0);
+        target.assign(snakes, -1);
+        goal.assign(snakes, -1);
+        alive.assign(snakes, 0);
+        direction.assign(snakes, static_cast<uint8_t>(Direction::RIGHT));
+        steered.assign(snakes, 0);
+        foods.clear();
+        claimed.clear();
+        living = 0;
+        deaths = headOns = eats = 0;
+        for (int i = 0; i < snakes; i++) {
+            spawnSnake(i);
+        }
+        foodTarget = foodCount;
+        refillFood();
+    }
+
+    int snakes() const { return static_cast<int>(head.size()); }
+
+    // Sets the move of a snake driven by input rather than the built-in bot.
+    void steer(int snake, Direction d) {
+        steered[snake] = 1;
+        direction[snake] = static_cast<uint8_t>(d);
+    }
+
+    // Three cells in a row facing right, like placeDefaultSnake(), at a
+    // random spot; gives up (snake stays dead) if the board is too crowded.
+    bool spawnSnake(int i) {
+        const Layout& l = *layout;
+        for (int tries = 0; tries < 64; tries++) {
+            int x = 2 + rng.below(l.width - 2), y = rng.below(l.height);
+            int c = l.cell(x, y);
+            if (!freeCell(c) || !freeCell(c - 1) || !freeCell(c - 2)) {
+                continue;
+            }
+            tail[i] = head[i] = c - 2;
+            owner[c - 2] = i + 1;
+            length[i] = 1;
+            pushHead(i, c - 1);
+            pushHead(i, c);
+            alive[i] = 1;
+            direction[i] = static_cast<uint8_t>(Direction::RIGHT);
+            goal[i] = -1;
+            living++;
+            return true;
+        }
+        return false;
+    }
+
+    bool freeCell(int c) const {
+        return c >= 0 && !layout->blocked[c] && owner[c] == 0 && foodType[c] == 0;
+    }
+
+    void refillFood() {
+        const Layout& l = *layout;
+        while (static_cast<int>(foods.size()) < foodTarget) {
+            int c = -1;
+            for (int tries = 0; tries < 64 && c < 0; tries++) {
+                int r = rng.below(l.cells());
+                if (freeCell(r)) c = r;
+            }
+            if (c < 0) {
+                return;
+            }
+            foodType[c] = rng.below(10) == 0 ? 2 : 1;
+            foodSlot[c] = static_cast<int>(foods.size());
+            foods.push_back(c);
+        }
+    }
+
+    // Greedy bot: the free neighbour closest to its goal food, ties broken at
+    // random; a new goal is drawn when the old one has been eaten.
+    void think(int i) {
+        const Layout& l = *layout;
+        int g = goal[i];
+        if ((g < 0 || foodType[g] == 0) && !foods.empty()) {
+            g = goal[i] = foods[rng.below(static_cast<int>(foods.size()))];
+        }
+        int h = head[i];
+        int best = direction[i], bestDist = 1 << 30;
+        for (int d = 0; d < 4; d++) {
+            int n = stepCell(l, h, static_cast<Direction>(d));
+            if (n < 0 || l.blocked[n] || owner[n] != 0) {
+                continue;
+            }
+            int dist = g < 0 ? 0 : std::abs(g % l.width - n % l.width) + std::abs(g / l.width - n / l.width);
+            dist = dist * 4 + rng.below(4);
+            if (dist < bestDist) {
+                bestDist = dist;
+                best = d;
+            }
+        }
+        direction[i] = static_cast<uint8_t>(best);
+    }
+
+    void tick() {
+        const Layout& l = *layout;
+        int n = snakes();
+        deaths = headOns = eats = 0;
+        for (int i = 0; i < n; i++) {
+            if (alive[i] && !steered[i]) {
+                think(i);
+            }
+        }
+
+        // Heads against walls and bodies, then claim the target cells; the
+        // claim grid is only touched at the heads and is cleared afterwards.
+        for (int i = 0; i < n; i++) {
+            if (!alive[i]) {
+                target[i] = -1;
+                continue;
+            }
+            int t = stepCell(l, head[i], static_cast<Direction>(direction[i]));
+            if (t < 0 || l.blocked[t] || owner[t] != 0) {
+                target[i] = -1;
+                continue;
+            }
+            target[i] = t;
+            int c = claim[t];
+            if (c < 0) {
+                claim[t] = i;
+                claimed.push_back(t);
+            } else if (length[i] > length[c]) {
+                claim[t] = i;
+                claimTie[t] = 0;
+            } else if (length[i] == length[c]) {
+                claimTie[t] = 1;
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            int t = target[i];
+            if (t >= 0 && (claim[t] != i || claimTie[t])) {
+                target[i] = -1;
+                headOns++;
+            }
+        }
+        for (int t : claimed) {
+            claim[t] = -1;
+            claimTie[t] = 0;
+        }
+        claimed.clear();
+
+        for (int i = 0; i < n; i++) {
+            if (alive[i] && target[i] < 0) {
+                kill(i);
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            int t = target[i];
+            if (t < 0) {
+                continue;
+            }
+            if (foodType[t] != 0) {
+                score[i] += foodType[t] == 2 ? 5 : 1;
+                removeFood(t);
+                eats++;
+            } else {
+                popTail(i);
+            }
+            pushHead(i, t);
+        }
+        if (respawn) {
+            for (int i = 0; i < n; i++) {
+                if (!alive[i]) spawnSnake(i);
+            }
+        }
+        refillFood();
+    }
+
+    // Calls visit(cell) from the tail to the head.
+    template <typename Visit>
+    void forEachSegment(int i, Visit visit) const {
+        for (int c = tail[i]; ; c = towardHead[c]) {
+            visit(c);
+            if (c == head[i]) break;
+        }
+    }
+
+private:
+    void pushHead(int i, int c) {
+        towardHead[head[i]] = c;
+        towardHead[c] = -1;
+        owner[c] = i + 1;
+        head[i] = c;
+        length[i]++;
+    }
+
+    void popTail(int i) {
+        int t = tail[i];
+        tail[i] = towardHead[t];
+        owner[t] = 0;
+        towardHead[t] = -1;
+        length[i]--;
+    }
+
+    void removeFood(int c) {
+        int slot = foodSlot[c];
+        int last = foods.back();
+        foods[slot] = last;
+        foodSlot[last] = slot;
+        foods.pop_back();
+        foodSlot[c] = -1;
+        foodType[c] = 0;
+    }
+
+    void kill(int i) {
+        for (int c = tail[i]; c >= 0; ) {
+            int next = c == head[i] ? -1 : towardHead[c];
+            owner[c] = 0;
+            towardHead[c] = -1;
+            c = next;
+        }
+        alive[i] = 0;
+        length[i] = 0;
+        head[i] = tail[i] = -1;
+        living--;
+        deaths++;
+    }
+};
@@ -0,0 +1,140 @@
+#include "arena.h"
+#include "board.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+using namespace std;
+
+// Straightforward resolution of one tick, scanning every body for every head
+// and every pair of heads: O(snakes x total length). Used to check Arena.
+struct NaiveArena {
+    vector<deque<int>> bodies;   // head first
+    vector<int> scores;
+
+    void capture(const Arena& a) {
+        int n = a.snakes();
+        bodies.assign(n, deque<int>());
+        scores = a.score;
+        for (int i = 0; i < n; i++) {
+            if (a.alive[i]) {
+                a.forEachSegment(i, [&](int c) { bodies[i].push_front(c); });
+            }
+        }
+    }
+
+    void tick(const Layout& l, const vector<uint8_t>& directions, const vector<uint8_t>& foodType) {
+        int n = static_cast<int>(bodies.size());
+        vector<int> target(n, -1);
+        for (int i = 0; i < n; i++) {
+            if (bodies[i].empty()) continue;
+            int t = stepCell(l, bodies[i].front(), static_cast<Direction>(directions[i]));
+            bool hit = t < 0 || l.blocked[t];
+            for (int j = 0; j < n && !hit; j++) {
+                for (int c : bodies[j]) {
+                    if (c == t) hit = true;
+                }
+            }
+            target[i] = hit ? -1 : t;
+        }
+        vector<int> survivor = target;
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                if (i != j && target[i] >= 0 && target[i] == target[j] && bodies[j].size() >= bodies[i].size()) {
+                    survivor[i] = -1;
+                }
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            if (bodies[i].empty()) continue;
+            int t = survivor[i];
+            if (t < 0) {
+                bodies[i].clear();
+                continue;
+            }
+            bodies[i].push_front(t);
+            if (foodType[t] != 0) {
+                scores[i] += foodType[t] == 2 ? 5 : 1;
+            } else {
+                bodies[i].pop_back();
+            }
+        }
+    }
+
+    bool matches(const Arena& a) const {
+        for (int i = 0; i < a.snakes(); i++) {
+            if (static_cast<bool>(a.alive[i]) == bodies[i].empty() || scores[i] != a.score[i]) return false;
+            if (!a.alive[i]) continue;
+            if (a.length[i] != static_cast<int>(bodies[i].size())) return false;
+            int k = static_cast<int>(bodies[i].size());
+            bool same = true;
+            a.forEachSegment(i, [&](int c) { same = same && bodies[i][--k] == c; });
+            if (!same) return false;
+        }
+        return true;
+    }
+};
+
+static bool check(int games) {
+    for (int g = 0; g < games; g++) {
+        Layout layout(24, 18);
+        Rng obstacleRng(g + 100);
+        for (int i = 0; i < 20; i++) layout.blocked[obstacleRng.below(layout.cells())] = 1;
+        Arena arena;
+        arena.reset(layout, 12, 15, g + 1);
+        NaiveArena naive;
+        naive.capture(arena);
+        for (int t = 0; t < 400 && arena.living > 0; t++) {
+            // Let the bots choose, then replay the same moves on both.
+            for (int i = 0; i < arena.snakes(); i++) {
+                if (arena.alive[i]) arena.think(i);
+            }
+            vector<uint8_t> dirs = arena.direction;
+            vector<uint8_t> food = arena.foodType;
+            for (int i = 0; i < arena.snakes(); i++) arena.steer(i, static_cast<Direction>(dirs[i]));
+            arena.tick();
+            naive.tick(layout, dirs, food);
+            if (!naive.matches(arena)) {
+                printf("check: game %d diverged at tick %d\n", g, t);
+                return false;
+            }
+        }
+    }
+    printf("check: %d games match the naive resolution\n", games);
+    return true;
+}
+
+static void bench(int snakes, int size, int ticks) {
+    Layout layout(size, size);
+    Arena arena;
+    arena.respawn = true;
+    arena.reset(layout, snakes, snakes / 2, 42);
+    long long deaths = 0, headOns = 0, eats = 0, moves = 0;
+    auto start = chrono::steady_clock::now();
+    for (int t = 0; t < ticks; t++) {
+        moves += arena.living;
+        arena.tick();
+        deaths += arena.deaths;
+        headOns += arena.headOns;
+        eats += arena.eats;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("%6d snakes %5dx%-5d %5d ticks  %8.3f ms/tick  %6.1f ns/snake-move  %9.0f ticks/s  deaths %lld (head-on %lld)  eats %lld\n",
+           snakes, size, size, ticks, seconds * 1e3 / ticks, seconds * 1e9 / moves, ticks / seconds, deaths, headOns, eats);
+}
+
+int main(int argc, char* argv[]) {
+    int ticks = argc > 1 ? atoi(argv[1]) : 1000;
+    if (!check(50)) {
+        return 1;
+    }
+    bench(2, 40, ticks);
+    bench(100, 200, ticks);
+    bench(1000, 500, ticks);
+    bench(10000, 1000, ticks);
+    bench(10000, 2000, ticks);
+    return 0;
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "board.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// One bit per cell, rows packed into 64-bit words (bit x of word x/64).
+struct Bitboard {
+    int width = 0;
+    int height = 0;
+    int stride = 0;
+    std::vector<uint64_t> bits;
+
+    Bitboard() {}
+    Bitboard(int w, int h) { resize(w, h); }
+
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        stride = (w + 63) / 64;
+        bits.assign(static_cast<size_t>(stride) * h, 0);
+    }
+
+    uint64_t* row(int y) { return &bits[static_cast<size_t>(y) * stride]; }
+    const uint64_t* row(int y) const { return &bits[static_cast<size_t>(y) * stride]; }
+
+    bool get(int x, int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1; }
+    void set(int x, int y) { row(y)[x >> 6] |= 1ull << (x & 63); }
+    void clear(int x, int y) { row(y)[x >> 6] &= ~(1ull << (x & 63)); }
+
+    int count() const {
+        int n = 0;
+        for (uint64_t w : bits) {
+            n += __builtin_popcountll(w);
+        }
+        return n;
+    }
+};
+
+// Cells the snake can move through: not an obstacle and, when given, not
+// occupied by a body segment. Reuses open's storage when the size matches.
+inline void openCells(const Layout& layout, const uint8_t* occupied, Bitboard& open) {
+    if (open.width != layout.width || open.height != layout.height) {
+        open.resize(layout.width, layout.height);
+    } else {
+        std::fill(open.bits.begin(), open.bits.end(), 0);
+    }
+    for (int y = 0; y < layout.height; y++) {
+        uint64_t* r = open.row(y);
+        const uint8_t* blocked = &layout.blocked[static_cast<size_t>(y) * layout.width];
+        const uint8_t* body = occupied ? occupied + static_cast<size_t>(y) * layout.width : nullptr;
+        for (int x = 0; x < layout.width; x++) {
+            if (!blocked[x] && !(body && body[x])) {
+                r[x >> 6] |= 1ull << (x & 63);
+            }
+        }
+    }
+}
+
+inline Bitboard openCells(const Layout& layout, const uint8_t* occupied = nullptr) {
+    Bitboard open;
+    openCells(layout, occupied, open);
+    return open;
+}
+
+inline Bitboard openCells(const Game& game) {
+    return openCells(*game.layout, game.occupied.data());
+}
+
+// Occluded fills: spread g through the set bits of p towards higher (fillUp)
+// or lower (fillDown) bit positions in six shift-and-mask steps.
+inline uint64_t fillUp(uint64_t g, uint64_t p) {
+    g |= p & (g << 1);  p &= p << 1;
+    g |= p & (g << 2);  p &= p << 2;
+    g |= p & (g << 4);  p &= p << 4;
+    g |= p & (g << 8);  p &= p << 8;
+    g |= p & (g << 16); p &= p << 16;
+    g |= p & (g << 32);
+    return g;
+}
+
+inline uint64_t fillDown(uint64_t g, uint64_t p) {
+    g |= p & (g >> 1);  p &= p >> 1;
+    g |= p & (g >> 2);  p &= p >> 2;
+    g |= p & (g >> 4);  p &= p >> 4;
+    g |= p & (g >> 8);  p &= p >> 8;
+    g |= p & (g >> 16); p &= p >> 16;
+    g |= p & (g >> 32);
+    return g;
+}
+
+// Fills every horizontal run of open cells in a row that already holds a
+// reached cell, carrying across word boundaries. Returns the changed bits.
+inline uint64_t fillRow(uint64_t* reach, const uint64_t* open, int words) {
+    uint64_t changed = 0;
+    if (words == 1) {
+        uint64_t g = fillDown(fillUp(reach[0], open[0]), open[0]);
+        changed = g ^ reach[0];
+        reach[0] = g;
+        return changed;
+    }
+    uint64_t carry = 0;
+    for (int w = 0; w < words; w++) {
+        uint64_t g = fillUp(reach[w] | (carry & open[w]), open[w]);
+        changed |= g ^ reach[w];
+        carry = g >> 63;
+        reach[w] = g;
+    }
+    carry = 0;
+    for (int w = words - 1; w >= 0; w--) {
+        uint64_t g = fillDown(reach[w] | ((carry << 63) & open[w]), open[w]);
+        changed |= g ^ reach[w];
+        carry = g & 1;
+        reach[w] = g;
+    }
+    return changed;
+}
+
+// Grows reach through open until nothing changes. Alternating downward and
+// upward sweeps pull the frontier one row at a time from the row above (or
+// below) and then fill it sideways; only the band of rows reach touches,
+// plus one row either side, is swept. reach must be a subset of open.
+inline void floodFill(Bitboard& reach, const Bitboard& open, int top, int bottom) {
+    int words = open.stride;
+    for (int y = top; y <= bottom; y++) {
+        fillRow(reach.row(y), open.row(y), words);
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int y = top > 0 ? top : 1; y < open.height && y <= bottom + 1; y++) {
+            uint64_t* r = reach.row(y);
+            const uint64_t* above = reach.row(y - 1);
+            const uint64_t* o = open.row(y);
+            uint64_t grew = 0;
+            for (int w = 0; w < words; w++) {
+                uint64_t g = r[w] | (above[w] & o[w]);
+                grew |= g ^ r[w];
+                r[w] = g;
+            }
+            if (grew) {
+                fillRow(r, o, words);
+                changed = true;
+                if (y > bottom) bottom = y;
+            }
+        }
+        for (int y = bottom < open.height - 1 ? bottom : open.height - 2; y >= 0 && y >= top - 1; y--) {
+            uint64_t* r = reach.row(y);
+            const uint64_t* below = reach.row(y + 1);
+            const uint64_t* o = open.row(y);
+            uint64_t grew = 0;
+            for (int w = 0; w < words; w++) {
+                uint64_t g = r[w] | (below[w] & o[w]);
+                grew |= g ^ r[w];
+                r[w] = g;
+            }
+            if (grew) {
+                fillRow(r, o, words);
+                changed = true;
+                if (y < top) top = y;
+            }
+        }
+    }
+}
+
+// floodFill() for a board whose edges wrap: whatever reaches one edge is
+// carried across to the opposite one and the fill repeated until neither
+// seam lets anything more through.
+inline void floodFillWrapped(Bitboard& reach, const Bitboard& open) {
+    int last = open.height - 1;
+    int lastWord = (open.width - 1) >> 6, lastBit = (open.width - 1) & 63;
+    for (;;) {
+        floodFill(reach, open, 0, last);
+        uint64_t grew = 0;
+        uint64_t* top = reach.row(0);
+        uint64_t* bottom = reach.row(last);
+        for (int w = 0; w < open.stride; w++) {
+            uint64_t down = bottom[w] & open.row(0)[w] & ~top[w];
+            uint64_t up = top[w] & open.row(last)[w] & ~bottom[w];
+            top[w] |= down;
+            bottom[w] |= up;
+            grew |= down | up;
+        }
+        for (int y = 0; y <= last; y++) {
+            uint64_t* r = reach.row(y);
+            const uint64_t* o = open.row(y);
+            uint64_t left = r[0] & 1, right = (r[lastWord] >> lastBit) & 1;
+            uint64_t toRight = left & ~right & (o[lastWord] >> lastBit);
+            uint64_t toLeft = right & ~left & o[0];
+            r[lastWord] |= toRight << lastBit;
+            r[0] |= toLeft & 1;
+            grew |= toRight | (toLeft & 1);
+        }
+        if (!grew) {
+            return;
+        }
+    }
+}
+
+// Number of open cells reachable from (x, y), the start included, across
+// the edges if wrap is set. reach is scratch space and holds the reached
+// region afterwards.
+inline int reachableArea(const Bitboard& open, int x, int y, Bitboard& reach, bool wrap = false) {
+    if (reach.width != open.width || reach.height != open.height) {
+        reach.resize(open.width, open.height);
+    } else {
+        std::fill(reach.bits.begin(), reach.bits.end(), 0);
+    }
+    if (!open.get(x, y)) {
+        return 0;
+    }
+    reach.set(x, y);
+    if (wrap) {
+        floodFillWrapped(reach, open);
+    } else {
+        floodFill(reach, open, y, y);
+    }
+    return reach.count();
+}
+
+inline int reachableArea(const Bitboard& open, int x, int y) {
+    Bitboard reach;
+    return reachableArea(open, x, y, reach);
+}
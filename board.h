@@ -0,0 +1,310 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+enum class Direction { UP, DOWN, LEFT, RIGHT };
+
+struct Rng {
+    uint64_t state;
+
+    explicit Rng(uint64_t seed = 1) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    int below(int n) {
+        return static_cast<int>((next() >> 32) * static_cast<uint64_t>(n) >> 32);
+    }
+};
+
+// Static part of a board: size in cells, which cells hold obstacles and
+// whether the edges wrap round (leaving one edge re-enters on the opposite one).
+struct Layout {
+    int width = 0;
+    int height = 0;
+    bool wrap = false;
+    std::vector<uint8_t> blocked;
+    // Optional tables for the static walls, from distfield.h: steps between
+    // any two cells going round the walls, and from each cell to the nearest
+    // wall or edge. Borrowed, not owned; see pathDistance().
+    const uint16_t* pathSteps = nullptr;
+    const uint16_t* wallSteps = nullptr;
+
+    Layout() {}
+    Layout(int w, int h) : width(w), height(h), blocked(static_cast<size_t>(w) * h, 0) {}
+
+    int cells() const { return width * height; }
+    int cell(int x, int y) const { return y * width + x; }
+};
+
+// c brought back into [0, n) on a wrapped axis, for any c within one board
+// length of it. Masks rather than branches, so stepping off an edge costs
+// the same as any other step; c already in range comes back unchanged.
+inline int wrapCoord(int c, int n) {
+    return c + (n & -static_cast<int>(c < 0)) - (n & -static_cast<int>(c >= n));
+}
+
+// The neighbour of cell in direction d, or -1 off the edge of a board that
+// does not wrap.
+inline int stepCell(const Layout& layout, int cell, Direction d) {
+    static const int dx[4] = { 0, 0, -1, 1 };
+    static const int dy[4] = { -1, 1, 0, 0 };
+    int w = layout.width, n = layout.cells();
+    int x = cell % w + dx[static_cast<int>(d)];
+    int next = cell + dx[static_cast<int>(d)] + dy[static_cast<int>(d)] * w;
+    if (layout.wrap) {
+        // Back into the same row first, then onto the board.
+        if (static_cast<unsigned>(x) >= static_cast<unsigned>(w)) {
+            next += x < 0 ? w : -w;
+        }
+        if (static_cast<unsigned>(next) >= static_cast<unsigned>(n)) {
+            next += next < 0 ? n : -n;
+        }
+        return next;
+    }
+    bool inside = static_cast<unsigned>(x) < static_cast<unsigned>(w) && static_cast<unsigned>(next) < static_cast<unsigned>(n);
+    return inside ? next : -1;
+}
+
+// from and to must be neighbours; on a wrapped board that includes the
+// cells facing each other across an edge.
+inline Direction directionTo(const Layout& layout, int from, int to) {
+    int dx = to % layout.width - from % layout.width;
+    int dy = to / layout.width - from / layout.width;
+    if (dx == 1 || dx == 1 - layout.width) return Direction::RIGHT;
+    if (dx == -1 || dx == layout.width - 1) return Direction::LEFT;
+    if (dy == 1 || dy == 1 - layout.height) return Direction::DOWN;
+    return Direction::UP;
+}
+
+// Steps from a to b on an empty board, the short way round if it wraps.
+inline int cellDistance(const Layout& layout, int a, int b) {
+    int dx = std::abs(a % layout.width - b % layout.width);
+    int dy = std::abs(a / layout.width - b / layout.width);
+    if (layout.wrap) {
+        dx = std::min(dx, layout.width - dx);
+        dy = std::min(dy, layout.height - dy);
+    }
+    return dx + dy;
+}
+
+const int PATH_UNREACHABLE = 0xFFFF;
+
+// Steps from a to b around the static walls when the layout has distance
+// tables (PATH_UNREACHABLE if there is no way through), else cellDistance().
+inline int pathDistance(const Layout& layout, int a, int b) {
+    if (layout.pathSteps != nullptr) {
+        return layout.pathSteps[static_cast<size_t>(a) * layout.cells() + b];
+    }
+    return cellDistance(layout, a, b);
+}
+
+// Headless copy of the rules in Task_201.cpp's update(): the snake dies on
+// the board edge (unless the layout wraps), an obstacle or any of its own
+// segments (tail included), and every tenth food on average is a bonus
+// worth 5.
+struct Game {
+    const Layout* layout = nullptr;
+    const uint8_t* foodMask = nullptr;
+    std::vector<uint8_t> occupied;
+    std::vector<int> body;
+    int headIndex = 0;
+    int length = 0;
+    int food = -1;
+    bool foodBonus = false;
+    int score = 0;
+    int moves = 0;
+    bool over = false;
+    bool won = false;
+    Direction direction = Direction::RIGHT;
+    Rng rng;
+
+    void reset(const Layout& l, uint64_t seed) {
+        layout = &l;
+        occupied.assign(l.cells(), 0);
+        body.assign(l.cells(), -1);
+        headIndex = 0;
+        length = 0;
+        score = 0;
+        moves = 0;
+        over = false;
+        won = false;
+        direction = Direction::RIGHT;
+        rng = Rng(seed);
+    }
+
+    // Same starting snake as resetGame(): three cells, head in the middle, facing right.
+    void placeDefaultSnake() {
+        int cx = layout->width / 2;
+        int cy = layout->height / 2;
+        for (int i = 2; i >= 0; i--) {
+            pushHead(layout->cell(cx - i, cy));
+        }
+        direction = Direction::RIGHT;
+    }
+
+    int head() const { return body[headIndex]; }
+    int tail() const { return segment(length - 1); }
+    int segment(int i) const {
+        int n = static_cast<int>(body.size());
+        int idx = headIndex + i;
+        return body[idx >= n ? idx - n : idx];
+    }
+
+    bool isFree(int cell) const {
+        return cell >= 0 && !layout->blocked[cell] && !occupied[cell];
+    }
+
+    void pushHead(int cell) {
+        headIndex = headIndex == 0 ? static_cast<int>(body.size()) - 1 : headIndex - 1;
+        body[headIndex] = cell;
+        occupied[cell] = 1;
+        length++;
+    }
+
+    int popTail() {
+        int cell = tail();
+        occupied[cell] = 0;
+        length--;
+        return cell;
+    }
+
+    bool canHoldFood(int cell) const {
+        return isFree(cell) && (foodMask == nullptr || foodMask[cell]);
+    }
+
+    // Rejection sampling while the board is mostly empty, then a uniform pick
+    // among the remaining free cells so a nearly full board cannot spin forever.
+    void spawnFood(bool isBonus) {
+        int n = layout->cells();
+        for (int tries = 0; tries < 64; tries++) {
+            int c = rng.below(n);
+            if (canHoldFood(c)) {
+                food = c;
+                foodBonus = isBonus;
+                return;
+            }
+        }
+        int freeCells = 0;
+        for (int c = 0; c < n; c++) {
+            freeCells += canHoldFood(c);
+        }
+        if (freeCells == 0) {
+            food = -1;
+            won = true;
+            over = true;
+            return;
+        }
+        int pick = rng.below(freeCells);
+        for (int c = 0; c < n; c++) {
+            if (canHoldFood(c) && pick-- == 0) {
+                food = c;
+                foodBonus = isBonus;
+                return;
+            }
+        }
+    }
+
+    // Everything makeMove() changes that it cannot work out again on undo.
+    struct Undo {
+        int food;
+        bool foodBonus;
+        int score;
+        int tail;
+        bool ate;
+        bool over;
+        bool won;
+        Direction direction;
+        Rng rng;
+    };
+
+    // Same as step(), but records what unmakeMove() needs. With spawn false
+    // an eaten food is not replaced (food becomes -1), so a caller can place
+    // it itself.
+    void makeMove(Direction d, Undo& u, bool spawn = true) {
+        u.food = food;
+        u.foodBonus = foodBonus;
+        u.score = score;
+        u.tail = -1;
+        u.ate = false;
+        u.over = over;
+        u.won = won;
+        u.direction = direction;
+        u.rng = rng;
+        if (over) {
+            return;
+        }
+        direction = d;
+        moves++;
+        int next = stepCell(*layout, head(), d);
+        if (!isFree(next)) {
+            over = true;
+            return;
+        }
+        pushHead(next);
+        if (next == food) {
+            u.ate = true;
+            score += foodBonus ? 5 : 1;
+            if (spawn) {
+                spawnFood(rng.below(10) == 0);
+            } else {
+                food = -1;
+            }
+        } else {
+            u.tail = popTail();
+        }
+    }
+
+    void unmakeMove(const Undo& u) {
+        if (u.over) {
+            return;
+        }
+        moves--;
+        if (u.tail >= 0) {
+            int n = static_cast<int>(body.size());
+            int idx = headIndex + length;
+            body[idx >= n ? idx - n : idx] = u.tail;
+            occupied[u.tail] = 1;
+            length++;
+        }
+        if (u.ate || u.tail >= 0) {
+            occupied[head()] = 0;
+            headIndex = headIndex + 1 == static_cast<int>(body.size()) ? 0 : headIndex + 1;
+            length--;
+        }
+        food = u.food;
+        foodBonus = u.foodBonus;
+        score = u.score;
+        over = u.over;
+        won = u.won;
+        direction = u.direction;
+        rng = u.rng;
+    }
+
+    void step(Direction d) {
+        Undo u;
+        makeMove(d, u);
+    }
+};
+
+// Mirrors generateObstacles(): count obstacles dropped uniformly on cells the
+// snake does not occupy.
+inline void scatterObstacles(Layout& layout, const Game& game, int count, Rng& rng) {
+    for (int i = 0; i < count; i++) {
+        for (;;) {
+            int c = rng.below(layout.cells());
+            if (!layout.blocked[c] && !game.occupied[c]) {
+                layout.blocked[c] = 1;
+                break;
+            }
+        }
+    }
+}
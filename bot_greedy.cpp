@@ -0,0 +1,48 @@
+#include "bot_plugin.h"
+
+#include <cstdlib>
+
+// Example plugin: heads for the food by Manhattan distance, avoiding walls,
+// obstacles and every segment of its body, tail included: update() checks
+// the next cell before the tail moves, so the tail kills too.
+
+struct GreedyBot {
+    uint64_t state;
+};
+
+static void* create(uint64_t seed) {
+    return new GreedyBot{ seed * 0x9E3779B97F4A7C15ull + 1 };
+}
+
+static void destroy(void* bot) {
+    delete static_cast<GreedyBot*>(bot);
+}
+
+static int move(void* bot, const SnakeBoardView* v) {
+    GreedyBot* b = static_cast<GreedyBot*>(bot);
+    int head = v->body[0];
+    int hx = head % v->width, hy = head / v->width;
+    static const int dx[4] = { 0, 0, -1, 1 };
+    static const int dy[4] = { -1, 1, 0, 0 };
+    int best = v->direction, bestDist = 1 << 30;
+    for (int d = 0; d < 4; d++) {
+        int x = hx + dx[d], y = hy + dy[d];
+        if (x < 0 || y < 0 || x >= v->width || y >= v->height) continue;
+        int c = y * v->width + x;
+        if (v->blocked[c] || v->occupied[c]) continue;
+        int dist = v->food < 0 ? 0 : std::abs(v->food % v->width - x) + std::abs(v->food / v->width - y);
+        b->state = b->state * 6364136223846793005ull + 1442695040888963407ull;
+        dist = dist * 4 + static_cast<int>(b->state >> 62);
+        if (dist < bestDist) {
+            bestDist = dist;
+            best = d;
+        }
+    }
+    return best;
+}
+
+static const SnakeBotApi api = { SNAKE_BOT_API_VERSION, "greedy", create, destroy, move };
+
+extern "C" SNAKE_BOT_EXPORT const SnakeBotApi* snake_bot_api(void) {
+    return &api;
+}
@@ -0,0 +1,48 @@
+#include "bot_plugin.h"
+#include "board.h"
+#include "heuristic.h"
+
+// Example plugin wrapping HeuristicBot: the view is copied into a Game so the
+// bot runs unchanged. Weights come from bot_weights.txt when present.
+
+struct HeuristicPlugin {
+    Layout layout;
+    Game game;
+    HeuristicBot bot;
+};
+
+static void* create(uint64_t seed) {
+    HeuristicPlugin* p = new HeuristicPlugin;
+    p->bot.load("bot_weights.txt");
+    p->game.rng = Rng(seed);
+    return p;
+}
+
+static void destroy(void* bot) {
+    delete static_cast<HeuristicPlugin*>(bot);
+}
+
+static int move(void* bot, const SnakeBoardView* v) {
+    HeuristicPlugin* p = static_cast<HeuristicPlugin*>(bot);
+    Layout& l = p->layout;
+    Game& g = p->game;
+    l.width = v->width;
+    l.height = v->height;
+    l.blocked.assign(v->blocked, v->blocked + l.cells());
+    g.reset(l, g.rng.state);
+    for (int i = v->length - 1; i >= 0; i--) {
+        g.pushHead(v->body[i]);
+    }
+    g.food = v->food;
+    g.foodBonus = v->foodBonus != 0;
+    g.score = v->score;
+    g.moves = v->moves;
+    g.direction = static_cast<Direction>(v->direction);
+    return static_cast<int>(p->bot.choose(g));
+}
+
+static const SnakeBotApi api = { SNAKE_BOT_API_VERSION, "heuristic", create, destroy, move };
+
+extern "C" SNAKE_BOT_EXPORT const SnakeBotApi* snake_bot_api(void) {
+    return &api;
+}
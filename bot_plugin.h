@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+// C interface for bots built as shared libraries (.so, or .dll on Windows)
+// and loaded by tournament at run time. A plugin exports one function,
+// snake_bot_api(), returning a table that stays valid while it is loaded.
+// Everything in the view is owned by the host and read-only; it is only
+// valid for the duration of the move() call.
+
+#define SNAKE_BOT_API_VERSION 1
+
+// Same order as Direction in board.h.
+enum { SNAKE_UP = 0, SNAKE_DOWN = 1, SNAKE_LEFT = 2, SNAKE_RIGHT = 3 };
+
+typedef struct SnakeBoardView {
+    int width;
+    int height;
+    const uint8_t* blocked;   // width * height, 1 for obstacles
+    const uint8_t* occupied;  // width * height, 1 for snake segments
+    const int* body;          // length cells, head first; cell = y * width + x
+    int length;
+    int food;                 // cell, or -1 when there is none
+    int foodBonus;            // 1 if the food is worth 5
+    int score;
+    int moves;
+    int direction;            // last move made
+} SnakeBoardView;
+
+typedef struct SnakeBotApi {
+    int version;              // SNAKE_BOT_API_VERSION
+    const char* name;
+    // One instance per game; a bot may keep state between moves in it.
+    void* (*create)(uint64_t seed);
+    void (*destroy)(void* bot);
+    // Returns SNAKE_UP..SNAKE_RIGHT. Anything else loses the game.
+    int (*move)(void* bot, const SnakeBoardView* view);
+} SnakeBotApi;
+
+#ifdef _WIN32
+#define SNAKE_BOT_EXPORT __declspec(dllexport)
+#else
+#define SNAKE_BOT_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef const SnakeBotApi* (*SnakeBotEntry)(void);
+
+#ifdef __cplusplus
+}
+#endif
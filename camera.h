@@ -0,0 +1,104 @@
+#pragma once
+
+#include "board.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Start of a window `screen` long following `head` along one axis of a board
+// `board` long: centred on the head, but never past either end of the board.
+inline int followAxis(int head, int board, int screen) {
+    return std::max(0, std::min(head - screen / 2, board - screen));
+}
+
+// Low-resolution picture of a board too large for the window. Each pixel
+// covers a scale x scale block of cells and keeps a count of the snake
+// segments and walls in it; callers report every change with addSnake() and
+// addWall(), which repaint just that pixel and grow the dirty rectangle. Only
+// reset() looks at the whole board, so keeping the picture current costs the
+// same however large the board is.
+class Minimap {
+public:
+    int width = 0, height = 0;
+    int scale = 1;                  // cells per pixel along each axis
+    std::vector<uint32_t> pixels;   // ARGB8888, width * height
+
+    static const uint32_t EMPTY = 0xFF101010;
+    static const uint32_t SNAKE = 0xFF40E040;
+
+    // Picks the smallest scale that fits the board in maxWidth x maxHeight
+    // and counts the walls of `layout`; the whole picture starts dirty.
+    void reset(const Layout& layout, int maxWidth, int maxHeight) {
+        scale = std::max((layout.width + maxWidth - 1) / maxWidth, (layout.height + maxHeight - 1) / maxHeight);
+        scale = std::max(scale, 1);
+        width = (layout.width + scale - 1) / scale;
+        height = (layout.height + scale - 1) / scale;
+        snake_.assign(static_cast<size_t>(width) * height, 0);
+        walls_.assign(static_cast<size_t>(width) * height, 0);
+        pixels.assign(static_cast<size_t>(width) * height, EMPTY);
+        for (int y = 0; y < layout.height; y++) {
+            int* row = &walls_[static_cast<size_t>(y / scale) * width];
+            const uint8_t* blocked = &layout.blocked[static_cast<size_t>(y) * layout.width];
+            for (int x = 0; x < layout.width; x++) {
+                row[x / scale] += blocked[x] != 0;
+            }
+        }
+        for (int p = 0; p < width * height; p++) {
+            pixels[p] = colour(p);
+        }
+        dirtyX0_ = 0;
+        dirtyY0_ = 0;
+        dirtyX1_ = width;
+        dirtyY1_ = height;
+    }
+
+    // (x, y) in cells; delta is +1 when something arrives, -1 when it leaves.
+    void addSnake(int x, int y, int delta) { touch(x / scale, y / scale, snake_, delta); }
+    void addWall(int x, int y, int delta) { touch(x / scale, y / scale, walls_, delta); }
+
+    // The rectangle of pixels changed since the last call, in pixels; false
+    // if nothing changed.
+    bool takeDirty(int& x, int& y, int& w, int& h) {
+        if (dirtyX0_ >= dirtyX1_) {
+            return false;
+        }
+        x = dirtyX0_;
+        y = dirtyY0_;
+        w = dirtyX1_ - dirtyX0_;
+        h = dirtyY1_ - dirtyY0_;
+        dirtyX0_ = dirtyY0_ = 1 << 30;
+        dirtyX1_ = dirtyY1_ = 0;
+        return true;
+    }
+
+private:
+    // Snake over walls; walls shaded by how much of the block they fill.
+    uint32_t colour(int p) const {
+        if (snake_[p] > 0) {
+            return SNAKE;
+        }
+        if (walls_[p] == 0) {
+            return EMPTY;
+        }
+        uint32_t v = 0x50 + static_cast<uint32_t>(0xA0 * walls_[p] / (scale * scale));
+        return 0xFF000000 | v << 16 | v << 8 | v;
+    }
+
+    void touch(int px, int py, std::vector<int>& counts, int delta) {
+        int p = py * width + px;
+        counts[p] += delta;
+        uint32_t c = colour(p);
+        if (c == pixels[p]) {
+            return;
+        }
+        pixels[p] = c;
+        dirtyX0_ = std::min(dirtyX0_, px);
+        dirtyY0_ = std::min(dirtyY0_, py);
+        dirtyX1_ = std::max(dirtyX1_, px + 1);
+        dirtyY1_ = std::max(dirtyY1_, py + 1);
+    }
+
+    std::vector<int> snake_, walls_;
+    int dirtyX0_ = 0, dirtyY0_ = 0, dirtyX1_ = 0, dirtyY1_ = 0;
+};
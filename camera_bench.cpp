@@ -0,0 +1,127 @@
+#include "board.h"
+#include "camera.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static const int VIEW_WIDTH = 40, VIEW_HEIGHT = 30;
+static const int SNAKE_LENGTH = 400;
+
+static double us(Clock::duration d) {
+    return chrono::duration<double, micro>(d).count();
+}
+
+struct Result {
+    double tick, frame, naive;
+    bool ok;
+};
+
+// A snake walking the board with the game's per-tick bookkeeping (occupancy
+// grid and minimap), and per frame what render() does with it: place the
+// camera, visit the cells under the window, upload the minimap's dirty
+// rectangle into a stand-in texture. "naive" is the old way of drawing,
+// visiting every wall and every segment.
+static Result run(int width, int height, int frames) {
+    Rng rng(width * 31 + height);
+    Layout layout(width, height);
+    vector<int> walls;
+    for (int c = 0; c < layout.cells(); c++) {
+        if (rng.below(100) < 4) {
+            layout.blocked[c] = 1;
+            walls.push_back(c);
+        }
+    }
+    vector<uint16_t> snakeCells(layout.cells(), 0);
+    Minimap minimap;
+    minimap.reset(layout, 200, 150);
+    vector<uint32_t> texture(minimap.pixels.size(), 0);
+    deque<int> snake;
+    int x = width / 2, y = height / 2, dx = 1, dy = 0;
+
+    Clock::duration tickTime{}, frameTime{}, naiveTime{};
+    long long drawn = 0, naiveDrawn = 0;
+    for (int f = 0; f < frames; f++) {
+        auto start = Clock::now();
+        if (rng.below(8) == 0) {
+            int turn = rng.below(2) ? 1 : -1;
+            int ndx = dy * turn, ndy = -dx * turn;
+            dx = ndx;
+            dy = ndy;
+        }
+        if (x + dx < 0 || x + dx >= width) dx = -dx;
+        if (y + dy < 0 || y + dy >= height) dy = -dy;
+        x += dx;
+        y += dy;
+        int head = layout.cell(x, y);
+        snake.push_front(head);
+        snakeCells[head]++;
+        minimap.addSnake(x, y, 1);
+        if (static_cast<int>(snake.size()) > SNAKE_LENGTH) {
+            int tail = snake.back();
+            snake.pop_back();
+            snakeCells[tail]--;
+            minimap.addSnake(tail % width, tail / width, -1);
+        }
+        auto ticked = Clock::now();
+
+        int viewX = followAxis(x, width, VIEW_WIDTH), viewY = followAxis(y, height, VIEW_HEIGHT);
+        int x1 = min(width, viewX + VIEW_WIDTH), y1 = min(height, viewY + VIEW_HEIGHT);
+        for (int cy = viewY; cy < y1; cy++) {
+            const uint8_t* row = &layout.blocked[static_cast<size_t>(cy) * width];
+            const uint16_t* body = &snakeCells[static_cast<size_t>(cy) * width];
+            for (int cx = viewX; cx < x1; cx++) {
+                drawn += (row[cx] != 0) + (body[cx] != 0);
+            }
+        }
+        int rx, ry, rw, rh;
+        if (minimap.takeDirty(rx, ry, rw, rh)) {
+            for (int r = ry; r < ry + rh; r++) {
+                memcpy(&texture[static_cast<size_t>(r) * minimap.width + rx], &minimap.pixels[static_cast<size_t>(r) * minimap.width + rx], rw * 4);
+            }
+        }
+        auto framed = Clock::now();
+
+        for (int c : walls) {
+            int wx = c % width - viewX, wy = c / width - viewY;
+            naiveDrawn += wx >= 0 && wx < VIEW_WIDTH && wy >= 0 && wy < VIEW_HEIGHT;
+        }
+        for (int c : snake) {
+            int sx = c % width - viewX, sy = c / width - viewY;
+            naiveDrawn += sx >= 0 && sx < VIEW_WIDTH && sy >= 0 && sy < VIEW_HEIGHT;
+        }
+        auto naived = Clock::now();
+        tickTime += ticked - start;
+        frameTime += framed - ticked;
+        naiveTime += naived - framed;
+    }
+
+    // The incrementally kept minimap must match one built from scratch, and
+    // the texture must hold what was uploaded.
+    Minimap fresh;
+    fresh.reset(layout, 200, 150);
+    for (int c : snake) {
+        fresh.addSnake(c % width, c / width, 1);
+    }
+    bool ok = fresh.pixels == minimap.pixels && texture == minimap.pixels && drawn > 0 && naiveDrawn > 0;
+    return { us(tickTime) / frames, us(frameTime) / frames, us(naiveTime) / frames, ok };
+}
+
+int main() {
+    static const int sizes[][2] = { { 40, 30 }, { 400, 300 }, { 2000, 1500 }, { 4000, 3000 } };
+    bool ok = true;
+    for (const auto& s : sizes) {
+        int frames = s[0] * s[1] > 1000000 ? 2000 : 20000;
+        Result r = run(s[0], s[1], frames);
+        printf("%5dx%-5d (%8d cells): tick %5.2f us  culled frame %6.2f us  draw-everything frame %9.2f us  %s\n",
+               s[0], s[1], s[0] * s[1], r.tick, r.frame, r.naive, r.ok ? "ok" : "MISMATCH");
+        ok = ok && r.ok;
+    }
+    return ok ? 0 : 1;
+}
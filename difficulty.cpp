@@ -0,0 +1,275 @@
+#include "board.h"
+#include "difficulty.h"
+#include "levels.h"
+#include "maze.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Judges layouts by estimateDifficulty(): every level of a catalog, or a
+// batch of generated candidates ranked so a generator can keep the ones it
+// wants and drop the unfair ones (too many games lost at the start).
+
+struct Options {
+    string levels;
+    string generate;
+    int count = 0;
+    int width = 40;
+    int height = 30;
+    int samples = 3;
+    int keep = 0;
+    double maxEarly = FAIR_MAX_EARLY;
+    double target = -1;
+    bool curve = false;
+    string weights = "bot_weights.txt";
+    bool weightsGiven = false;
+    DifficultyOptions run;
+};
+
+struct Candidate {
+    string name;
+    Layout layout;
+    SpawnPoint spawn;
+    DifficultyReport report;
+};
+
+static const int MOVER_AREA = 40 * 30;
+// The game's densities for mazes the player picks with the g key.
+static const float MAZE_DENSITY[MAZE_STYLES] = { 0.5f, 0.4f, 0.3f };
+
+// The cells the snake starts on and the run ahead of it are cleared, as the
+// game's generateMazeLevel() does.
+static void clearStart(Layout& l, SpawnPoint spawn) {
+    static const int dx[4] = { 0, 0, -1, 1 }, dy[4] = { -1, 1, 0, 0 };
+    int d = static_cast<int>(spawn.direction);
+    int x = spawn.head % l.width, y = spawn.head / l.width;
+    for (int i = -3; i <= 5; i++) {
+        int cx = x + i * dx[d], cy = y + i * dy[d];
+        if (cx >= 0 && cx < l.width && cy >= 0 && cy < l.height) {
+            l.blocked[l.cell(cx, cy)] = 0;
+        }
+    }
+}
+
+// Obstacles dropped anywhere but on the snake, like the game's random
+// movers; judged where they start, since the headless game has no movers.
+static void scatter(Layout& l, SpawnPoint spawn, int count, uint64_t seed) {
+    Game g;
+    g.reset(l, seed);
+    difficulty_detail::placeSnake(g, l, spawn);
+    Rng rng(seed ^ 0xA5A5A5A5ull);
+    int open = 0;
+    for (uint8_t b : l.blocked) {
+        open += b == 0;
+    }
+    scatterObstacles(l, g, min(count, open - 3), rng);
+}
+
+static bool parseStyle(const string& name, MazeStyle& style) {
+    static const char* names[] = { "rooms", "caves", "braided" };
+    for (int s = 0; s < MAZE_STYLES; s++) {
+        if (name == names[s]) {
+            style = static_cast<MazeStyle>(s);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void generated(const Options& opt, vector<Candidate>& out) {
+    for (int i = 0; i < opt.count; i++) {
+        uint64_t seed = opt.run.seed + i;
+        Candidate c;
+        c.layout = Layout(opt.width, opt.height);
+        c.spawn = { c.layout.cell(opt.width / 2, opt.height / 2), Direction::RIGHT };
+        MazeStyle style;
+        if (parseStyle(opt.generate, style)) {
+            generateMaze(c.layout, style, MAZE_DENSITY[style], seed);
+            clearStart(c.layout, c.spawn);
+        }
+        else {
+            scatter(c.layout, c.spawn, 15 * opt.width * opt.height / MOVER_AREA, seed);
+        }
+        c.name = opt.generate + " #" + to_string(seed);
+        out.push_back(std::move(c));
+    }
+}
+
+// A fixed level as stored; a level taking the player's board size on
+// --size, `samples` times when it is generated.
+static bool fromCatalog(const Options& opt, vector<Candidate>& out) {
+    LevelCatalog catalog;
+    string error;
+    bool ok;
+    if (opt.levels.size() > 4 && opt.levels.compare(opt.levels.size() - 4, 4, ".txt") == 0) {
+        string text;
+        vector<uint8_t> bytes;
+        ok = readTextFile(opt.levels.c_str(), text) && compileLevels(text, bytes, error) && catalog.adopt(std::move(bytes), error);
+    }
+    else {
+        ok = catalog.open(opt.levels.c_str(), error);
+    }
+    if (!ok) {
+        printf("%s: %s\n", opt.levels.c_str(), error.empty() ? "cannot read" : error.c_str());
+        return false;
+    }
+    for (int i = 0; i < catalog.count(); i++) {
+        const LevelInfo& info = catalog.level(i);
+        bool generatedLevel = info.width == 0 && (info.mazeStyle >= 0 || info.randomMovers > 0);
+        int samples = generatedLevel ? opt.samples : 1;
+        for (int s = 0; s < samples; s++) {
+            uint64_t seed = opt.run.seed + s;
+            Candidate c;
+            int w = info.width ? static_cast<int>(info.width) : opt.width;
+            int h = info.width ? static_cast<int>(info.height) : opt.height;
+            c.layout = Layout(w, h);
+            if (info.width != 0) {
+                catalog.loadWalls(i, c.layout.blocked);
+            }
+            int x = info.spawnX < 0 ? w / 2 : info.spawnX, y = info.spawnY < 0 ? h / 2 : info.spawnY;
+            c.spawn = { c.layout.cell(x, y), static_cast<Direction>(info.spawnDirection) };
+            if (info.mazeStyle >= 0) {
+                Layout maze(w, h);
+                generateMaze(maze, static_cast<MazeStyle>(info.mazeStyle), info.mazeDensity, seed);
+                clearStart(maze, c.spawn);
+                for (int cell = 0; cell < maze.cells(); cell++) {
+                    c.layout.blocked[cell] |= maze.blocked[cell];
+                }
+            }
+            const LevelMover* movers = catalog.movers(i);
+            for (uint32_t m = 0; m < info.moverCount; m++) {
+                c.layout.blocked[c.layout.cell(movers[m].x, movers[m].y)] = 1;
+            }
+            scatter(c.layout, c.spawn, static_cast<int>(static_cast<long long>(info.randomMovers) * w * h / MOVER_AREA), seed);
+            c.name = info.name + (samples > 1 ? " #" + to_string(seed) : string());
+            out.push_back(std::move(c));
+        }
+    }
+    return true;
+}
+
+static void print(const Options& opt, const Candidate& c, bool rejected) {
+    const DifficultyReport& r = c.report;
+    printf("%-26s difficulty %.3f  early deaths %5.1f%%%s  ", c.name.c_str(), r.difficulty, 100 * r.earlyDeaths, rejected ? " REJECT" : "       ");
+    for (int b = 0; b < REFERENCE_BOTS; b++) {
+        printf(" %s %5.1f food %3.0f%% alive", referenceBotName(b), r.bots[b].meanScore(), 100 * r.bots[b].survival(opt.run.maxMoves));
+    }
+    printf("  (%.0f ms)\n", r.seconds * 1000);
+    if (opt.curve) {
+        for (int b = 0; b < REFERENCE_BOTS; b++) {
+            printf("    %-9s alive after", referenceBotName(b));
+            for (int k = 1; k <= 10; k++) {
+                int m = opt.run.maxMoves * k / 10;
+                printf(" %d:%.2f", m, r.bots[b].survival(m));
+            }
+            printf("\n");
+        }
+    }
+}
+
+static bool parseOptions(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--curve") {
+            opt.curve = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--levels") opt.levels = value;
+        else if (arg == "--generate") {
+            opt.generate = value;
+            if (i + 1 >= argc) return false;
+            opt.count = atoi(argv[++i]);
+        }
+        else if (arg == "--size") { if (sscanf(value, "%dx%d", &opt.width, &opt.height) != 2) return false; }
+        else if (arg == "--games") opt.run.gamesPerBot = atoi(value);
+        else if (arg == "--moves") opt.run.maxMoves = atoi(value);
+        else if (arg == "--early") opt.run.earlyMoves = atoi(value);
+        else if (arg == "--threads") opt.run.threads = atoi(value);
+        else if (arg == "--seed") opt.run.seed = strtoull(value, nullptr, 10);
+        else if (arg == "--samples") opt.samples = atoi(value);
+        else if (arg == "--keep") opt.keep = atoi(value);
+        else if (arg == "--max-early") opt.maxEarly = atof(value);
+        else if (arg == "--target") opt.target = atof(value);
+        else if (arg == "--weights") {
+            opt.weights = value;
+            opt.weightsGiven = true;
+        }
+        else return false;
+    }
+    MazeStyle style;
+    bool knownStyle = opt.generate.empty() || opt.generate == "obstacles" || parseStyle(opt.generate, style);
+    return opt.levels.empty() != opt.generate.empty() && knownStyle && opt.run.gamesPerBot >= 1 && opt.run.maxMoves >= 1 &&
+           opt.width >= 8 && opt.height >= 4 && opt.samples >= 1 && (opt.generate.empty() || opt.count >= 1);
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        printf("usage: difficulty --levels levels.bin|levels.txt [--samples N]\n"
+               "       difficulty --generate rooms|caves|braided|obstacles COUNT [--keep N] [--max-early SHARE] [--target D]\n"
+               "                  [--size WxH] [--games N] [--moves N] [--early N] [--threads N] [--seed N] [--curve]\n"
+               "                  [--weights FILE]\n");
+        return 1;
+    }
+    // The heuristic bot plays with the trainer's weights, as in the game;
+    // without the default file it keeps its own.
+    HeuristicBot trained;
+    if (trained.load(opt.weights)) {
+        opt.run.heuristicWeights = trained.weights;
+    }
+    else if (opt.weightsGiven) {
+        fprintf(stderr, "difficulty: cannot read weights from %s\n", opt.weights.c_str());
+        return 1;
+    }
+    else {
+        printf("no %s, the heuristic bot keeps its default weights\n", opt.weights.c_str());
+    }
+    vector<Candidate> candidates;
+    if (!opt.levels.empty()) {
+        if (!fromCatalog(opt, candidates)) {
+            return 1;
+        }
+    }
+    else {
+        generated(opt, candidates);
+    }
+
+    double slowest = 0, total = 0;
+    for (Candidate& c : candidates) {
+        c.report = estimateDifficulty(c.layout, c.spawn, opt.run);
+        slowest = max(slowest, c.report.seconds);
+        total += c.report.seconds;
+    }
+    // Generated candidates come out ranked: easiest first, or nearest to the
+    // target difficulty first, the rejected ones last.
+    if (!opt.generate.empty()) {
+        stable_sort(candidates.begin(), candidates.end(), [&](const Candidate& a, const Candidate& b) {
+            bool ra = a.report.earlyDeaths > opt.maxEarly, rb = b.report.earlyDeaths > opt.maxEarly;
+            if (ra != rb) return rb;
+            if (opt.target >= 0) return fabs(a.report.difficulty - opt.target) < fabs(b.report.difficulty - opt.target);
+            return a.report.difficulty < b.report.difficulty;
+        });
+    }
+    int shown = 0;
+    for (const Candidate& c : candidates) {
+        bool rejected = c.report.earlyDeaths > opt.maxEarly;
+        if (opt.keep > 0 && (rejected || shown >= opt.keep)) {
+            continue;
+        }
+        print(opt, c, rejected);
+        shown++;
+    }
+    printf("%zu layouts, %d games each (%d per bot, up to %d moves): %.0f ms per layout on average, %.0f ms at most\n",
+           candidates.size(), REFERENCE_BOTS * opt.run.gamesPerBot, opt.run.gamesPerBot, opt.run.maxMoves,
+           1000 * total / max<size_t>(1, candidates.size()), 1000 * slowest);
+    return 0;
+}
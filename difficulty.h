@@ -0,0 +1,243 @@
+#pragma once
+
+#include "board.h"
+#include "distfield.h"
+#include "heuristic.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Monte Carlo difficulty of one layout: hundreds of headless games from the
+// same start by a few reference bots, from a bot that only avoids dying on
+// the spot up to the heuristic one, with trainer's weights when given. What
+// comes out is how long the snake lasts (a survival curve per bot) and how
+// much it eats, boiled down to one difficulty number for ranking, plus the
+// share of games lost in the first few moves, which is what an unfair start
+// (a wall just ahead, a dead end around the spawn) looks like.
+enum ReferenceBot { BOT_RANDOM, BOT_GREEDY, BOT_HEURISTIC, REFERENCE_BOTS };
+
+inline const char* referenceBotName(int bot) {
+    static const char* names[] = { "random", "greedy", "heuristic" };
+    return names[bot];
+}
+
+// A start is unfair when more than this share of games are lost within
+// earlyMoves; the difficulty tool and the game's own check both use it.
+const double FAIR_MAX_EARLY = 0.02;
+
+// 300 games a bot keep a 40x30 layout under a second on one core.
+struct DifficultyOptions {
+    int gamesPerBot = 300;
+    int maxMoves = 400;    // a game still going after this many moves survived
+    int earlyMoves = 20;   // deaths this soon count as the layout's fault
+    int threads = 0;       // 0 for one per hardware thread
+    uint64_t seed = 1;
+    // The heuristic bot's weights; empty for HeuristicBot's defaults.
+    std::vector<double> heuristicWeights;
+    // Without distance tables the greedy bot goes by straight-line
+    // distance, which is all a quick check needs.
+    bool buildTables = true;
+};
+
+struct BotResult {
+    std::vector<int> deaths;   // deaths[m]: games lost on move m
+    long long score = 0;
+    int games = 0;
+    int early = 0;
+
+    // Share of the games still going after `moves` moves.
+    double survival(int moves) const {
+        int dead = 0;
+        for (int m = 0; m <= moves && m < static_cast<int>(deaths.size()); m++) {
+            dead += deaths[m];
+        }
+        return games ? 1.0 - static_cast<double>(dead) / games : 0.0;
+    }
+
+    // Mean of survival() over the whole game, the area under the curve.
+    double area() const {
+        double sum = 0;
+        int dead = 0;
+        for (size_t m = 0; m < deaths.size(); m++) {
+            dead += deaths[m];
+            sum += games ? 1.0 - static_cast<double>(dead) / games : 0.0;
+        }
+        return deaths.empty() ? 0.0 : sum / deaths.size();
+    }
+
+    double meanScore() const { return games ? static_cast<double>(score) / games : 0.0; }
+
+    void merge(const BotResult& o) {
+        deaths.resize(std::max(deaths.size(), o.deaths.size()), 0);
+        for (size_t m = 0; m < o.deaths.size(); m++) {
+            deaths[m] += o.deaths[m];
+        }
+        score += o.score;
+        games += o.games;
+        early += o.early;
+    }
+};
+
+struct DifficultyReport {
+    BotResult bots[REFERENCE_BOTS];
+    // 0 when every bot lasts every game, 1 when they all die at once:
+    // one minus the mean survival area over the bots.
+    double difficulty = 0;
+    double earlyDeaths = 0;   // share of all games lost within earlyMoves
+    double seconds = 0;
+};
+
+// Head cell and heading; the body trails two cells behind, which the caller
+// has checked are open and on the board.
+struct SpawnPoint {
+    int head;
+    Direction direction;
+};
+
+namespace difficulty_detail {
+
+inline Direction randomSafeMove(const Game& g, Rng& rng) {
+    const Layout& l = *g.layout;
+    Direction safe[4];
+    int count = 0;
+    for (Direction d : { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT }) {
+        if (g.isFree(stepCell(l, g.head(), d))) {
+            safe[count++] = d;
+        }
+    }
+    return count ? safe[rng.below(count)] : g.direction;
+}
+
+// Safe move that gets closest to the food around the walls; ties at random.
+inline Direction greedyMove(const Game& g, Rng& rng) {
+    const Layout& l = *g.layout;
+    Direction best = g.direction;
+    int bestDist = 1 << 30, ties = 0;
+    for (Direction d : { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT }) {
+        int n = stepCell(l, g.head(), d);
+        if (!g.isFree(n)) {
+            continue;
+        }
+        int dist = g.food < 0 ? 0 : pathDistance(l, n, g.food);
+        if (dist < bestDist) {
+            bestDist = dist;
+            best = d;
+            ties = 1;
+        }
+        else if (dist == bestDist && rng.below(++ties) == 0) {
+            best = d;
+        }
+    }
+    return best;
+}
+
+inline void placeSnake(Game& g, const Layout& l, SpawnPoint spawn) {
+    static const int dx[4] = { 0, 0, -1, 1 }, dy[4] = { -1, 1, 0, 0 };
+    int d = static_cast<int>(spawn.direction);
+    int x = spawn.head % l.width, y = spawn.head / l.width;
+    for (int i = 2; i >= 0; i--) {
+        g.pushHead(l.cell(x - i * dx[d], y - i * dy[d]));
+    }
+    g.direction = spawn.direction;
+}
+
+}  // namespace difficulty_detail
+
+// Games are handed out in small batches from one counter, so a thread that
+// drew short games takes more; each thread keeps its own results until the
+// end. The layout gets distance tables for the run if it has none, so the
+// bots steer round walls the way the game's pilots do.
+inline DifficultyReport estimateDifficulty(const Layout& layout, SpawnPoint spawn, const DifficultyOptions& opt) {
+    using namespace difficulty_detail;
+    auto start = std::chrono::steady_clock::now();
+    int threads = opt.threads > 0 ? opt.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threads = std::max(1, threads);
+
+    Layout l = layout;
+    std::vector<uint16_t> pathSteps, wallSteps;
+    if (opt.buildTables && l.pathSteps == nullptr && l.cells() <= FIELD_MAX_CELLS) {
+        pathSteps.resize(static_cast<size_t>(l.cells()) * l.cells());
+        wallSteps.resize(l.cells());
+        buildFields(l, pathSteps.data(), wallSteps.data(), threads);
+        l.pathSteps = pathSteps.data();
+        l.wallSteps = wallSteps.data();
+    }
+
+    const int total = REFERENCE_BOTS * opt.gamesPerBot;
+    const int batch = 16;
+    std::atomic<int> next(0);
+    std::vector<std::vector<BotResult>> results(threads, std::vector<BotResult>(REFERENCE_BOTS));
+    auto work = [&](int t) {
+        Game g;
+        HeuristicBot heuristic = opt.heuristicWeights.empty() ? HeuristicBot() : HeuristicBot(opt.heuristicWeights);
+        for (BotResult& r : results[t]) {
+            r.deaths.assign(opt.maxMoves + 1, 0);
+        }
+        for (;;) {
+            int first = next.fetch_add(batch);
+            if (first >= total) {
+                return;
+            }
+            for (int i = first; i < std::min(total, first + batch); i++) {
+                int bot = i % REFERENCE_BOTS;
+                uint64_t seed = opt.seed + static_cast<uint64_t>(i / REFERENCE_BOTS);
+                Rng rng(seed * 0x9E3779B97F4A7C15ull + bot);
+                g.reset(l, seed);
+                placeSnake(g, l, spawn);
+                g.spawnFood(false);
+                while (!g.over && g.moves < opt.maxMoves) {
+                    Direction d = bot == BOT_RANDOM ? randomSafeMove(g, rng) : bot == BOT_GREEDY ? greedyMove(g, rng) : heuristic.choose(g);
+                    g.step(d);
+                }
+                BotResult& r = results[t][bot];
+                r.games++;
+                r.score += g.score;
+                if (g.over && !g.won) {
+                    r.deaths[g.moves]++;
+                    r.early += g.moves <= opt.earlyMoves;
+                }
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++) {
+        pool.emplace_back(work, t);
+    }
+    work(0);
+    for (std::thread& t : pool) {
+        t.join();
+    }
+
+    DifficultyReport report;
+    double area = 0;
+    int early = 0;
+    for (int b = 0; b < REFERENCE_BOTS; b++) {
+        for (int t = 0; t < threads; t++) {
+            report.bots[b].merge(results[t][b]);
+        }
+        area += report.bots[b].area();
+        early += report.bots[b].early;
+    }
+    report.difficulty = 1.0 - area / REFERENCE_BOTS;
+    report.earlyDeaths = total ? static_cast<double>(early) / total : 0.0;
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+// The check a level generator can afford for every candidate: `games`
+// short games per bot on the calling thread, without distance tables.
+// True when at most maxShare of them are lost within earlyMoves.
+inline bool fairStart(const Layout& layout, SpawnPoint spawn, double maxShare, const std::vector<double>& heuristicWeights,
+                      int games = 20, int earlyMoves = 20) {
+    DifficultyOptions opt;
+    opt.gamesPerBot = games;
+    opt.maxMoves = earlyMoves;
+    opt.earlyMoves = earlyMoves;
+    opt.threads = 1;
+    opt.heuristicWeights = heuristicWeights;
+    opt.buildTables = false;
+    return estimateDifficulty(layout, spawn, opt).earlyDeaths <= maxShare;
+}
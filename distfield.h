@@ -0,0 +1,347 @@
+#pragma once
+
+#include "board.h"
+#include "mapfile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Static distance tables for a layout's walls, cached in a file of entries
+// laid end to end, each one a FieldEntryHeader and then, at 8-byte aligned
+// offsets:
+//
+//   blocked:   cells bytes, 1 for a wall, to tell hash collisions apart
+//   pathSteps: cells x cells uint16_t, row a = steps from a to every cell
+//   wallSteps: cells uint16_t, steps to the nearest wall or board edge
+//
+// Unreachable pairs hold PATH_UNREACHABLE. The path table grows with the
+// square of the board (2.9 MB for 40x30), so boards over FIELD_MAX_CELLS get
+// no tables and fall back to cellDistance().
+const uint32_t FIELD_FILE_MAGIC = 0x44464E53;  // "SNFD"
+const uint32_t FIELD_FILE_VERSION = 1;
+const int FIELD_MAX_CELLS = 4096;
+// Unpersisted tables (generated mazes, a new layout every game) kept in
+// memory; older ones are freed.
+const int FIELD_MEMORY_ENTRIES = 8;
+// The cache file stops growing here (23 entries of 40x30); past it, new
+// tables stay in memory. A file found over it on open is cut down to the
+// newest entries that fit in half, leaving the run room to append.
+const size_t FIELD_FILE_MAX_BYTES = size_t(64) << 20;
+
+struct FieldEntryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t hash;
+    uint32_t width, height;
+    uint32_t wrap;
+    uint32_t reserved;
+    uint64_t bytes;  // the whole entry, header included
+};
+
+static_assert(sizeof(FieldEntryHeader) == 40, "field file layout changed");
+
+inline size_t fieldEntryBytes(int cells) {
+    size_t n = sizeof(FieldEntryHeader) + (static_cast<size_t>(cells) + 7) / 8 * 8;
+    n += static_cast<size_t>(cells) * cells * 2 + static_cast<size_t>(cells) * 2;
+    return (n + 7) / 8 * 8;
+}
+
+// FNV-1a over what the tables depend on: the size, wrapping, and which cells
+// are walls (any non-zero cell counts as one).
+inline uint64_t layoutHash(const Layout& l) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    auto mix = [&h](uint64_t v) {
+        h ^= v;
+        h *= 0x100000001b3ull;
+    };
+    mix(static_cast<uint64_t>(l.width));
+    mix(static_cast<uint64_t>(l.height));
+    mix(l.wrap);
+    for (uint8_t b : l.blocked) {
+        mix(b != 0);
+    }
+    return h;
+}
+
+// One BFS per source cell, sources dealt out to `threads` threads in turn so
+// each gets a share of every part of the board; then one multi-source BFS
+// out from the walls (and, unless the board wraps, from beyond its edges).
+inline void buildFields(const Layout& l, uint16_t* pathSteps, uint16_t* wallSteps, int threads) {
+    const int n = l.cells();
+    static const Direction dirs[4] = { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT };
+    auto rows = [&](int first) {
+        std::vector<int> queue(n);
+        for (int s = first; s < n; s += threads) {
+            uint16_t* d = pathSteps + static_cast<size_t>(s) * n;
+            std::fill(d, d + n, static_cast<uint16_t>(PATH_UNREACHABLE));
+            if (l.blocked[s]) {
+                continue;
+            }
+            d[s] = 0;
+            int head = 0, tail = 0;
+            queue[tail++] = s;
+            while (head < tail) {
+                int c = queue[head++];
+                for (Direction dir : dirs) {
+                    int m = stepCell(l, c, dir);
+                    if (m >= 0 && !l.blocked[m] && d[m] == PATH_UNREACHABLE) {
+                        d[m] = static_cast<uint16_t>(d[c] + 1);
+                        queue[tail++] = m;
+                    }
+                }
+            }
+        }
+    };
+    threads = std::max(1, std::min(threads, n));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++) {
+        pool.emplace_back(rows, t);
+    }
+    rows(0);
+    for (std::thread& t : pool) {
+        t.join();
+    }
+
+    // Walls first, then open edge cells, keeps the queue in distance order.
+    std::vector<int> queue;
+    queue.reserve(n);
+    std::fill(wallSteps, wallSteps + n, static_cast<uint16_t>(PATH_UNREACHABLE));
+    for (int c = 0; c < n; c++) {
+        if (l.blocked[c]) {
+            wallSteps[c] = 0;
+            queue.push_back(c);
+        }
+    }
+    for (int c = 0; c < n && !l.wrap; c++) {
+        int x = c % l.width, y = c / l.width;
+        if (!l.blocked[c] && (x == 0 || y == 0 || x == l.width - 1 || y == l.height - 1)) {
+            wallSteps[c] = 1;
+            queue.push_back(c);
+        }
+    }
+    for (size_t i = 0; i < queue.size(); i++) {
+        int c = queue[i];
+        for (Direction dir : dirs) {
+            int m = stepCell(l, c, dir);
+            if (m >= 0 && wallSteps[m] == PATH_UNREACHABLE) {
+                wallSteps[m] = static_cast<uint16_t>(wallSteps[c] + 1);
+                queue.push_back(m);
+            }
+        }
+    }
+}
+
+// Tables for one layout, pointing into the mapped cache file or into an
+// entry built in memory; all null when the layout gets none.
+struct DistanceFields {
+    uint64_t hash = 0;
+    int width = 0, height = 0;
+    bool wrap = false;
+    const uint8_t* blocked = nullptr;
+    const uint16_t* pathSteps = nullptr;
+    const uint16_t* wallSteps = nullptr;
+
+    // Points the layout at these tables; see pathDistance().
+    void attach(Layout& l) const {
+        l.pathSteps = pathSteps;
+        l.wallSteps = wallSteps;
+    }
+
+    bool matches(const Layout& l, uint64_t h) const {
+        if (hash != h || width != l.width || height != l.height || wrap != l.wrap) {
+            return false;
+        }
+        for (int c = 0; c < l.cells(); c++) {
+            if (blocked[c] != (l.blocked[c] != 0)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Distance tables by layout. The first game on a layout builds them (in
+// parallel) and, if asked to persist, appends them to the cache file; later
+// games, in this run or the next, find them there and pay only for the
+// lookup, the pages being read in as the bots touch them. A damaged or
+// foreign file is read up to the first bad entry and appended to from there.
+class FieldCache {
+public:
+    void open(const std::string& path) {
+        path_ = path;
+        load();
+        if (validBytes_ > FIELD_FILE_MAX_BYTES) {
+            compact();
+            load();
+        }
+    }
+
+    // No tables if the board is over FIELD_MAX_CELLS. Persisted tables stay
+    // valid as long as the cache; unpersisted ones for FIELD_MEMORY_ENTRIES
+    // further builds. `built` says whether this call had to build them.
+    DistanceFields get(const Layout& l, bool persist, int threads, bool* built = nullptr) {
+        if (built != nullptr) {
+            *built = false;
+        }
+        if (l.cells() > FIELD_MAX_CELLS || l.cells() == 0) {
+            return DistanceFields();
+        }
+        uint64_t h = layoutHash(l);
+        for (const auto& e : memory_) {
+            if (e->fields.matches(l, h)) {
+                return e->fields;
+            }
+        }
+        for (const DistanceFields& f : mapped_) {
+            if (f.matches(l, h)) {
+                return f;
+            }
+        }
+        if (built != nullptr) {
+            *built = true;
+        }
+
+        std::unique_ptr<Entry> e(new Entry());
+        size_t bytes = fieldEntryBytes(l.cells());
+        e->bytes.assign(bytes / 8, 0);
+        uint8_t* p = reinterpret_cast<uint8_t*>(e->bytes.data());
+        FieldEntryHeader header = { FIELD_FILE_MAGIC, FIELD_FILE_VERSION, h, static_cast<uint32_t>(l.width),
+                                    static_cast<uint32_t>(l.height), l.wrap, 0, bytes };
+        memcpy(p, &header, sizeof(header));
+        uint8_t* blocked = p + sizeof(FieldEntryHeader);
+        for (int c = 0; c < l.cells(); c++) {
+            blocked[c] = l.blocked[c] != 0;
+        }
+        parse(p, bytes, e->fields);
+        buildFields(l, const_cast<uint16_t*>(e->fields.pathSteps), const_cast<uint16_t*>(e->fields.wallSteps), threads);
+
+        size_t at = validBytes_;
+        if (persist && at + bytes <= FIELD_FILE_MAX_BYTES && append(p, bytes)) {
+            // Now in the file; map just this entry and serve it from there.
+            validBytes_ += bytes;
+            std::unique_ptr<MappedFile> file(new MappedFile());
+            std::string error;
+            DistanceFields f;
+            if (file->open(path_.c_str(), error, at, bytes) && parse(file->data(), file->size(), f) && f.matches(l, h)) {
+                mapped_.push_back(f);
+                maps_.push_back(std::move(file));
+                return f;
+            }
+        }
+        memory_.push_back(std::move(e));
+        if (memory_.size() > static_cast<size_t>(FIELD_MEMORY_ENTRIES)) {
+            memory_.pop_front();
+        }
+        return memory_.back()->fields;
+    }
+
+    int mappedEntries() const { return static_cast<int>(mapped_.size()); }
+
+private:
+    struct Entry {
+        std::vector<uint64_t> bytes;  // uint64_t keeps the tables aligned
+        DistanceFields fields;
+    };
+
+    // Reads the entry at p if it is well formed and fits in `left` bytes.
+    static bool parse(const uint8_t* p, size_t left, DistanceFields& f) {
+        if (left < sizeof(FieldEntryHeader)) {
+            return false;
+        }
+        FieldEntryHeader h;
+        memcpy(&h, p, sizeof(h));
+        if (h.magic != FIELD_FILE_MAGIC || h.version != FIELD_FILE_VERSION || h.width == 0 || h.height == 0 ||
+            h.width > static_cast<uint32_t>(FIELD_MAX_CELLS) || h.height > static_cast<uint32_t>(FIELD_MAX_CELLS) ||
+            h.width * h.height > static_cast<uint32_t>(FIELD_MAX_CELLS) ||
+            h.bytes != fieldEntryBytes(static_cast<int>(h.width * h.height)) || h.bytes > left) {
+            return false;
+        }
+        int cells = static_cast<int>(h.width * h.height);
+        f.hash = h.hash;
+        f.width = static_cast<int>(h.width);
+        f.height = static_cast<int>(h.height);
+        f.wrap = h.wrap != 0;
+        f.blocked = p + sizeof(FieldEntryHeader);
+        f.pathSteps = reinterpret_cast<const uint16_t*>(f.blocked + (static_cast<size_t>(cells) + 7) / 8 * 8);
+        f.wallSteps = f.pathSteps + static_cast<size_t>(cells) * cells;
+        return true;
+    }
+
+    bool append(const uint8_t* p, size_t bytes) {
+        if (path_.empty()) {
+            return false;
+        }
+        FILE* f = fopen(path_.c_str(), "r+b");
+        if (f == nullptr) {
+            f = fopen(path_.c_str(), "wb");
+        }
+        if (f == nullptr) {
+            return false;
+        }
+        // Straight after the last good entry, over anything damaged.
+        bool ok = fseek(f, static_cast<long>(validBytes_), SEEK_SET) == 0 && fwrite(p, 1, bytes, f) == bytes;
+        return fclose(f) == 0 && ok;
+    }
+
+    // Maps the whole file. Earlier mappings stay alive: tables handed out
+    // point into them.
+    void load() {
+        std::unique_ptr<MappedFile> file(new MappedFile());
+        std::string error;
+        mapped_.clear();
+        validBytes_ = 0;
+        if (!file->open(path_.c_str(), error)) {
+            return;
+        }
+        DistanceFields f;
+        while (parse(file->data() + validBytes_, file->size() - validBytes_, f)) {
+            mapped_.push_back(f);
+            validBytes_ += fieldEntryBytes(f.width * f.height);
+        }
+        maps_.push_back(std::move(file));
+    }
+
+    // Rewrites the file just loaded with its newest entries, those that fit
+    // in half of FIELD_FILE_MAX_BYTES. Nothing has been handed out from that
+    // mapping yet, so it is dropped before the file is replaced (Windows
+    // cannot replace a mapped file).
+    void compact() {
+        size_t keep = 0;
+        for (size_t i = mapped_.size(); i-- > 0;) {
+            size_t bytes = fieldEntryBytes(mapped_[i].width * mapped_[i].height);
+            if (keep + bytes > FIELD_FILE_MAX_BYTES / 2) {
+                break;
+            }
+            keep += bytes;
+        }
+        std::string temp = path_ + ".tmp";
+        FILE* f = fopen(temp.c_str(), "wb");
+        if (f == nullptr) {
+            return;
+        }
+        bool ok = fwrite(maps_.back()->data() + (validBytes_ - keep), 1, keep, f) == keep;
+        ok = fclose(f) == 0 && ok;
+        maps_.pop_back();
+        mapped_.clear();
+        // A failed rename only loses the cache, which the next games rebuild.
+        if (ok) {
+            remove(path_.c_str());
+            ok = rename(temp.c_str(), path_.c_str()) == 0;
+        }
+        if (!ok) {
+            remove(temp.c_str());
+        }
+    }
+
+    std::string path_;
+    std::vector<std::unique_ptr<MappedFile>> maps_;
+    std::vector<DistanceFields> mapped_;
+    size_t validBytes_ = 0;
+    std::deque<std::unique_ptr<Entry>> memory_;
+};
@@ -0,0 +1,221 @@
+#include "board.h"
+#include "distfield.h"
+#include "maze.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static const char* CACHE_PATH = "/tmp/field_bench.cache";
+
+static double ms(Clock::time_point start) {
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+// The game's maze levels: a generated maze with the snake's starting row
+// cleared.
+static Layout mazeLayout(int width, int height, bool wrap, uint64_t seed) {
+    Layout l(width, height);
+    l.wrap = wrap;
+    generateMaze(l, MAZE_DIVISION, 0.5f, seed);
+    for (int x = width / 2 - 3; x <= width / 2 + 5; x++) {
+        l.blocked[l.cell(x, height / 2)] = 0;
+    }
+    return l;
+}
+
+// Plain single-source BFS, to check the tables against.
+static vector<int> bfs(const Layout& l, int start) {
+    vector<int> d(l.cells(), PATH_UNREACHABLE);
+    if (l.blocked[start]) {
+        return d;
+    }
+    vector<int> queue(1, start);
+    d[start] = 0;
+    for (size_t i = 0; i < queue.size(); i++) {
+        for (Direction dir : { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT }) {
+            int m = stepCell(l, queue[i], dir);
+            if (m >= 0 && !l.blocked[m] && d[m] == PATH_UNREACHABLE) {
+                d[m] = d[queue[i]] + 1;
+                queue.push_back(m);
+            }
+        }
+    }
+    return d;
+}
+
+static size_t fileBytes(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) {
+        return 0;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return static_cast<size_t>(size);
+}
+
+static bool check(FieldCache& cache) {
+    bool ok = true;
+    Rng rng(5);
+    for (int trial = 0; trial < 20; trial++) {
+        Layout l = mazeLayout(40, 30, trial % 2 == 1, rng.next());
+        DistanceFields f = cache.get(l, false, 4);
+        for (int s = 0; s < l.cells(); s += 7) {
+            vector<int> d = bfs(l, s);
+            for (int c = 0; c < l.cells(); c++) {
+                ok = ok && f.pathSteps[static_cast<size_t>(s) * l.cells() + c] == d[c];
+            }
+        }
+        // Nearest wall by brute force: 0 on a wall, else 1 + the nearest
+        // neighbour's, off the edge of a bounded board counting as a wall.
+        for (int c = 0; c < l.cells(); c++) {
+            int best = l.blocked[c] ? 0 : PATH_UNREACHABLE;
+            for (int w = 0; w < l.cells() && best != 0; w++) {
+                int x = w % l.width, y = w / l.width;
+                bool edge = !l.wrap && (x == 0 || y == 0 || x == l.width - 1 || y == l.height - 1);
+                if (l.blocked[w] || edge) {
+                    best = min(best, cellDistance(l, c, w) + (l.blocked[w] ? 0 : 1));
+                }
+            }
+            ok = ok && f.wallSteps[c] == best;
+        }
+    }
+    printf("check tables against BFS and brute-force nearest wall: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// Greedy bot on maze levels: of the safe moves, the one that brings the
+// head closest to the food, by Manhattan distance and then by the tables.
+static void benchGreedy(FieldCache& cache) {
+    const int games = 200;
+    long long score[2] = { 0, 0 }, moves[2] = { 0, 0 };
+    double t[2];
+    for (int withFields = 0; withFields < 2; withFields++) {
+        Rng rng(9);
+        auto start = Clock::now();
+        for (int i = 0; i < games; i++) {
+            Layout l = mazeLayout(40, 30, false, 1000 + i);
+            if (withFields) {
+                cache.get(l, false, 4).attach(l);
+            }
+            Game g;
+            g.reset(l, rng.next());
+            g.placeDefaultSnake();
+            g.spawnFood(false);
+            while (!g.over && g.moves < 3000) {
+                Direction best = g.direction;
+                int bestDist = 1 << 30;
+                for (Direction d : { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT }) {
+                    int n = stepCell(l, g.head(), d);
+                    if (g.isFree(n) && pathDistance(l, n, g.food) < bestDist) {
+                        bestDist = pathDistance(l, n, g.food);
+                        best = d;
+                    }
+                }
+                g.step(best);
+            }
+            score[withFields] += g.score;
+            moves[withFields] += g.moves;
+        }
+        t[withFields] = ms(start);
+    }
+    printf("greedy bot on %d mazes: Manhattan %.1f score/game (%lld moves, %.0f ms)  tables %.1f score/game (%lld moves, %.0f ms incl. builds)\n",
+           games, static_cast<double>(score[0]) / games, moves[0], t[0], static_cast<double>(score[1]) / games, moves[1], t[1]);
+}
+
+int main() {
+    remove(CACHE_PATH);
+    FieldCache cache;
+    cache.open(CACHE_PATH);
+    bool ok = check(cache);
+
+    int cores = max(1, static_cast<int>(thread::hardware_concurrency()));
+    Layout l = mazeLayout(40, 30, false, 77);
+    vector<uint16_t> path(static_cast<size_t>(l.cells()) * l.cells()), wall(l.cells());
+    for (int threads : { 1, cores }) {
+        auto start = Clock::now();
+        for (int i = 0; i < 10; i++) {
+            buildFields(l, path.data(), wall.data(), threads);
+        }
+        printf("build 40x30 tables on %d thread(s): %.2f ms\n", threads, ms(start) / 10);
+    }
+
+    // First game on a layout builds and appends; the next game in this run,
+    // and the first one of the next run (a fresh cache mapping the file),
+    // only look it up.
+    bool built;
+    auto start = Clock::now();
+    DistanceFields first = cache.get(l, true, cores, &built);
+    double firstMs = ms(start);
+    start = Clock::now();
+    DistanceFields again = cache.get(l, true, cores);
+    double againMs = ms(start);
+    FieldCache nextRun;
+    start = Clock::now();
+    nextRun.open(CACHE_PATH);
+    bool rebuilt;
+    DistanceFields mapped = nextRun.get(l, true, cores, &rebuilt);
+    double nextMs = ms(start);
+    bool same = built && !rebuilt && again.pathSteps == first.pathSteps && mapped.pathSteps != nullptr &&
+                memcmp(mapped.pathSteps, path.data(), path.size() * 2) == 0 && memcmp(mapped.wallSteps, wall.data(), wall.size() * 2) == 0;
+    printf("first game %.2f ms (build + append %.1f MB), same run again %.4f ms, next run (map + lookup) %.4f ms: %s\n",
+           firstMs, fieldEntryBytes(l.cells()) / 1e6, againMs, nextMs, same ? "ok" : "FAILED");
+    ok = ok && same;
+
+    // A damaged tail is read up to the last good entry and appended over.
+    FILE* f = fopen(CACHE_PATH, "ab");
+    fwrite("garbage", 1, 7, f);
+    fclose(f);
+    FieldCache damaged;
+    damaged.open(CACHE_PATH);
+    Layout other = mazeLayout(40, 30, true, 78);
+    damaged.get(other, true, cores, &built);
+    FieldCache reread;
+    reread.open(CACHE_PATH);
+    bool recovered = damaged.mappedEntries() == 2 && reread.mappedEntries() == 2 && built;
+    printf("check damaged cache file recovered: %s\n", recovered ? "ok" : "FAILED");
+    ok = ok && recovered;
+
+    // Hot-reloaded edits add layouts: the file stops at the cap, and a file
+    // found over it on open keeps only its newest entries.
+    remove(CACHE_PATH);
+    size_t entry = fieldEntryBytes(l.cells());
+    int fit = static_cast<int>(FIELD_FILE_MAX_BYTES / entry);
+    FieldCache editing;
+    editing.open(CACHE_PATH);
+    Layout newest;
+    for (int i = 0; i < fit + 3; i++) {
+        newest = mazeLayout(40, 30, false, 1000 + i);
+        editing.get(newest, true, cores);
+    }
+    bool capped = editing.mappedEntries() == fit && fileBytes(CACHE_PATH) == fit * entry;
+    f = fopen(CACHE_PATH, "ab");
+    vector<uint8_t> copy(entry);
+    for (int i = 0; i < fit; i++) {
+        FILE* in = fopen(CACHE_PATH, "rb");
+        fseek(in, static_cast<long>(i * entry), SEEK_SET);
+        capped = capped && fread(copy.data(), 1, entry, in) == entry;
+        fclose(in);
+        fwrite(copy.data(), 1, entry, f);
+    }
+    fclose(f);
+    Layout kept = mazeLayout(40, 30, false, 1000 + fit - 1);
+    FieldCache compacted;
+    compacted.open(CACHE_PATH);
+    compacted.get(kept, true, cores, &rebuilt);
+    bool trimmed = compacted.mappedEntries() == fit / 2 && !rebuilt && fileBytes(CACHE_PATH) == fit / 2 * entry;
+    printf("check cache file capped at %d entries (%.0f MB) and compacted to %d on open: %s\n", fit,
+           FIELD_FILE_MAX_BYTES / 1e6, fit / 2, capped && trimmed ? "ok" : "FAILED");
+    ok = ok && capped && trimmed;
+
+    benchGreedy(cache);
+    remove(CACHE_PATH);
+    return ok ? 0 : 1;
+}
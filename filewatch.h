@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Watches a few file names in one directory from a background thread and
+// calls the handler there, once per change, after writes to the file have
+// been quiet for settleMs: editors and exporters write in bursts, and a
+// half-written file is not worth loading. On Linux the thread waits on
+// inotify for the directory rather than the files, because editors and
+// levelc replace a file by renaming over it and a watch on the old file
+// would be lost with it; elsewhere it polls modification times.
+//
+// The handler runs on the watcher thread and is where the slow part of a
+// reload (reading, decoding) belongs; handing the result to the main thread
+// is up to the caller.
+class FileWatcher {
+public:
+    typedef std::function<void(const std::string& name)> Handler;
+
+    ~FileWatcher() { stop(); }
+
+    bool start(const std::string& dir, const std::vector<std::string>& names, Handler handler, int settleMs = 100) {
+        stop();
+        dir_ = dir;
+        names_ = names;
+        handler_ = handler;
+        settle_ = std::chrono::milliseconds(settleMs);
+#ifdef __linux__
+        fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd_ < 0 || inotify_add_watch(fd_, dir_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            if (fd_ >= 0) {
+                ::close(fd_);
+                fd_ = -1;
+            }
+            return false;
+        }
+#else
+        stamps_.clear();
+        for (const std::string& name : names_) {
+            stamps_.push_back(stamp(name));
+        }
+#endif
+        stopping_ = false;
+        thread_ = std::thread([this] { run(); });
+        return true;
+    }
+
+    // Joins the thread; no handler runs after this returns.
+    void stop() {
+        if (!thread_.joinable()) {
+            return;
+        }
+        stopping_ = true;
+        thread_.join();
+#ifdef __linux__
+        ::close(fd_);
+        fd_ = -1;
+#endif
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    static constexpr int WAKE_MS = 50;
+
+    void run() {
+        // Name index -> when it may be loaded; pushed back by every write.
+        std::map<int, Clock::time_point> due;
+        while (!stopping_) {
+            wait(due);
+            Clock::time_point now = Clock::now();
+            for (auto it = due.begin(); it != due.end() && !stopping_;) {
+                if (it->second > now) {
+                    ++it;
+                    continue;
+                }
+                handler_(names_[it->first]);
+                it = due.erase(it);
+            }
+        }
+    }
+
+#ifdef __linux__
+    void wait(std::map<int, Clock::time_point>& due) {
+        // Sleep until the next file is due, or WAKE_MS to notice stop().
+        int timeout = WAKE_MS;
+        for (const auto& d : due) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(d.second - Clock::now()).count() + 1;
+            timeout = std::max(0, std::min(timeout, static_cast<int>(left)));
+        }
+        pollfd p = { fd_, POLLIN, 0 };
+        if (poll(&p, 1, timeout) <= 0) {
+            return;
+        }
+        alignas(inotify_event) char buffer[4096];
+        ssize_t n;
+        while ((n = read(fd_, buffer, sizeof(buffer))) > 0) {
+            for (char* at = buffer; at < buffer + n;) {
+                const inotify_event* e = reinterpret_cast<const inotify_event*>(at);
+                at += sizeof(inotify_event) + e->len;
+                int i = e->len > 0 ? find(e->name) : -1;
+                if (i >= 0) {
+                    due[i] = Clock::now() + settle_;
+                }
+            }
+        }
+    }
+#else
+    struct Stamp {
+        long long mtime, size;
+        bool operator!=(const Stamp& o) const { return mtime != o.mtime || size != o.size; }
+    };
+
+    Stamp stamp(const std::string& name) const {
+        struct stat st;
+        if (stat((dir_ + "/" + name).c_str(), &st) != 0) {
+            return { -1, -1 };
+        }
+        return { static_cast<long long>(st.st_mtime), static_cast<long long>(st.st_size) };
+    }
+
+    void wait(std::map<int, Clock::time_point>& due) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(WAKE_MS));
+        for (size_t i = 0; i < names_.size(); i++) {
+            Stamp s = stamp(names_[i]);
+            if (s != stamps_[i]) {
+                stamps_[i] = s;
+                if (s.size >= 0) {
+                    due[static_cast<int>(i)] = Clock::now() + settle_;
+                }
+            }
+        }
+    }
+
+    std::vector<Stamp> stamps_;
+#endif
+
+    int find(const char* name) const {
+        for (size_t i = 0; i < names_.size(); i++) {
+            if (names_[i] == name) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    std::string dir_;
+    std::vector<std::string> names_;
+    Handler handler_;
+    Clock::duration settle_{};
+    std::atomic<bool> stopping_{ false };
+    std::thread thread_;
+#ifdef __linux__
+    int fd_ = -1;
+#endif
+};
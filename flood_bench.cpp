@@ -0,0 +1,87 @@
+#include "board.h"
+#include "bitboard.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+static int scalarArea(const Layout& layout, const vector<uint8_t>& open, int start, vector<int>& queue, vector<uint8_t>& seen) {
+    fill(seen.begin(), seen.end(), 0);
+    if (!open[start]) {
+        return 0;
+    }
+    int head = 0, tail = 0;
+    queue[tail++] = start;
+    seen[start] = 1;
+    while (head < tail) {
+        int c = queue[head++];
+        for (Direction d : { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT }) {
+            int n = stepCell(layout, c, d);
+            if (n >= 0 && open[n] && !seen[n]) {
+                seen[n] = 1;
+                queue[tail++] = n;
+            }
+        }
+    }
+    return tail;
+}
+
+static double elapsedUs(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+}
+
+// Returns the reachable-area speedup.
+static double bench(const char* name, int width, int height, double density, int queries) {
+    Layout layout(width, height);
+    Rng rng(width * 7919 + height);
+    for (int c = 0; c < layout.cells(); c++) {
+        layout.blocked[c] = rng.below(1000) < density * 1000;
+    }
+    vector<uint8_t> open(layout.cells());
+    for (int c = 0; c < layout.cells(); c++) {
+        open[c] = !layout.blocked[c];
+    }
+    Bitboard bits = openCells(layout);
+
+    vector<int> starts(queries);
+    for (int& s : starts) {
+        s = rng.below(layout.cells());
+    }
+
+    vector<int> queue(layout.cells());
+    vector<uint8_t> seen(layout.cells());
+    long long scalarSum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int s : starts) {
+        scalarSum += scalarArea(layout, open, s, queue, seen);
+    }
+    double scalarUs = elapsedUs(start) / queries;
+
+    Bitboard reach;
+    long long bitSum = 0;
+    start = chrono::steady_clock::now();
+    for (int s : starts) {
+        bitSum += reachableArea(bits, s % width, s / width, reach);
+    }
+    double bitUs = elapsedUs(start) / queries;
+
+    bool same = scalarSum == bitSum;
+    printf("%-16s %5dx%-5d %3.0f%% blocked  area: bfs %10.2f us  bitboard %9.2f us  x%5.1f  %s\n", name, width, height,
+           density * 100, scalarUs, bitUs, scalarUs / bitUs, same ? "ok" : "MISMATCH");
+    return same ? scalarUs / bitUs : 0;
+}
+
+int main(int argc, char* argv[]) {
+    int queries = argc > 1 ? atoi(argv[1]) : 200;
+    double worst = bench("level 2", 40, 30, 0.01, queries * 50);
+    worst = min(worst, bench("cluttered", 40, 30, 0.30, queries * 50));
+    worst = min(worst, bench("large open", 1024, 1024, 0.05, queries));
+    worst = min(worst, bench("large cluttered", 1024, 1024, 0.30, queries));
+    worst = min(worst, bench("huge", 4096, 4096, 0.10, queries / 10 + 1));
+    printf("check bitboard areas match BFS and are at least x10 faster: %s (x%.1f at worst)\n", worst >= 10 ? "ok" : "FAILED",
+           worst);
+    return worst > 0 ? 0 : 1;
+}
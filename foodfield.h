@@ -0,0 +1,123 @@
+#pragma once
+
+#include "board.h"
+
+#include <cstdint>
+#include <vector>
+
+enum FoodType : uint8_t { FOOD_NORMAL, FOOD_BONUS, FOOD_TIMED, FOOD_POISONED, FOOD_TYPES };
+
+// Points for eating an item; poisoned food costs points (and, in the game,
+// segments).
+inline int foodPoints(FoodType type) {
+    switch (type) {
+        case FOOD_BONUS: return 5;
+        case FOOD_TIMED: return 3;
+        case FOOD_POISONED: return -3;
+        default: return 1;
+    }
+}
+
+// Any number of food items on a board. Items are packed in parallel arrays
+// (cell, type, expiry) and every cell holds the index of its item, so finding
+// the item under the head, adding one and removing one are all O(1); removal
+// moves the last item into the hole. Timed items go into a ring of per-tick
+// buckets and expire() only looks at the bucket for the current tick.
+class FoodField {
+public:
+    static const int MAX_LIFETIME = 1024;
+
+    std::vector<int> cells;
+    std::vector<FoodType> types;
+    std::vector<int> expiry;     // tick a timed item disappears, -1 otherwise
+
+    void reset(int boardCells) {
+        slotOf_.assign(boardCells, -1);
+        cells.clear();
+        types.clear();
+        expiry.clear();
+        for (auto& bucket : buckets_) {
+            bucket.clear();
+        }
+    }
+
+    int count() const { return static_cast<int>(cells.size()); }
+    int at(int cell) const { return slotOf_[cell]; }
+    bool has(int cell) const { return slotOf_[cell] >= 0; }
+
+    // lifetime in ticks, for FOOD_TIMED only; clamped to MAX_LIFETIME - 1.
+    bool spawn(int cell, FoodType type, int tick, int lifetime = 0) {
+        if (slotOf_[cell] >= 0) {
+            return false;
+        }
+        int expires = -1;
+        if (type == FOOD_TIMED) {
+            if (lifetime < 1) lifetime = 1;
+            if (lifetime >= MAX_LIFETIME) lifetime = MAX_LIFETIME - 1;
+            expires = tick + lifetime;
+            buckets_[expires & (MAX_LIFETIME - 1)].push_back(cell);
+        }
+        slotOf_[cell] = count();
+        cells.push_back(cell);
+        types.push_back(type);
+        expiry.push_back(expires);
+        return true;
+    }
+
+    void despawn(int cell) {
+        int slot = slotOf_[cell];
+        if (slot < 0) {
+            return;
+        }
+        int last = count() - 1;
+        if (slot != last) {
+            cells[slot] = cells[last];
+            types[slot] = types[last];
+            expiry[slot] = expiry[last];
+            slotOf_[cells[slot]] = slot;
+        }
+        cells.pop_back();
+        types.pop_back();
+        expiry.pop_back();
+        slotOf_[cell] = -1;
+    }
+
+    // Removes the timed items due at tick; call once per tick. Entries for
+    // items already eaten (or replaced) are skipped by checking the expiry.
+    int expire(int tick) {
+        std::vector<int>& bucket = buckets_[tick & (MAX_LIFETIME - 1)];
+        int removed = 0;
+        for (int cell : bucket) {
+            int slot = slotOf_[cell];
+            if (slot >= 0 && expiry[slot] == tick) {
+                despawn(cell);
+                removed++;
+            }
+        }
+        bucket.clear();
+        return removed;
+    }
+
+    // Random free cell by rejection sampling; -1 if 64 tries all miss, which
+    // only happens on a nearly full board.
+    template <typename IsFree>
+    int randomFreeCell(int boardCells, Rng& rng, IsFree isFree) const {
+        for (int tries = 0; tries < 64; tries++) {
+            int c = rng.below(boardCells);
+            if (slotOf_[c] < 0 && isFree(c)) {
+                return c;
+            }
+        }
+        return -1;
+    }
+
+private:
+    std::vector<int> slotOf_;
+    std::vector<int> buckets_[MAX_LIFETIME];
+};
+
+// 70% normal, 10% each bonus, timed and poisoned.
+inline FoodType randomFoodType(Rng& rng) {
+    int r = rng.below(10);
+    return r < 7 ? FOOD_NORMAL : r == 7 ? FOOD_BONUS : r == 8 ? FOOD_TIMED : FOOD_POISONED;
+}
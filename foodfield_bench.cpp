@@ -0,0 +1,115 @@
+#include "board.h"
+#include "foodfield.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+// Same layout as SDL_Vertex, so building the batches here costs what
+// renderFoodField() spends before handing them to SDL.
+struct Vertex {
+    float x, y;
+    uint8_t r, g, b, a;
+    float u, v;
+};
+
+static bool consistent(const FoodField& field, int cells) {
+    int found = 0;
+    for (int c = 0; c < cells; c++) {
+        int slot = field.at(c);
+        if (slot < 0) continue;
+        if (slot >= field.count() || field.cells[slot] != c) return false;
+        found++;
+    }
+    return found == field.count();
+}
+
+static void bench(int width, int height, int items, int snakes, int frames) {
+    int cells = width * height;
+    vector<uint8_t> blocked(cells, 0);
+    Rng rng(7);
+    for (int i = 0; i < cells / 100; i++) blocked[rng.below(cells)] = 1;
+    auto isFree = [&](int c) { return !blocked[c]; };
+
+    FoodField field;
+    field.reset(cells);
+    auto start = chrono::steady_clock::now();
+    while (field.count() < items) {
+        int c = field.randomFreeCell(cells, rng, isFree);
+        if (c < 0) break;
+        field.spawn(c, randomFoodType(rng), 0, 100 + rng.below(400));
+    }
+    double fillMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    // Heads wander at random; every frame each looks up the item under it,
+    // eats it, and the field is topped up and aged like the game does.
+    vector<int> heads(snakes);
+    for (int& h : heads) h = rng.below(cells);
+    vector<Vertex> vertices[2];
+    vector<int> indices;
+    long long eaten = 0, expired = 0, drawn = 0;
+    double simMs = 0, batchMs = 0, worstMs = 0;
+    for (int tick = 1; tick <= frames; tick++) {
+        auto t0 = chrono::steady_clock::now();
+        for (int& h : heads) {
+            int x = h % width + rng.below(3) - 1, y = h / width + rng.below(3) - 1;
+            if (x < 0 || y < 0 || x >= width || y >= height) continue;
+            h = y * width + x;
+            if (field.has(h)) {
+                field.despawn(h);
+                eaten++;
+            }
+        }
+        expired += field.expire(tick);
+        while (field.count() < items) {
+            int c = field.randomFreeCell(cells, rng, isFree);
+            if (c < 0) break;
+            field.spawn(c, randomFoodType(rng), tick, 100 + rng.below(400));
+        }
+        auto t1 = chrono::steady_clock::now();
+
+        // Indices only depend on the number of quads, so they are built
+        // once; vertices are written in place into buffers sized up front.
+        int quads[2] = { 0, 0 };
+        for (int b = 0; b < 2; b++) {
+            vertices[b].resize(static_cast<size_t>(field.count()) * 4);
+        }
+        while (static_cast<int>(indices.size()) < field.count() * 6) {
+            int base = static_cast<int>(indices.size()) / 6 * 4;
+            for (int k : { 0, 1, 2, 0, 2, 3 }) indices.push_back(base + k);
+        }
+        for (int i = 0; i < field.count(); i++) {
+            FoodType type = field.types[i];
+            uint8_t g = type == FOOD_TIMED ? 210 : 255;
+            int b = type == FOOD_BONUS;
+            float x = static_cast<float>(field.cells[i] % width * 4), y = static_cast<float>(field.cells[i] / width * 4);
+            Vertex* v = &vertices[b][static_cast<size_t>(quads[b]++) * 4];
+            v[0] = { x, y, 255, g, 255, 255, 0, 0 };
+            v[1] = { x + 4, y, 255, g, 255, 255, 1, 0 };
+            v[2] = { x + 4, y + 4, 255, g, 255, 255, 1, 1 };
+            v[3] = { x, y + 4, 255, g, 255, 255, 0, 1 };
+        }
+        drawn += quads[0] + quads[1];
+        auto t2 = chrono::steady_clock::now();
+        double sim = chrono::duration<double, milli>(t1 - t0).count();
+        double batch = chrono::duration<double, milli>(t2 - t1).count();
+        simMs += sim;
+        batchMs += batch;
+        worstMs = max(worstMs, sim + batch);
+    }
+    printf("%7d items %5dx%-5d fill %7.2f ms  per frame: update %6.3f ms  batch %6.3f ms  worst %6.3f ms  (%.0f quads, 2 draw calls)\n",
+           items, width, height, fillMs, simMs / frames, batchMs / frames, worstMs, double(drawn) / frames);
+    printf("        eaten %lld  expired %lld  index %s\n", eaten, expired, consistent(field, cells) ? "consistent" : "BROKEN");
+}
+
+int main(int argc, char* argv[]) {
+    int frames = argc > 1 ? atoi(argv[1]) : 600;
+    bench(40, 30, 60, 1, frames);
+    bench(400, 300, 10000, 100, frames);
+    bench(1000, 1000, 100000, 1000, frames);
+    bench(2000, 2000, 100000, 10000, frames);
+    return 0;
+}
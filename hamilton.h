@@ -0,0 +1,229 @@
+#pragma once
+
+#include "board.h"
+
+#include <vector>
+
+// Hamiltonian cycle over the free 2x2 blocks of a layout. The free blocks are
+// joined by a spanning tree and the cycle walks around that tree, so every
+// cell of every reachable free block is visited exactly once. Cells in blocks
+// that touch an obstacle (and the last row/column of odd-sized boards) are
+// left off the cycle; next[] and order[] are -1 there.
+struct HamiltonCycle {
+    int width = 0;
+    int height = 0;
+    int length = 0;
+    std::vector<int> next;
+    std::vector<int> order;
+
+    bool contains(int cell) const { return cell >= 0 && order[cell] >= 0; }
+
+    // Steps needed to go from a to b following the cycle.
+    int distance(int a, int b) const {
+        int d = order[b] - order[a];
+        return d < 0 ? d + length : d;
+    }
+
+    bool build(const Layout& layout) {
+        width = layout.width;
+        height = layout.height;
+        length = 0;
+        next.assign(layout.cells(), -1);
+        order.assign(layout.cells(), -1);
+
+        int bw = width / 2;
+        int bh = height / 2;
+        int blocks = bw * bh;
+        if (blocks == 0) {
+            return false;
+        }
+
+        std::vector<uint8_t> freeBlock(blocks, 0);
+        for (int by = 0; by < bh; by++) {
+            for (int bx = 0; bx < bw; bx++) {
+                int c = layout.cell(bx * 2, by * 2);
+                freeBlock[by * bw + bx] = !layout.blocked[c] && !layout.blocked[c + 1] &&
+                                          !layout.blocked[c + width] && !layout.blocked[c + width + 1];
+            }
+        }
+
+        // Label connected groups of free blocks and keep the largest one.
+        std::vector<int> group(blocks, -1);
+        std::vector<int> queue(blocks);
+        int bestGroup = -1, bestSize = 0, bestRoot = -1;
+        for (int b = 0, groups = 0; b < blocks; b++) {
+            if (!freeBlock[b] || group[b] >= 0) {
+                continue;
+            }
+            int head = 0, tail = 0;
+            queue[tail++] = b;
+            group[b] = groups;
+            while (head < tail) {
+                int cur = queue[head++];
+                int bx = cur % bw, by = cur / bw;
+                int around[4] = { bx > 0 ? cur - 1 : -1, bx < bw - 1 ? cur + 1 : -1,
+                                  by > 0 ? cur - bw : -1, by < bh - 1 ? cur + bw : -1 };
+                for (int n : around) {
+                    if (n >= 0 && freeBlock[n] && group[n] < 0) {
+                        group[n] = groups;
+                        queue[tail++] = n;
+                    }
+                }
+            }
+            if (tail > bestSize) {
+                bestSize = tail;
+                bestGroup = groups;
+                bestRoot = b;
+            }
+            groups++;
+        }
+        if (bestGroup < 0) {
+            return false;
+        }
+
+        // Breadth-first spanning tree; each block records which of its four
+        // sides are tree edges.
+        enum { EAST = 1, WEST = 2, NORTH = 4, SOUTH = 8 };
+        std::vector<uint8_t> edges(blocks, 0);
+        std::vector<uint8_t> seen(blocks, 0);
+        int head = 0, tail = 0;
+        queue[tail++] = bestRoot;
+        seen[bestRoot] = 1;
+        while (head < tail) {
+            int cur = queue[head++];
+            int bx = cur % bw, by = cur / bw;
+            struct { int block; uint8_t from, to; } around[4] = {
+                { bx < bw - 1 ? cur + 1 : -1, EAST, WEST },
+                { bx > 0 ? cur - 1 : -1, WEST, EAST },
+                { by > 0 ? cur - bw : -1, NORTH, SOUTH },
+                { by < bh - 1 ? cur + bw : -1, SOUTH, NORTH },
+            };
+            for (const auto& a : around) {
+                if (a.block >= 0 && freeBlock[a.block] && !seen[a.block]) {
+                    seen[a.block] = 1;
+                    edges[cur] |= a.from;
+                    edges[a.block] |= a.to;
+                    queue[tail++] = a.block;
+                }
+            }
+        }
+
+        // Walk around the tree: inside a lone block the cycle runs
+        // top-left, bottom-left, bottom-right, top-right; a tree edge on a side
+        // diverts the walk into the neighbouring block instead.
+        for (int i = 0; i < tail; i++) {
+            int b = queue[i];
+            int x = (b % bw) * 2, y = (b / bw) * 2;
+            int tl = y * width + x, tr = tl + 1, bl = tl + width, br = bl + 1;
+            uint8_t e = edges[b];
+            next[tl] = (e & WEST) ? tl - 1 : bl;
+            next[bl] = (e & SOUTH) ? bl + width : br;
+            next[br] = (e & EAST) ? br + 1 : tr;
+            next[tr] = (e & NORTH) ? tr - width : tl;
+        }
+
+        int start = (queue[0] / bw) * 2 * width + (queue[0] % bw) * 2;
+        int c = start;
+        do {
+            order[c] = length++;
+            c = next[c];
+        } while (c != start);
+        return true;
+    }
+};
+
+// Drives a snake around a HamiltonCycle. While the body lies on the cycle in
+// order (tail to head) the snake may take shortcuts across the cycle towards
+// the food, but only when the jump leaves enough free cells ahead of the head
+// that the body stays in order; once half the board is full it sticks to the
+// cycle. A snake that starts off the cycle, or out of order, follows the cycle
+// until its whole body is back on it.
+struct HamiltonPilot {
+    const HamiltonCycle* cycle = nullptr;
+    bool ordered = false;
+
+    void reset(const HamiltonCycle& c) {
+        cycle = &c;
+        ordered = false;
+    }
+
+    // segment(i) returns the cell of the i-th segment counted from the head;
+    // isFree(cell) tells whether the head may move there.
+    template <class Segment, class IsFree>
+    int nextCell(const Layout& layout, Segment segment, int length, int food, IsFree isFree) {
+        const HamiltonCycle& hc = *cycle;
+        int head = segment(0);
+
+        if (!ordered) {
+            ordered = isOrdered(segment, length);
+        }
+
+        int along = hc.contains(head) ? hc.next[head] : -1;
+        if (!ordered) {
+            if (along >= 0 && isFree(along)) {
+                return along;
+            }
+            int fallback = -1;
+            for (Direction d : { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT }) {
+                int n = stepCell(layout, head, d);
+                if (n >= 0 && isFree(n)) {
+                    if (hc.contains(n)) {
+                        return n;
+                    }
+                    fallback = n;
+                }
+            }
+            return fallback >= 0 ? fallback : along;
+        }
+
+        int tail = segment(length - 1);
+        int toTail = hc.distance(head, tail);
+        int empty = hc.length - length;
+        int available = toTail - length - 3;
+        if (empty < hc.length / 2) {
+            available = 0;
+        } else if (food >= 0 && hc.contains(food)) {
+            int toFood = hc.distance(head, food);
+            if (toFood < toTail) {
+                available--;
+                if ((toTail - toFood) * 4 > empty) {
+                    available -= 10;
+                }
+            }
+            if (toFood < available) {
+                available = toFood;
+            }
+        }
+
+        int best = along;
+        int bestJump = 1;
+        if (available > 1) {
+            for (Direction d : { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT }) {
+                int n = stepCell(layout, head, d);
+                if (n < 0 || !hc.contains(n) || !isFree(n)) {
+                    continue;
+                }
+                int jump = hc.distance(head, n);
+                if (jump > bestJump && jump <= available) {
+                    best = n;
+                    bestJump = jump;
+                }
+            }
+        }
+        return best;
+    }
+
+    template <class Segment>
+    bool isOrdered(Segment segment, int length) const {
+        const HamiltonCycle& hc = *cycle;
+        long long span = 0;
+        for (int i = length - 1; i > 0; i--) {
+            int from = segment(i), to = segment(i - 1);
+            if (!hc.contains(from) || !hc.contains(to)) {
+                return false;
+            }
+            span += hc.distance(from, to);
+        }
+        return hc.contains(segment(0)) && span < hc.length;
+    }
+};
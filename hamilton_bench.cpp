@@ -0,0 +1,102 @@
+#include "board.h"
+#include "hamilton.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+static double elapsedMs(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static void benchBuild(const char* name, int width, int height, int numObstacles) {
+    Layout layout(width, height);
+    Game game;
+    game.reset(layout, 7);
+    game.placeDefaultSnake();
+    Rng rng(11);
+    scatterObstacles(layout, game, numObstacles, rng);
+
+    HamiltonCycle cycle;
+    double best = 1e30;
+    for (int i = 0; i < 5; i++) {
+        auto start = chrono::steady_clock::now();
+        cycle.build(layout);
+        double ms = elapsedMs(start);
+        if (ms < best) best = ms;
+    }
+    printf("build %-22s %5dx%-5d cycle %8d / %8d cells  %8.2f ms\n",
+           name, width, height, cycle.length, width * height - numObstacles, best);
+}
+
+static bool playToFill(int width, int height, int numObstacles, uint64_t seed,
+                       long long& moves, int& finalLength, int& cycleLength) {
+    Layout layout(width, height);
+    Game game;
+    game.reset(layout, seed);
+    game.placeDefaultSnake();
+    Rng rng(seed * 31 + 1);
+    scatterObstacles(layout, game, numObstacles, rng);
+
+    HamiltonCycle cycle;
+    if (!cycle.build(layout)) {
+        return false;
+    }
+    vector<uint8_t> mask(layout.cells());
+    for (int c = 0; c < layout.cells(); c++) {
+        mask[c] = cycle.contains(c);
+    }
+    game.foodMask = mask.data();
+    game.spawnFood(false);
+
+    HamiltonPilot pilot;
+    pilot.reset(cycle);
+    auto segment = [&](int i) { return game.segment(i); };
+    auto isFree = [&](int c) { return game.isFree(c); };
+    long long limit = 4LL * cycle.length * cycle.length + 1000;
+    while (!game.over && game.moves < limit) {
+        int next = pilot.nextCell(layout, segment, game.length, game.food, isFree);
+        if (next < 0) {
+            break;
+        }
+        game.step(directionTo(layout, game.head(), next));
+    }
+    moves = game.moves;
+    finalLength = game.length;
+    cycleLength = cycle.length;
+    return game.won;
+}
+
+static void benchGames(const char* name, int width, int height, int numObstacles, int games) {
+    int won = 0;
+    long long totalMoves = 0;
+    double fill = 0;
+    auto start = chrono::steady_clock::now();
+    for (int g = 0; g < games; g++) {
+        long long moves = 0;
+        int length = 0, cycleLength = 1;
+        won += playToFill(width, height, numObstacles, 1000 + g, moves, length, cycleLength);
+        totalMoves += moves;
+        fill += 100.0 * length / cycleLength;
+    }
+    double ms = elapsedMs(start);
+    printf("play  %-22s %5dx%-5d %3d/%-3d games filled  avg fill %6.2f%%  avg moves %10.0f  %8.1f ms/game\n",
+           name, width, height, won, games, fill / games, double(totalMoves) / games, ms / games);
+}
+
+int main(int argc, char* argv[]) {
+    int games = argc > 1 ? atoi(argv[1]) : 10;
+
+    benchBuild("level 1", 40, 30, 0);
+    benchBuild("level 2", 40, 30, 10);
+    benchBuild("open", 1000, 1000, 0);
+    benchBuild("1% obstacles", 1000, 1000, 10000);
+
+    benchGames("level 1", 40, 30, 0, games);
+    benchGames("level 2", 40, 30, 10, games);
+    benchGames("64x64, 40 obstacles", 64, 64, 40, games);
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "board.h"
+#include "bitboard.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+enum HeuristicFeature {
+    FEATURE_FOOD_CLOSENESS,   // 1 next to the food, 0 across the board
+    FEATURE_EATS,             // 1 if the move eats
+    FEATURE_SPACE,            // share of the open cells still reachable
+    FEATURE_EXITS,            // free neighbours of the new head, over 4
+    FEATURE_TAIL_REACHABLE,   // 1 if the tail borders the reachable space
+    FEATURE_EDGE,             // 1 if the new head is on the board edge, or
+                              // next to any static wall given distance tables
+    FEATURE_COUNT
+};
+
+// One-ply bot: scores each safe move as a weighted sum of the features above
+// and takes the best. The weights are what trainer evolves.
+class HeuristicBot {
+public:
+    std::vector<double> weights;
+
+    HeuristicBot() : weights(defaultWeights()) {}
+    explicit HeuristicBot(const std::vector<double>& w) : weights(w) {}
+
+    static std::vector<double> defaultWeights() {
+        return { 1.0, 0.5, 4.0, 0.3, 2.0, -0.1 };
+    }
+
+    // Reads whitespace-separated weights, e.g. the best line trainer writes.
+    bool load(const std::string& path) {
+        FILE* f = fopen(path.c_str(), "r");
+        if (f == nullptr) {
+            return false;
+        }
+        std::vector<double> w(FEATURE_COUNT);
+        bool ok = true;
+        for (double& v : w) {
+            ok = ok && fscanf(f, "%lf", &v) == 1;
+        }
+        fclose(f);
+        if (ok) {
+            weights = w;
+        }
+        return ok;
+    }
+
+    Direction choose(const Game& game) {
+        const Layout& l = *game.layout;
+        int head = game.head();
+        openCells(l, game.occupied.data(), open_);
+        // The tail moves out of the way unless the move eats.
+        int tail = game.tail();
+        int openCount = open_.count() + 1;
+
+        Direction best = game.direction;
+        double bestScore = -1e300;
+        for (Direction d : { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT }) {
+            int n = stepCell(l, head, d);
+            if (!game.isFree(n)) {
+                continue;
+            }
+            bool eats = n == game.food;
+            if (!eats) {
+                open_.set(tail % l.width, tail / l.width);
+            }
+
+            double f[FEATURE_COUNT] = {};
+            if (game.food >= 0) {
+                int dist = pathDistance(l, game.food, n);
+                f[FEATURE_FOOD_CLOSENESS] = std::max(0.0, 1.0 - static_cast<double>(dist) / (l.width + l.height));
+            }
+            f[FEATURE_EATS] = eats;
+            int exits = 0;
+            for (Direction e : { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT }) {
+                int m = stepCell(l, n, e);
+                exits += m >= 0 && open_.get(m % l.width, m / l.width);
+            }
+            int area = reachableArea(open_, n % l.width, n / l.width, reach_, l.wrap) - 1;
+            f[FEATURE_SPACE] = static_cast<double>(area) / openCount;
+            f[FEATURE_EXITS] = exits / 4.0;
+            f[FEATURE_TAIL_REACHABLE] = !eats || touches(l, tail);
+            int x = n % l.width, y = n / l.width;
+            if (l.wallSteps != nullptr) {
+                f[FEATURE_EDGE] = l.wallSteps[n] == 1;
+            }
+            else {
+                f[FEATURE_EDGE] = !l.wrap && (x == 0 || y == 0 || x == l.width - 1 || y == l.height - 1);
+            }
+
+            double score = 0;
+            for (int i = 0; i < FEATURE_COUNT && i < static_cast<int>(weights.size()); i++) {
+                score += weights[i] * f[i];
+            }
+            if (score > bestScore) {
+                bestScore = score;
+                best = d;
+            }
+
+            if (!eats) {
+                open_.clear(tail % l.width, tail / l.width);
+            }
+        }
+        return best;
+    }
+
+private:
+    bool touches(const Layout& l, int cell) const {
+        for (Direction e : { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT }) {
+            int m = stepCell(l, cell, e);
+            if (m >= 0 && reach_.width == l.width && reach_.get(m % l.width, m / l.width)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Bitboard open_;
+    Bitboard reach_;
+};
+
+// Plays one headless game with the bot until it dies, fills the board, or
+// goes starveLimit moves without eating.
+inline void playHeuristicGame(HeuristicBot& bot, Game& game, int starveLimit) {
+    int lastScore = game.score;
+    int lastEat = game.moves;
+    while (!game.over && game.moves - lastEat < starveLimit) {
+        game.step(bot.choose(game));
+        if (game.score != lastScore) {
+            lastScore = game.score;
+            lastEat = game.moves;
+        }
+    }
+}
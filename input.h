@@ -0,0 +1,92 @@
+#pragma once
+
+#include "board.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded queue from one producer thread to one consumer thread. Each side
+// owns one index and only reads the other's, so push() and pop() are a load
+// and a store each, never a lock or a wait; the indices sit on their own
+// cache lines so the two threads do not keep stealing one from each other.
+// N must be a power of two; the ring holds N - 1 values.
+template <class T, size_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    // Producer: false, and nothing queued, when the ring is full.
+    bool push(const T& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) & (N - 1);
+        if (next == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        slots_[tail] = value;
+        tail_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: the oldest value, or false when there is none.
+    bool pop(T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = slots_[head];
+        head_.store((head + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+private:
+    alignas(64) std::atomic<size_t> head_{ 0 };
+    alignas(64) std::atomic<size_t> tail_{ 0 };
+    alignas(64) T slots_[N];
+};
+
+inline bool opposite(Direction a, Direction b) {
+    return (static_cast<int>(a) ^ 1) == static_cast<int>(b);
+}
+
+// The turns a player has asked for and no tick has taken yet, with the
+// counter reading of each key press. A tick takes one, so up then left
+// pressed within one tick turns the snake on two ticks instead of the
+// second press overwriting the first. A turn is checked against the one
+// queued before it, or the way the snake is moving when none is: reversing
+// or repeating it is dropped, as is any turn beyond CAPACITY.
+class TurnQueue {
+public:
+    static constexpr int CAPACITY = 3;
+
+    bool push(Direction turn, Direction moving, uint64_t stamp) {
+        Direction last = count_ > 0 ? turns_[(first_ + count_ - 1) % CAPACITY] : moving;
+        if (count_ == CAPACITY || turn == last || opposite(turn, last)) {
+            return false;
+        }
+        turns_[(first_ + count_) % CAPACITY] = turn;
+        stamps_[(first_ + count_) % CAPACITY] = stamp;
+        count_++;
+        return true;
+    }
+
+    bool take(Direction& turn, uint64_t& stamp) {
+        if (count_ == 0) {
+            return false;
+        }
+        turn = turns_[first_];
+        stamp = stamps_[first_];
+        first_ = (first_ + 1) % CAPACITY;
+        count_--;
+        return true;
+    }
+
+    void clear() { count_ = 0; }
+    int size() const { return count_; }
+
+private:
+    Direction turns_[CAPACITY] = {};
+    uint64_t stamps_[CAPACITY] = {};
+    int first_ = 0;
+    int count_ = 0;
+};
@@ -0,0 +1,183 @@
+#include "board.h"
+#include "input.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+struct Press {
+    double ms;
+    Direction turn;
+};
+
+static Direction perpendicular(Direction d, bool second) {
+    bool vertical = d == Direction::UP || d == Direction::DOWN;
+    return vertical ? (second ? Direction::RIGHT : Direction::LEFT) : (second ? Direction::DOWN : Direction::UP);
+}
+
+static Direction reverse(Direction d) {
+    return static_cast<Direction>(static_cast<int>(d) ^ 1);
+}
+
+// A minute of a player snaking around: a turn every 300 to 700 ms, and
+// most of the time a second one 10 to 60 ms after it, either back the way
+// the snake was going (a jog sideways) or round into a U-turn.
+static vector<Press> player(uint64_t seed) {
+    Rng rng(seed);
+    vector<Press> presses;
+    Direction heading = Direction::RIGHT;
+    for (double ms = 200; ms < 60000; ms += 300 + rng.below(401)) {
+        Direction first = perpendicular(heading, rng.below(2) != 0);
+        presses.push_back({ ms, first });
+        heading = first;
+        if (rng.below(10) < 6) {
+            Direction back = presses.size() > 1 ? presses[presses.size() - 2].turn : Direction::RIGHT;
+            Direction second = rng.below(2) ? back : reverse(back);
+            presses.push_back({ ms + 10 + rng.below(51), second });
+            heading = second;
+        }
+    }
+    return presses;
+}
+
+struct Model {
+    double meanMs = 0, worstMs = 0;
+    int presses = 0, applied = 0, reversals = 0;
+};
+
+// The game's loop on virtual time: every loopMs it takes the presses that
+// have come in, then runs the ticks due. Polling does what handleEvents()
+// did, setting the direction the next tick moves in straight away unless
+// it reverses the one already set; the queue keeps each press for a tick
+// of its own. A press counts as applied when a tick moves the way it asked,
+// and its latency is from the press to that tick. A reversal is a tick
+// moving straight back into the snake's neck.
+static Model run(const vector<Press>& presses, double loopMs, double tickMs, bool queued) {
+    Model m;
+    m.presses = static_cast<int>(presses.size());
+    TurnQueue turns;
+    Direction moving = Direction::RIGHT, next = Direction::RIGHT;
+    int pending = -1;
+    size_t seen = 0;
+    double accumulator = 0;
+    for (double now = 0; now < 61000; now += loopMs) {
+        for (; seen < presses.size() && presses[seen].ms <= now; seen++) {
+            Direction turn = presses[seen].turn;
+            if (queued) {
+                // The stamp is the press's index; ms comes from `presses`.
+                turns.push(turn, moving, seen);
+            }
+            else if (turn != reverse(next)) {
+                next = turn;
+                pending = static_cast<int>(seen);
+            }
+        }
+        for (accumulator += loopMs; accumulator >= tickMs; accumulator -= tickMs) {
+            int press = -1;
+            uint64_t stamp;
+            if (queued && turns.take(next, stamp)) {
+                press = static_cast<int>(stamp);
+            }
+            else if (!queued && next != moving) {
+                press = pending;
+            }
+            m.reversals += next == reverse(moving);
+            moving = next;
+            if (press >= 0) {
+                double ms = now - presses[press].ms;
+                m.applied++;
+                m.meanMs += ms;
+                m.worstMs = max(m.worstMs, ms);
+            }
+        }
+    }
+    m.meanMs /= max(1, m.applied);
+    return m;
+}
+
+static void print(const char* name, double loopMs, double tickMs, const Model& m) {
+    printf("%-20s %6.1f ms %5.0f ms %7d %7d %6.1f%% %9d %8.1f ms %8.1f ms\n", name, loopMs, tickMs, m.presses, m.applied,
+           100.0 * (m.presses - m.applied) / m.presses, m.reversals, m.meanMs, m.worstMs);
+}
+
+struct Stamped {
+    uint64_t sequence;
+    Clock::time_point pushed;
+};
+
+// The ring between two real threads: every value arrives, in order, and
+// how long it waited in between.
+static bool threaded(int count) {
+    static SpscRing<Stamped, 256> ring;
+    atomic<bool> done(false);
+    bool ordered = true;
+    double meanUs = 0, worstUs = 0;
+    thread consumer([&] {
+        uint64_t expect = 0;
+        Stamped s;
+        while (expect < static_cast<uint64_t>(count)) {
+            if (!ring.pop(s)) {
+                this_thread::yield();
+                continue;
+            }
+            double us = chrono::duration<double, micro>(Clock::now() - s.pushed).count();
+            ordered = ordered && s.sequence == expect;
+            expect++;
+            meanUs += us / count;
+            worstUs = max(worstUs, us);
+        }
+        done = true;
+    });
+    for (int i = 0; i < count; i++) {
+        while (!ring.push({ static_cast<uint64_t>(i), Clock::now() })) {
+            this_thread::yield();
+        }
+    }
+    consumer.join();
+
+    // The cost of a push and a pop, on one thread.
+    SpscRing<Stamped, 256> local;
+    const int rounds = 10000000;
+    Stamped s = {};
+    volatile uint64_t sum = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        local.push({ static_cast<uint64_t>(i), start });
+        local.pop(s);
+        sum = sum + s.sequence;
+    }
+    double ns = chrono::duration<double, nano>(Clock::now() - start).count() / rounds;
+    printf("ring between threads: %d events, waited %.1f us on average, %.1f us at most; push + pop %.1f ns\n", count, meanUs,
+           worstUs, ns);
+    return done && ordered;
+}
+
+int main() {
+    vector<Press> presses = player(7);
+    printf("%-20s %9s %8s %7s %7s %7s %9s %11s %11s\n", "input", "loop", "tick", "presses", "applied", "lost", "reversals",
+           "mean lag", "worst lag");
+    // The old game: one poll and one tick per 100 ms loop.
+    Model old = run(presses, 100, 100, false);
+    print("poll, 100 ms loop", 100, 100, old);
+    bool ok = old.reversals > 0;
+    const double frameMs = 1000 / 60.0;
+    for (double tickMs : { 100.0, 50.0, 25.0 }) {
+        Model polled = run(presses, frameMs, tickMs, false);
+        Model queued = run(presses, frameMs, tickMs, true);
+        print("poll per frame", frameMs, tickMs, polled);
+        print("ring + turn queue", frameMs, tickMs, queued);
+        ok = ok && queued.reversals == 0 && queued.applied == queued.presses;
+    }
+    printf("check the turn queue applies every press and never reverses: %s\n", ok ? "ok" : "FAILED");
+    bool ring = threaded(200000);
+    printf("check the ring delivers every event in order: %s\n", ring ? "ok" : "FAILED");
+    return ok && ring ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+#include "board.h"
+#include "levels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static double ms(Clock::time_point start) {
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+// One side x side level with a random map, as text.
+static string levelText(int side, Rng& rng, vector<uint8_t>& walls) {
+    string text = "level Big\nsize " + to_string(side) + " " + to_string(side) + "\nspawn 2 2 right\nmap\n";
+    walls.assign(static_cast<size_t>(side) * side, 0);
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            char c = '.';
+            if (y > 3 && rng.below(100) < 20) {
+                c = '#';
+                walls[static_cast<size_t>(y) * side + x] = 1;
+            } else if (y > 3 && rng.below(10000) == 0) {
+                c = "^v<>"[rng.below(4)];
+            }
+            text += c;
+        }
+        text += '\n';
+    }
+    return text + "end\n";
+}
+
+// Compiling text is the slow path the game only takes without levels.bin;
+// opening the binary is a map and validate(), which must not depend on the
+// size of the level. Reading every bit back (what the game's level load
+// does next) is timed separately.
+int main() {
+    // The damaged-file checks at the end start from the shipped catalog.
+    string shipped, error;
+    vector<uint8_t> bytes;
+    if (!readTextFile("levels.txt", shipped)) {
+        printf("levels.txt: cannot read; run level_bench from the directory it is in\n");
+        return 1;
+    }
+    if (!compileLevels(shipped, bytes, error)) {
+        printf("levels.txt: %s\n", error.c_str());
+        return 1;
+    }
+    const char* path = "level_bench.bin";
+    bool ok = true;
+    for (int side : { 40, 1024, 4096 }) {
+        Rng rng(side);
+        vector<uint8_t> walls;
+        string text = levelText(side, rng, walls);
+
+        auto start = Clock::now();
+        vector<uint8_t> bytes;
+        string error;
+        if (!compileLevels(text, bytes, error)) {
+            printf("compile failed: %s\n", error.c_str());
+            return 1;
+        }
+        double compile = ms(start);
+        FILE* f = fopen(path, "wb");
+        fwrite(bytes.data(), 1, bytes.size(), f);
+        fclose(f);
+
+        const int opens = 2000;
+        LevelCatalog catalog;
+        start = Clock::now();
+        for (int i = 0; i < opens; i++) {
+            ok = catalog.open(path, error) && ok;
+        }
+        double open = ms(start) / opens;
+
+        start = Clock::now();
+        bool same = catalog.count() == 1 && catalog.level(0).width == static_cast<uint32_t>(side);
+        for (int y = 0; y < side && same; y++) {
+            for (int x = 0; x < side; x++) {
+                same = same && catalog.wall(0, x, y) == (walls[static_cast<size_t>(y) * side + x] != 0);
+            }
+        }
+        double read = ms(start);
+        ok = ok && same;
+        printf("%4dx%-4d: text %9zu bytes compiled in %8.2f ms  binary %8zu bytes opened in %6.3f ms  read back in %7.2f ms  %s\n",
+               side, side, text.size(), compile, bytes.size(), open, read, same ? "ok" : "MISMATCH");
+    }
+
+    // Damaged files must be refused, not read past.
+    bool refused = true;
+    LevelCatalog catalog;
+    for (size_t cut : { size_t(0), size_t(10), sizeof(LevelFileHeader) + 5, bytes.size() - 8 }) {
+        vector<uint8_t> shortened(bytes.begin(), bytes.begin() + cut);
+        refused = refused && !catalog.adopt(std::move(shortened), error);
+    }
+    vector<uint8_t> badOffset = bytes;
+    reinterpret_cast<LevelInfo*>(badOffset.data() + sizeof(LevelFileHeader))[3].wallsOffset = bytes.size() - 8;
+    refused = refused && !catalog.adopt(std::move(badOffset), error);
+    vector<uint8_t> badVersion = bytes;
+    reinterpret_cast<LevelFileHeader*>(badVersion.data())->version++;
+    refused = refused && !catalog.adopt(std::move(badVersion), error);
+    refused = refused && catalog.adopt(std::move(bytes), error) && catalog.count() == 5;
+    printf("check damaged catalogs refused, levels.txt accepted: %s\n", refused ? "ok" : "FAILED");
+    remove(path);
+    return ok && refused ? 0 : 1;
+}
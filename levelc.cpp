@@ -0,0 +1,57 @@
+#include "levels.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Offline level compiler: levels.txt (see compileLevels() in levels.h) to the
+// memory-mappable levels.bin the game loads. The output is mapped back in
+// and validated the way the game does before anything is reported.
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        printf("usage: levelc LEVELS.txt LEVELS.bin\n");
+        return 1;
+    }
+    string text, error;
+    if (!readTextFile(argv[1], text)) {
+        printf("%s: cannot read\n", argv[1]);
+        return 1;
+    }
+    vector<uint8_t> bytes;
+    if (!compileLevels(text, bytes, error)) {
+        printf("%s: %s\n", argv[1], error.c_str());
+        return 1;
+    }
+    string tmp = string(argv[2]) + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    bool written = f != nullptr && fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    if (f != nullptr && fclose(f) != 0) {
+        written = false;
+    }
+    if (!written || rename(tmp.c_str(), argv[2]) != 0) {
+        printf("%s: cannot write\n", argv[2]);
+        remove(tmp.c_str());
+        return 1;
+    }
+
+    LevelCatalog catalog;
+    if (!catalog.open(argv[2], error)) {
+        printf("%s\n", error.c_str());
+        return 1;
+    }
+    static const char* styles[MAZE_STYLES] = { "rooms", "caves", "braided" };
+    for (int i = 0; i < catalog.count(); i++) {
+        const LevelInfo& info = catalog.level(i);
+        string size = info.width ? to_string(info.width) + "x" + to_string(info.height) : "any size";
+        printf("%2d  %-31s %-11s tick %3u ms  bonus %3u%%", i + 1, info.name, size.c_str(), info.tickMs, info.bonusPercent);
+        if (info.mazeStyle >= 0) printf("  maze %s %.2f", styles[info.mazeStyle], info.mazeDensity);
+        if (info.wallsOffset) printf("  walls");
+        if (info.moverCount) printf("  %u movers", info.moverCount);
+        if (info.randomMovers) printf("  %u random movers", info.randomMovers);
+        printf("\n");
+    }
+    printf("%s: %d levels, %zu bytes\n", argv[2], catalog.count(), catalog.bytes());
+    return 0;
+}
@@ -0,0 +1,453 @@
+#pragma once
+
+#include "board.h"
+#include "mapfile.h"
+#include "maze.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Level catalog file (levels.bin), little-endian, every offset a multiple of 8:
+//
+//   LevelFileHeader
+//   LevelInfo[levelCount]
+//   per level, at the offsets its LevelInfo gives:
+//     walls:  height rows of (width + 63) / 64 uint64_t words, bit x of
+//             word x / 64 set for a wall (the Bitboard row layout)
+//     movers: LevelMover[moverCount]
+//
+// Nothing in the file needs decoding: a loaded catalog is the mapped bytes
+// plus validate(), which checks every offset and count before anything is
+// read through them. Bump LEVEL_FILE_VERSION whenever a struct changes.
+const uint32_t LEVEL_FILE_MAGIC = 0x4C4B4E53;  // "SNKL"
+const uint32_t LEVEL_FILE_VERSION = 1;
+const int LEVEL_NAME_SIZE = 32;
+const uint32_t LEVEL_MAX_SIDE = 16384;
+
+struct LevelFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t levelCount;
+    uint32_t reserved;
+    uint64_t fileSize;
+};
+
+// width 0 means the level takes whatever board size the player picked and
+// has no walls, movers or spawn of its own; it can still be a maze or have
+// random movers, which are generated for the board at the start of a game.
+struct LevelInfo {
+    char name[LEVEL_NAME_SIZE];  // NUL-terminated
+    uint32_t width, height;
+    uint32_t tickMs;             // game tick; the speed power-up halves it
+    uint32_t bonusPercent;       // chance that a new food is a bonus
+    uint32_t bonusTicks;         // how long a bonus food stays
+    int32_t spawnX, spawnY;      // head cell, -1 for the middle of the board
+    uint32_t spawnDirection;     // Direction; the body trails behind the head
+    int32_t mazeStyle;           // MazeStyle generated each game, -1 for none
+    float mazeDensity;
+    uint32_t randomMovers;       // moving obstacles dropped at random per 40x30 cells
+    uint32_t moverCount;         // movers placed by the map
+    uint64_t wallsOffset;        // 0 when the level has no walls
+    uint64_t moversOffset;
+};
+
+struct LevelMover {
+    int32_t x, y;
+    uint32_t direction;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(LevelFileHeader) == 24, "level file layout changed");
+static_assert(sizeof(LevelInfo) == 96, "level file layout changed");
+static_assert(sizeof(LevelMover) == 16, "level file layout changed");
+
+inline size_t levelWallWords(const LevelInfo& info) {
+    return static_cast<size_t>((info.width + 63) / 64) * info.height;
+}
+
+// Read-only view of a catalog, either a mapped levels.bin or bytes it owns
+// (a catalog compiled in memory). Not copyable; move the bytes in instead.
+class LevelCatalog {
+public:
+    LevelCatalog() {}
+    LevelCatalog(const LevelCatalog&) = delete;
+    LevelCatalog& operator=(const LevelCatalog&) = delete;
+    ~LevelCatalog() { close(); }
+
+    // Maps the file and validates it; on failure the catalog is left empty.
+    bool open(const char* path, std::string& error) {
+        close();
+        if (!file_.open(path, error)) {
+            return false;
+        }
+        data_ = file_.data();
+        size_ = file_.size();
+        if (!validate(error)) {
+            error = std::string(path) + ": " + error;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    bool adopt(std::vector<uint8_t>&& bytes, std::string& error) {
+        close();
+        owned_ = std::move(bytes);
+        data_ = owned_.data();
+        size_ = owned_.size();
+        if (!validate(error)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        file_.close();
+        owned_.clear();
+        owned_.shrink_to_fit();
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    // Takes over a catalog loaded elsewhere, e.g. on another thread; `other`
+    // is left holding the old one and releases it when it is destroyed.
+    void swap(LevelCatalog& other) {
+        file_.swap(other.file_);
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        owned_.swap(other.owned_);
+    }
+
+    int count() const { return data_ ? static_cast<int>(header().levelCount) : 0; }
+    bool mapped() const { return file_.isOpen(); }
+    size_t bytes() const { return size_; }
+
+    const LevelInfo& level(int i) const {
+        return reinterpret_cast<const LevelInfo*>(data_ + sizeof(LevelFileHeader))[i];
+    }
+
+    // Row y of level i's wall bitmap, or nullptr if the level has no walls.
+    const uint64_t* wallRow(int i, int y) const {
+        const LevelInfo& info = level(i);
+        if (info.wallsOffset == 0) {
+            return nullptr;
+        }
+        return reinterpret_cast<const uint64_t*>(data_ + info.wallsOffset) + static_cast<size_t>((info.width + 63) / 64) * y;
+    }
+
+    bool wall(int i, int x, int y) const {
+        const uint64_t* row = wallRow(i, y);
+        return row != nullptr && ((row[x >> 6] >> (x & 63)) & 1);
+    }
+
+    const LevelMover* movers(int i) const {
+        return reinterpret_cast<const LevelMover*>(data_ + level(i).moversOffset);
+    }
+
+    // Sets level i's walls to 1 (CELL_WALL) in `blocked`, a board of the
+    // level's size in Layout order; other cells are left alone.
+    void loadWalls(int i, std::vector<uint8_t>& blocked) const {
+        const LevelInfo& info = level(i);
+        for (uint32_t y = 0; y < info.height && info.wallsOffset != 0; y++) {
+            const uint64_t* row = wallRow(i, static_cast<int>(y));
+            uint8_t* out = &blocked[static_cast<size_t>(y) * info.width];
+            for (uint32_t x = 0; x < info.width; x++) {
+                out[x] |= static_cast<uint8_t>((row[x >> 6] >> (x & 63)) & 1);
+            }
+        }
+    }
+
+private:
+    const LevelFileHeader& header() const { return *reinterpret_cast<const LevelFileHeader*>(data_); }
+
+    // Everything later reads through an offset or a count is checked here,
+    // so a truncated or hand-edited file is refused instead of read past.
+    // The wall bitmap itself is not scanned, so this costs the same for a
+    // 4096x4096 level as for a 40x30 one.
+    bool validate(std::string& error) const {
+        if (size_ < sizeof(LevelFileHeader)) {
+            error = "too short for a level catalog";
+            return false;
+        }
+        const LevelFileHeader& h = header();
+        if (h.magic != LEVEL_FILE_MAGIC) {
+            error = "not a level catalog";
+            return false;
+        }
+        if (h.version != LEVEL_FILE_VERSION) {
+            error = "catalog version " + std::to_string(h.version) + ", expected " + std::to_string(LEVEL_FILE_VERSION);
+            return false;
+        }
+        if (h.fileSize != size_) {
+            error = "catalog is " + std::to_string(size_) + " bytes, header says " + std::to_string(h.fileSize);
+            return false;
+        }
+        if (h.levelCount == 0 || h.levelCount > (size_ - sizeof(LevelFileHeader)) / sizeof(LevelInfo)) {
+            error = "bad level count";
+            return false;
+        }
+        for (int i = 0; i < static_cast<int>(h.levelCount); i++) {
+            std::string why = validateLevel(level(i));
+            if (!why.empty()) {
+                error = "level " + std::to_string(i + 1) + ": " + why;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool inFile(uint64_t offset, uint64_t bytes) const {
+        return offset % 8 == 0 && offset <= size_ && bytes <= size_ - offset;
+    }
+
+    std::string validateLevel(const LevelInfo& info) const {
+        if (memchr(info.name, 0, LEVEL_NAME_SIZE) == nullptr) {
+            return "name is not terminated";
+        }
+        if (info.tickMs < 10 || info.tickMs > 1000 || info.bonusPercent > 100 || info.bonusTicks == 0) {
+            return "tick or bonus out of range";
+        }
+        if (info.spawnDirection > 3 || info.mazeStyle < -1 || info.mazeStyle >= MAZE_STYLES ||
+            !(info.mazeDensity >= 0.0f && info.mazeDensity <= 1.0f)) {
+            return "bad spawn direction or maze";
+        }
+        if (info.width == 0 || info.height == 0) {
+            if (info.width != info.height || info.wallsOffset != 0 || info.moverCount != 0 || info.spawnX != -1 || info.spawnY != -1) {
+                return "a level without a size cannot have walls, movers or a spawn";
+            }
+            return "";
+        }
+        if (info.width < 4 || info.height < 4 || info.width > LEVEL_MAX_SIDE || info.height > LEVEL_MAX_SIDE) {
+            return "size out of range";
+        }
+        if (info.wallsOffset != 0 && !inFile(info.wallsOffset, levelWallWords(info) * 8)) {
+            return "wall bitmap outside the file";
+        }
+        if (info.moverCount > size_ / sizeof(LevelMover) || !inFile(info.moversOffset, uint64_t(info.moverCount) * sizeof(LevelMover))) {
+            return "movers outside the file";
+        }
+        const LevelMover* m = reinterpret_cast<const LevelMover*>(data_ + info.moversOffset);
+        for (uint32_t k = 0; k < info.moverCount; k++) {
+            if (m[k].x < 0 || m[k].y < 0 || static_cast<uint32_t>(m[k].x) >= info.width || static_cast<uint32_t>(m[k].y) >= info.height ||
+                m[k].direction > 3) {
+                return "mover outside the board";
+            }
+        }
+        int w = static_cast<int>(info.width), hgt = static_cast<int>(info.height);
+        int sx = info.spawnX < 0 ? w / 2 : info.spawnX, sy = info.spawnY < 0 ? hgt / 2 : info.spawnY;
+        static const int dx[4] = { 0, 0, -1, 1 };
+        static const int dy[4] = { -1, 1, 0, 0 };
+        for (int k = 0; k < 3; k++) {
+            int x = sx - k * dx[info.spawnDirection], y = sy - k * dy[info.spawnDirection];
+            if (x < 0 || y < 0 || x >= w || y >= hgt) {
+                return "snake starts outside the board";
+            }
+            if (info.wallsOffset != 0) {
+                const uint64_t* row = reinterpret_cast<const uint64_t*>(data_ + info.wallsOffset) + static_cast<size_t>((w + 63) / 64) * y;
+                if ((row[x >> 6] >> (x & 63)) & 1) {
+                    return "snake starts on a wall";
+                }
+            }
+        }
+        return "";
+    }
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    MappedFile file_;
+    std::vector<uint8_t> owned_;
+};
+
+// Text form of a catalog, one level after another; '#' starts a comment
+// line. Every line inside a level is optional except "level" and "end":
+//
+//   level NAME                     starts a level
+//   size W H                       fixed board size (else the player's choice)
+//   tick MS                        game tick, default 100
+//   bonus PERCENT [TICKS]          bonus food chance and lifetime, default 10 60
+//   spawn X Y up|down|left|right   head cell and heading, default middle, right
+//   maze rooms|caves|braided DENSITY
+//   movers N                       random movers per 40x30 cells
+//   map                            then H rows of W characters: '.' open,
+//                                  '#' wall, '^' 'v' '<' '>' a mover heading that way
+//   end
+//
+// Compiles to the levels.bin layout above; errors name the line.
+inline bool compileLevels(const std::string& text, std::vector<uint8_t>& out, std::string& error) {
+    struct Pending {
+        LevelInfo info;
+        std::vector<uint64_t> walls;
+        std::vector<LevelMover> movers;
+    };
+    std::vector<Pending> levels;
+    Pending* cur = nullptr;
+    int lineNo = 0, mapRows = -1;
+    auto fail = [&](const std::string& why) {
+        error = "line " + std::to_string(lineNo) + ": " + why;
+        return false;
+    };
+    auto direction = [](const std::string& s) {
+        static const char* names[4] = { "up", "down", "left", "right" };
+        for (int d = 0; d < 4; d++) {
+            if (s == names[d]) return d;
+        }
+        return -1;
+    };
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string::npos) end = text.size();
+        std::string line = text.substr(pos, end - pos);
+        pos = end + 1;
+        lineNo++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        if (mapRows >= 0) {
+            LevelInfo& info = cur->info;
+            if (line.size() != info.width) {
+                return fail("map row is " + std::to_string(line.size()) + " wide, expected " + std::to_string(info.width));
+            }
+            uint64_t* row = &cur->walls[static_cast<size_t>((info.width + 63) / 64) * mapRows];
+            for (int x = 0; x < static_cast<int>(info.width); x++) {
+                char c = line[x];
+                int d = c == '^' ? 0 : c == 'v' ? 1 : c == '<' ? 2 : c == '>' ? 3 : -1;
+                if (c == '#') {
+                    row[x >> 6] |= 1ull << (x & 63);
+                } else if (d >= 0) {
+                    cur->movers.push_back({ x, mapRows, static_cast<uint32_t>(d), 0 });
+                } else if (c != '.') {
+                    return fail(std::string("unknown map character '") + c + "'");
+                }
+            }
+            if (++mapRows == static_cast<int>(info.height)) {
+                mapRows = -1;
+            }
+            continue;
+        }
+
+        char word[32] = "";
+        if (line.empty() || line[0] == '#' || sscanf(line.c_str(), "%31s", word) != 1) {
+            continue;
+        }
+        std::string key = word;
+        const char* rest = line.c_str() + line.find(key) + key.size();
+        while (*rest == ' ' || *rest == '\t') rest++;
+
+        if (key == "level") {
+            if (cur != nullptr) return fail("level inside a level; missing end");
+            if (*rest == 0 || strlen(rest) >= LEVEL_NAME_SIZE) return fail("level needs a name under 32 characters");
+            levels.push_back(Pending());
+            cur = &levels.back();
+            LevelInfo& info = cur->info;
+            memset(&info, 0, sizeof(info));
+            strcpy(info.name, rest);
+            info.tickMs = 100;
+            info.bonusPercent = 10;
+            info.bonusTicks = 60;
+            info.spawnX = info.spawnY = -1;
+            info.spawnDirection = static_cast<uint32_t>(Direction::RIGHT);
+            info.mazeStyle = -1;
+            continue;
+        }
+        if (cur == nullptr) return fail("'" + key + "' outside a level");
+        LevelInfo& info = cur->info;
+        if (key == "end") {
+            if ((info.spawnX >= 0 || !cur->walls.empty() || !cur->movers.empty()) && info.width == 0) {
+                return fail("spawn and map need a size");
+            }
+            cur = nullptr;
+        } else if (key == "size") {
+            unsigned w, h;
+            if (sscanf(rest, "%u %u", &w, &h) != 2 || w < 4 || h < 4 || w > LEVEL_MAX_SIDE || h > LEVEL_MAX_SIDE) {
+                return fail("size needs a width and height from 4 to 16384");
+            }
+            info.width = w;
+            info.height = h;
+        } else if (key == "tick") {
+            if (sscanf(rest, "%u", &info.tickMs) != 1 || info.tickMs < 10 || info.tickMs > 1000) {
+                return fail("tick needs milliseconds from 10 to 1000");
+            }
+        } else if (key == "bonus") {
+            int n = sscanf(rest, "%u %u", &info.bonusPercent, &info.bonusTicks);
+            if (n < 1 || info.bonusPercent > 100 || info.bonusTicks == 0) {
+                return fail("bonus needs a percentage and optionally a tick count");
+            }
+        } else if (key == "spawn") {
+            char dir[16] = "";
+            if (sscanf(rest, "%d %d %15s", &info.spawnX, &info.spawnY, dir) != 3 || direction(dir) < 0 || info.spawnX < 0 || info.spawnY < 0) {
+                return fail("spawn needs a cell and up, down, left or right");
+            }
+            info.spawnDirection = static_cast<uint32_t>(direction(dir));
+        } else if (key == "maze") {
+            static const char* styles[MAZE_STYLES] = { "rooms", "caves", "braided" };
+            char style[16] = "";
+            if (sscanf(rest, "%15s %f", style, &info.mazeDensity) != 2 || !(info.mazeDensity >= 0.0f && info.mazeDensity <= 1.0f)) {
+                return fail("maze needs rooms, caves or braided and a density from 0 to 1");
+            }
+            info.mazeStyle = -1;
+            for (int s = 0; s < MAZE_STYLES; s++) {
+                if (strcmp(style, styles[s]) == 0) info.mazeStyle = s;
+            }
+            if (info.mazeStyle < 0) return fail(std::string("unknown maze style ") + style);
+        } else if (key == "movers") {
+            if (sscanf(rest, "%u", &info.randomMovers) != 1) return fail("movers needs a count");
+        } else if (key == "map") {
+            if (info.width == 0) return fail("map needs a size first");
+            cur->walls.assign(levelWallWords(info), 0);
+            mapRows = 0;
+        } else {
+            return fail("unknown keyword '" + key + "'");
+        }
+    }
+    if (mapRows >= 0) return fail("map ends early");
+    if (cur != nullptr) return fail("last level has no end");
+    if (levels.empty()) return fail("no levels");
+
+    uint64_t offset = sizeof(LevelFileHeader) + levels.size() * sizeof(LevelInfo);
+    offset = (offset + 7) / 8 * 8;
+    for (Pending& p : levels) {
+        p.info.moverCount = static_cast<uint32_t>(p.movers.size());
+        if (!p.walls.empty()) {
+            p.info.wallsOffset = offset;
+            offset += p.walls.size() * 8;
+        }
+        p.info.moversOffset = offset;
+        offset += p.movers.size() * sizeof(LevelMover);
+    }
+    out.assign(offset, 0);
+    LevelFileHeader h = { LEVEL_FILE_MAGIC, LEVEL_FILE_VERSION, static_cast<uint32_t>(levels.size()), 0, offset };
+    memcpy(out.data(), &h, sizeof(h));
+    for (size_t i = 0; i < levels.size(); i++) {
+        const Pending& p = levels[i];
+        memcpy(out.data() + sizeof(h) + i * sizeof(LevelInfo), &p.info, sizeof(LevelInfo));
+        if (!p.walls.empty()) {
+            memcpy(out.data() + p.info.wallsOffset, p.walls.data(), p.walls.size() * 8);
+        }
+        if (!p.movers.empty()) {
+            memcpy(out.data() + p.info.moversOffset, p.movers.data(), p.movers.size() * sizeof(LevelMover));
+        }
+    }
+    return true;
+}
+
+inline bool readTextFile(const char* path, std::string& text) {
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) {
+        return false;
+    }
+    char buf[1 << 16];
+    size_t n;
+    text.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        text.append(buf, n);
+    }
+    fclose(f);
+    return true;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A file, or a range of one, mapped read-only: mmap on POSIX, MapViewOfFile
+// on Windows. Pages are read in on first touch, so opening costs the same
+// however large the file is. Not copyable; swap() hands a mapping over.
+class MappedFile {
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    // An empty file or range cannot be mapped and counts as an error, as does
+    // a range past the end of the file. `length` 0 maps from `offset` to the
+    // end. The view starts at the page (Windows: allocation granularity) that
+    // holds `offset`; data() points at `offset` itself.
+    bool open(const char* path, std::string& error, uint64_t offset = 0, size_t length = 0) {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            error = std::string(path) + ": cannot open";
+            return false;
+        }
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        uint64_t start = offset / info.dwAllocationGranularity * info.dwAllocationGranularity;
+        bool fits = range(static_cast<uint64_t>(size.QuadPart), offset, length);
+        HANDLE mapping = fits ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+        CloseHandle(file);
+        if (mapping == NULL) {
+            error = std::string(path) + ": cannot map";
+            return false;
+        }
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(start >> 32), static_cast<DWORD>(start),
+                                   static_cast<size_t>(offset - start) + length);
+        CloseHandle(mapping);
+        if (view == NULL) {
+            error = std::string(path) + ": cannot map";
+            return false;
+        }
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            error = std::string(path) + ": cannot open";
+            return false;
+        }
+        uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        uint64_t start = offset / page * page;
+        struct stat st;
+        void* view = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && range(static_cast<uint64_t>(st.st_size), offset, length)) {
+            view = mmap(nullptr, static_cast<size_t>(offset - start) + length, PROT_READ, MAP_PRIVATE, fd,
+                        static_cast<off_t>(start));
+        }
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            error = std::string(path) + ": cannot map";
+            return false;
+        }
+#endif
+        view_ = view;
+        skip_ = static_cast<size_t>(offset - start);
+        size_ = length;
+        return true;
+    }
+
+    void close() {
+        if (view_ != nullptr) {
+#ifdef _WIN32
+            UnmapViewOfFile(view_);
+#else
+            munmap(view_, skip_ + size_);
+#endif
+        }
+        view_ = nullptr;
+        skip_ = 0;
+        size_ = 0;
+    }
+
+    void swap(MappedFile& other) {
+        std::swap(view_, other.view_);
+        std::swap(skip_, other.skip_);
+        std::swap(size_, other.size_);
+    }
+
+    bool isOpen() const { return view_ != nullptr; }
+    const uint8_t* data() const { return static_cast<const uint8_t*>(view_) + skip_; }
+    size_t size() const { return size_; }
+
+private:
+    // Settles a zero `length` to the rest of the file; false if that leaves
+    // nothing to map or the range runs past the end.
+    static bool range(uint64_t fileSize, uint64_t offset, size_t& length) {
+        if (offset >= fileSize) {
+            return false;
+        }
+        if (length == 0) {
+            length = static_cast<size_t>(fileSize - offset);
+        }
+        return length <= fileSize - offset;
+    }
+
+    void* view_ = nullptr;
+    size_t skip_ = 0;  // from the start of the view to the requested offset
+    size_t size_ = 0;
+};
@@ -0,0 +1,517 @@
+#pragma once
+
+#include "board.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// Procedural levels written into a Layout's blocked grid. Everything is drawn
+// from one Rng seeded with the level seed, so the same (style, density, seed,
+// size) always gives the same level and levels never need to be stored.
+// Every style leaves the open cells in one connected region.
+enum MazeStyle { MAZE_DIVISION, MAZE_CAVES, MAZE_BRAIDED, MAZE_STYLES };
+
+inline const char* mazeStyleName(MazeStyle style) {
+    static const char* names[] = { "Rooms", "Caves", "Braided maze" };
+    return style < MAZE_STYLES ? names[style] : "?";
+}
+
+namespace maze_detail {
+
+inline int findRoot(std::vector<int>& parent, int c) {
+    while (parent[c] != c) {
+        parent[c] = parent[parent[c]];
+        c = parent[c];
+    }
+    return c;
+}
+
+// First open cell in [c, end), or end; eight cells per load while they are
+// all blocked.
+inline int nextOpen(const uint8_t* blocked, int c, int end) {
+    for (uint64_t w; c + 8 <= end; c += 8) {
+        memcpy(&w, blocked + c, 8);
+        if ((w - 0x0101010101010101ull) & ~w & 0x8080808080808080ull) {
+            break;
+        }
+    }
+    while (c < end && blocked[c]) {
+        c++;
+    }
+    return c;
+}
+
+// First blocked cell in [c, end), or end.
+inline int nextBlocked(const uint8_t* blocked, int c, int end) {
+    for (uint64_t w; c + 8 <= end; c += 8) {
+        memcpy(&w, blocked + c, 8);
+        if (w != 0) {
+            break;
+        }
+    }
+    while (c < end && !blocked[c]) {
+        c++;
+    }
+    return c;
+}
+
+// Open cells as runs along the rows, [first, last) in board order, with the
+// region each belongs to: runs touching one in the row above are merged with
+// union-find, so labelling is one sequential pass and never touches a
+// per-cell array. root[r] is the lowest-numbered run of r's region.
+struct Runs {
+    std::vector<int> first, last, root;
+    int regions = 0;
+
+    void label(const Layout& layout) {
+        int width = layout.width;
+        const uint8_t* blocked = layout.blocked.data();
+        first.clear();
+        last.clear();
+        root.clear();
+        size_t above = 0;
+        for (int y = 0; y < layout.height; y++) {
+            size_t rowStart = first.size();
+            int rowEnd = (y + 1) * width;
+            for (int c = nextOpen(blocked, y * width, rowEnd); c < rowEnd; c = nextOpen(blocked, c, rowEnd)) {
+                int s = c;
+                c = nextBlocked(blocked, c, rowEnd);
+                int r = static_cast<int>(first.size());
+                first.push_back(s);
+                last.push_back(c);
+                root.push_back(r);
+                // Runs above that end before this one starts can not touch later ones either.
+                while (above < rowStart && last[above] + width <= s) {
+                    above++;
+                }
+                for (size_t a = above; a < rowStart && first[a] + width < c; a++) {
+                    int ra = findRoot(root, static_cast<int>(a)), rr = findRoot(root, r);
+                    if (ra != rr) {
+                        root[ra > rr ? ra : rr] = ra < rr ? ra : rr;
+                    }
+                }
+            }
+            above = rowStart;
+        }
+        regions = 0;
+        for (int r = 0; r < static_cast<int>(root.size()); r++) {
+            root[r] = root[root[r]];
+            regions += root[r] == r;
+        }
+    }
+};
+
+// Joins every open region to the first one by breadth-first search in layers
+// of walls crossed: open cells join the layer they are reached from, walls go
+// to the next. The first time an open cell is reached through walls, the
+// walls back along its path are opened, which links it (and later its whole
+// region) to cells already joined. Always succeeds but jumps all over memory.
+inline int digToRegions(Layout& layout) {
+    int cells = layout.cells(), width = layout.width;
+    uint8_t* blocked = layout.blocked.data();
+    int start = nextOpen(blocked, 0, cells);
+    if (start == cells) {
+        return 0;
+    }
+    std::vector<int> parent(cells, -1);
+    std::vector<uint8_t> seen(cells, 0);
+    std::vector<int> layer, nextLayer;
+    layer.reserve(cells);
+    layer.push_back(start);
+    seen[start] = 1;
+    int carved = 0;
+    while (!layer.empty()) {
+        nextLayer.clear();
+        for (size_t head = 0; head < layer.size(); head++) {
+            int c = layer[head], x = c % width;
+            int around[4] = { x > 0 ? c - 1 : -1, x < width - 1 ? c + 1 : -1, c - width, c + width < cells ? c + width : -1 };
+            for (int n : around) {
+                if (n < 0 || seen[n]) {
+                    continue;
+                }
+                seen[n] = 1;
+                parent[n] = c;
+                if (blocked[n]) {
+                    nextLayer.push_back(n);
+                    continue;
+                }
+                for (int p = c; p >= 0 && blocked[p]; p = parent[p]) {
+                    blocked[p] = 0;
+                    carved++;
+                }
+                layer.push_back(n);
+            }
+        }
+        layer.swap(nextLayer);
+    }
+    return carved;
+}
+
+}  // namespace maze_detail
+
+// True when every open cell can reach every other one (vacuously true when
+// nothing is open).
+inline bool layoutConnected(const Layout& layout) {
+    maze_detail::Runs runs;
+    runs.label(layout);
+    return runs.regions <= 1;
+}
+
+// Joins all open regions into one by opening wall cells; returns how many
+// were opened. Regions under minRegion cells (other than the largest) are
+// filled in instead. Candidate tunnels are the straight stretches of wall in
+// a row or column with different regions at either end, keeping only the
+// shortest of neighbouring columns that join the same two regions. They are
+// taken shortest first, skipping any whose ends are already joined
+// (Kruskal's algorithm over the regions), which needs only sequential passes
+// over the board. Regions no straight tunnel reaches are dug to breadth-first.
+inline int connectLayout(Layout& layout, int minRegion = 0) {
+    int width = layout.width;
+    maze_detail::Runs runs;
+    runs.label(layout);
+    int regions = runs.regions;
+    int count = static_cast<int>(runs.first.size());
+    if (regions > 1 && minRegion > 1) {
+        std::vector<int> size(count, 0);
+        int largest = 0;
+        for (int r = 0; r < count; r++) {
+            size[runs.root[r]] += runs.last[r] - runs.first[r];
+            largest = size[runs.root[r]] > size[largest] ? runs.root[r] : largest;
+        }
+        for (int r = 0; r < count; r++) {
+            int root = runs.root[r];
+            if (size[root] >= minRegion || root == largest) {
+                continue;
+            }
+            std::fill(&layout.blocked[runs.first[r]], &layout.blocked[runs.last[r]], 1);
+            regions -= root == r;
+            runs.root[r] = -1;
+        }
+    }
+    if (regions <= 1) {
+        return 0;
+    }
+
+    // Tunnels run between open cells from and to (exclusive), whose runs'
+    // regions are a and b.
+    struct Tunnel {
+        int from, to, a, b, length;
+    };
+    std::vector<Tunnel> tunnels;
+    std::vector<int> lastRow(width, -1), lastRoot(width, -1);
+    for (int r = 0; r < count; r++) {
+        int root = runs.root[r];
+        if (root < 0) {
+            continue;
+        }
+        int first = runs.first[r], y = first / width, x0 = first - y * width, x1 = runs.last[r] - y * width;
+        int left = r - 1;
+        while (left >= 0 && runs.root[left] < 0) {
+            left--;
+        }
+        if (left >= 0 && runs.last[left] > y * width && runs.root[left] != root) {
+            tunnels.push_back({ runs.last[left] - 1, first, runs.root[left], root, first - runs.last[left] });
+        }
+        int previous = -1;  // tunnel found in column x - 1, if any
+        for (int x = x0; x < x1; x++) {
+            int above = lastRow[x], a = lastRoot[x];
+            lastRow[x] = y;
+            lastRoot[x] = root;
+            if (above < 0 || above == y - 1 || a == root) {
+                previous = -1;
+                continue;
+            }
+            int length = y - above - 1;
+            if (previous >= 0 && tunnels[previous].a == a) {
+                if (length < tunnels[previous].length) {
+                    tunnels[previous] = { above * width + x, y * width + x, a, root, length };
+                }
+                continue;
+            }
+            previous = static_cast<int>(tunnels.size());
+            tunnels.push_back({ above * width + x, y * width + x, a, root, length });
+        }
+    }
+
+    // Counting sort by length.
+    int longest = std::max(width, layout.height);
+    std::vector<int> start(longest + 1, 0);
+    for (const Tunnel& t : tunnels) {
+        start[t.length]++;
+    }
+    for (int length = 0, total = 0; length <= longest; length++) {
+        int count = start[length];
+        start[length] = total;
+        total += count;
+    }
+    std::vector<int> order(tunnels.size());
+    for (size_t i = 0; i < tunnels.size(); i++) {
+        order[start[tunnels[i].length]++] = static_cast<int>(i);
+    }
+
+    std::vector<int>& joined = runs.root;
+    int carved = 0;
+    for (int i : order) {
+        const Tunnel& t = tunnels[i];
+        int a = maze_detail::findRoot(joined, t.a), b = maze_detail::findRoot(joined, t.b);
+        if (a == b) {
+            continue;
+        }
+        joined[a > b ? a : b] = a < b ? a : b;
+        int stride = t.to - t.from >= width ? width : 1;
+        for (int c = t.from + stride; c < t.to; c += stride) {
+            layout.blocked[c] = 0;
+            carved++;
+        }
+        if (--regions == 1) {
+            return carved;
+        }
+    }
+    return carved + maze_detail::digToRegions(layout);
+}
+
+namespace maze_detail {
+
+// Recursive division, done with an explicit stack. Walls only ever go on odd
+// columns/rows and their single gaps on even ones, so a later wall can never
+// close an earlier gap and the result is connected by construction. Chambers
+// no larger than `room` in both directions are left as open rooms.
+inline void division(Layout& layout, int room, Rng& rng) {
+    struct Chamber {
+        int x0, y0, x1, y1;
+    };
+    std::fill(layout.blocked.begin(), layout.blocked.end(), 0);
+    std::vector<Chamber> stack;
+    stack.push_back({ 0, 0, layout.width - 1, layout.height - 1 });
+    while (!stack.empty()) {
+        Chamber ch = stack.back();
+        stack.pop_back();
+        int w = ch.x1 - ch.x0 + 1, h = ch.y1 - ch.y0 + 1;
+        if ((w <= room && h <= room) || (w < 3 && h < 3)) {
+            continue;
+        }
+        bool vertical = w > h || (w == h && rng.below(2) == 0);
+        if (vertical ? w < 3 : h < 3) {
+            vertical = !vertical;
+        }
+        if (vertical) {
+            int wx = ch.x0 + 1 + 2 * rng.below((w - 1) / 2);
+            int gap = ch.y0 + 2 * rng.below((h + 1) / 2);
+            for (int y = ch.y0; y <= ch.y1; y++) {
+                layout.blocked[layout.cell(wx, y)] = y != gap;
+            }
+            stack.push_back({ ch.x0, ch.y0, wx - 1, ch.y1 });
+            stack.push_back({ wx + 1, ch.y0, ch.x1, ch.y1 });
+        } else {
+            int wy = ch.y0 + 1 + 2 * rng.below((h - 1) / 2);
+            int gap = ch.x0 + 2 * rng.below((w + 1) / 2);
+            uint8_t* row = &layout.blocked[layout.cell(0, wy)];
+            for (int x = ch.x0; x <= ch.x1; x++) {
+                row[x] = x != gap;
+            }
+            stack.push_back({ ch.x0, ch.y0, ch.x1, wy - 1 });
+            stack.push_back({ ch.x0, wy + 1, ch.x1, ch.y1 });
+        }
+    }
+}
+
+// out[x] = a[x] + b[x] + c[x] over n cells, n a multiple of 16. The fixed
+// inner block is what lets GCC vectorise this at -O2.
+inline void add3(const uint8_t* __restrict a, const uint8_t* __restrict b, const uint8_t* __restrict c,
+                 uint8_t* __restrict out, int n) {
+    for (int x = 0; x < n; x += 16) {
+        for (int k = x; k < x + 16; k++) {
+            out[k] = static_cast<uint8_t>(a[k] + b[k] + c[k]);
+        }
+    }
+}
+
+// out[x] = whether a[x] + b[x] + c[x] is at least 5, over any n cells.
+inline void atLeast5(const uint8_t* __restrict a, const uint8_t* __restrict b, const uint8_t* __restrict c,
+                     uint8_t* __restrict out, int n) {
+    int x = 0;
+    for (; x + 16 <= n; x += 16) {
+        for (int k = x; k < x + 16; k++) {
+            out[k] = a[k] + b[k] + c[k] >= 5;
+        }
+    }
+    for (; x < n; x++) {
+        out[x] = a[x] + b[x] + c[x] >= 5;
+    }
+}
+
+// Cellular caves: random fill, then a few rounds of "a cell is wall when at
+// least five of the nine cells around it (itself included, off-board counting
+// as wall) are". Neighbour counts come from rolling per-row sums, so a round
+// is a handful of byte additions per cell. Pockets under 16 cells are filled
+// in and the rest joined by tunnels.
+inline void caves(Layout& layout, int fillPercent, Rng& rng) {
+    int width = layout.width, height = layout.height, cells = layout.cells();
+    uint8_t* blocked = layout.blocked.data();
+    // Eight cells per random number, one byte each.
+    unsigned threshold = static_cast<unsigned>(fillPercent * 256 / 100);
+    for (int c = 0; c < cells; c += 8) {
+        uint64_t bits = rng.next();
+        for (int k = 0; k < 8 && c + k < cells; k++) {
+            blocked[c + k] = ((bits >> (8 * k)) & 0xFF) < threshold;
+        }
+    }
+
+    // Rows are copied with a wall cell either side, so every horizontal sum
+    // is the same three loads; buffers are rounded up to whole blocks.
+    int span = (width + 2 + 15) / 16 * 16;
+    std::vector<uint8_t> next(cells), padded(span + 16, 1);
+    std::vector<uint8_t> sums[3];
+    for (std::vector<uint8_t>& s : sums) {
+        s.assign(span, 3);
+    }
+    auto rowSums = [&](int y, uint8_t* out) {
+        if (y < 0 || y >= height) {
+            std::fill(out, out + span, 3);
+            return;
+        }
+        memcpy(&padded[1], blocked + static_cast<size_t>(y) * width, width);
+        add3(&padded[0], &padded[1], &padded[2], out, span);
+    };
+    for (int round = 0; round < 4; round++) {
+        rowSums(-1, sums[0].data());
+        rowSums(0, sums[1].data());
+        for (int y = 0; y < height; y++) {
+            rowSums(y + 1, sums[(y + 2) % 3].data());
+            atLeast5(sums[y % 3].data(), sums[(y + 1) % 3].data(), sums[(y + 2) % 3].data(), &next[static_cast<size_t>(y) * width], width);
+        }
+        layout.blocked.swap(next);
+        blocked = layout.blocked.data();
+    }
+    connectLayout(layout, 16);
+}
+
+// Perfect maze by randomised depth-first search over the cells at even
+// coordinates (walls sit between them, on odd ones), then braided: each dead
+// end is opened into a neighbouring corridor with probability `braid`,
+// preferring a neighbour that is itself a dead end. The search works on one
+// byte of passage bits per maze cell, framed by a border of cells it may not
+// enter, and the layout is written from those bits in one pass at the end.
+// On even-sized boards the last column and row would be solid wall; they are
+// left open.
+inline void braided(Layout& layout, float braid, Rng& rng) {
+    enum { VISITED = 1, EAST = 2, SOUTH = 4, BORDER = 8 };
+    // Each order of the four directions, so a random one picks uniformly
+    // among whichever neighbours turn out to be free.
+    static const uint8_t orders[24][4] = {
+        { 0, 1, 2, 3 }, { 0, 1, 3, 2 }, { 0, 2, 1, 3 }, { 0, 2, 3, 1 }, { 0, 3, 1, 2 }, { 0, 3, 2, 1 },
+        { 1, 0, 2, 3 }, { 1, 0, 3, 2 }, { 1, 2, 0, 3 }, { 1, 2, 3, 0 }, { 1, 3, 0, 2 }, { 1, 3, 2, 0 },
+        { 2, 0, 1, 3 }, { 2, 0, 3, 1 }, { 2, 1, 0, 3 }, { 2, 1, 3, 0 }, { 2, 3, 0, 1 }, { 2, 3, 1, 0 },
+        { 3, 0, 1, 2 }, { 3, 0, 2, 1 }, { 3, 1, 0, 2 }, { 3, 1, 2, 0 }, { 3, 2, 0, 1 }, { 3, 2, 1, 0 },
+    };
+    int width = layout.width, height = layout.height;
+    int nw = (width + 1) / 2, nh = (height + 1) / 2, pitch = nw + 2;
+    std::vector<uint8_t> links(static_cast<size_t>(pitch) * (nh + 2), BORDER | VISITED);
+    for (int y = 1; y <= nh; y++) {
+        std::fill(&links[y * pitch + 1], &links[y * pitch + 1] + nw, 0);
+    }
+    // Moving UP, DOWN, LEFT or RIGHT; the passage bit lives in the cell
+    // itself or in its north/west neighbour.
+    const int step[4] = { -pitch, pitch, -1, 1 };
+    const int owner[4] = { -pitch, 0, -1, 0 };
+    const uint8_t bit[4] = { SOUTH, SOUTH, EAST, EAST };
+    auto exits = [&](int n) {
+        return ((links[n] & EAST) != 0) + ((links[n - 1] & EAST) != 0) + ((links[n] & SOUTH) != 0) +
+               ((links[n - pitch] & SOUTH) != 0);
+    };
+
+    std::vector<int> stack;
+    int first = (1 + rng.below(nh)) * pitch + 1 + rng.below(nw);
+    stack.push_back(first);
+    links[first] |= VISITED;
+    while (!stack.empty()) {
+        int n = stack.back();
+        const uint8_t* order = orders[rng.below(24)];
+        int k = 0;
+        while (k < 4 && (links[n + step[order[k]]] & VISITED)) {
+            k++;
+        }
+        if (k == 4) {
+            stack.pop_back();
+            continue;
+        }
+        int d = order[k];
+        links[n + owner[d]] |= bit[d];
+        links[n + step[d]] |= VISITED;
+        stack.push_back(n + step[d]);
+    }
+
+    unsigned threshold = static_cast<unsigned>(braid * 65536.0f);
+    for (int y = 1; y <= nh; y++) {
+        for (int n = y * pitch + 1; n <= y * pitch + nw; n++) {
+            if (exits(n) != 1 || static_cast<unsigned>(rng.below(65536)) >= threshold) {
+                continue;
+            }
+            int options[4] = { 0, 0, 0, 0 }, count = 0, deadEnds = 0;
+            for (int d = 0; d < 4; d++) {
+                int a = n + step[d];
+                if ((links[a] & BORDER) || (links[n + owner[d]] & bit[d])) {
+                    continue;
+                }
+                // Dead-end neighbours go to the front.
+                if (exits(a) == 1) {
+                    options[count++] = options[deadEnds];
+                    options[deadEnds++] = d;
+                } else {
+                    options[count++] = d;
+                }
+            }
+            if (count > 0) {
+                int d = options[rng.below(deadEnds > 0 ? deadEnds : count)];
+                links[n + owner[d]] |= bit[d];
+            }
+        }
+    }
+
+    // Even rows hold the nodes and their east passages, odd rows the south ones.
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = &layout.blocked[layout.cell(0, y)];
+        const uint8_t* nodes = &links[static_cast<size_t>(y / 2 + 1) * pitch + 1];
+        if (y == height - 1 && height % 2 == 0) {
+            std::fill(row, row + width, 0);
+            continue;
+        }
+        for (int x = 0; x < width; x++) {
+            uint8_t node = nodes[x / 2];
+            bool open = y % 2 == 0 ? (x % 2 == 0 || (node & EAST)) : (x % 2 == 0 && (node & SOUTH));
+            row[x] = !open;
+        }
+        if (width % 2 == 0) {
+            row[width - 1] = 0;
+        }
+    }
+}
+
+}  // namespace maze_detail
+
+// Fills layout.blocked (keeping its size) with a level of the given style.
+// density runs from 0 (open) to 1 (tight): for rooms it shrinks the rooms
+// left undivided, for caves it raises the starting wall fill, for braided
+// mazes it keeps more dead ends instead of looping them.
+inline void generateMaze(Layout& layout, MazeStyle style, float density, uint64_t seed) {
+    Rng rng(seed);
+    density = density < 0 ? 0 : density > 1 ? 1 : density;
+    layout.blocked.assign(static_cast<size_t>(layout.cells()), 0);
+    if (layout.cells() == 0) {
+        return;
+    }
+    switch (style) {
+        case MAZE_DIVISION:
+            maze_detail::division(layout, 2 + static_cast<int>((1.0f - density) * 16.0f), rng);
+            break;
+        case MAZE_CAVES:
+            maze_detail::caves(layout, 35 + static_cast<int>(density * 20.0f), rng);
+            break;
+        case MAZE_BRAIDED:
+            maze_detail::braided(layout, 1.0f - density, rng);
+            break;
+        default:
+            break;
+    }
+}
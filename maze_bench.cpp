@@ -0,0 +1,80 @@
+#include "board.h"
+#include "maze.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+static uint64_t hashLayout(const Layout& layout) {
+    uint64_t h = 1469598103934665603ull;
+    for (uint8_t b : layout.blocked) h = (h ^ b) * 1099511628211ull;
+    return h;
+}
+
+static void show(MazeStyle style, float density, uint64_t seed, int width, int height) {
+    Layout layout(width, height);
+    generateMaze(layout, style, density, seed);
+    printf("%s, density %.2f, seed %llu:\n", mazeStyleName(style), density, static_cast<unsigned long long>(seed));
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) putchar(layout.blocked[layout.cell(x, y)] ? '#' : '.');
+        putchar('\n');
+    }
+}
+
+// Times generation, then checks the level is connected and that the same
+// seed gives the same level again.
+static bool bench(MazeStyle style, float density, int width, int height) {
+    Layout layout(width, height);
+    uint64_t seed = 12345;
+    auto start = chrono::steady_clock::now();
+    generateMaze(layout, style, density, seed);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    int walls = 0;
+    for (uint8_t b : layout.blocked) walls += b != 0;
+    bool connected = layoutConnected(layout);
+    uint64_t h = hashLayout(layout);
+    Layout again(width, height);
+    generateMaze(again, style, density, seed);
+    bool same = hashLayout(again) == h;
+    bool ok = connected && same;
+    printf("%-12s density %.2f %5dx%-5d %8.2f ms  walls %5.1f%%  %s  %s\n", mazeStyleName(style), density, width, height, ms,
+           100.0 * walls / layout.cells(), connected ? "connected" : "DISCONNECTED", same ? "deterministic" : "NOT DETERMINISTIC");
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        // maze_bench style density seed [width height]: print one level.
+        int style = atoi(argv[1]);
+        if (style < 0 || style >= MAZE_STYLES) {
+            fprintf(stderr, "style is 0 (rooms), 1 (caves) or 2 (braided)\n");
+            return 2;
+        }
+        show(static_cast<MazeStyle>(style), argc > 2 ? atof(argv[2]) : 0.5f, argc > 3 ? strtoull(argv[3], nullptr, 10) : 1,
+             argc > 4 ? atoi(argv[4]) : 40, argc > 5 ? atoi(argv[5]) : 30);
+        return 0;
+    }
+    bool ok = true;
+    for (int style = 0; style < MAZE_STYLES; style++) {
+        for (float density : { 0.2f, 0.8f }) {
+            for (int seed = 1; seed <= 200; seed++) {
+                for (int size : { 1, 2, 3, 7, 40 }) {
+                    Layout layout(size + seed % 5, size);
+                    generateMaze(layout, static_cast<MazeStyle>(style), density, seed);
+                    if (!layoutConnected(layout)) {
+                        printf("%s seed %d %dx%d is not connected\n", mazeStyleName(static_cast<MazeStyle>(style)), seed,
+                               layout.width, layout.height);
+                        ok = false;
+                    }
+                }
+            }
+            ok = bench(static_cast<MazeStyle>(style), density, 40, 30) && ok;
+            ok = bench(static_cast<MazeStyle>(style), density, 512, 512) && ok;
+            ok = bench(static_cast<MazeStyle>(style), density, 2048, 2048) && ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,311 @@
+#pragma once
+
+#include "board.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct MctsConfig {
+    double thinkMs = 50;
+    int threads = 0;            // 0: one per hardware thread
+    int rolloutDepth = 40;
+    int maxNodes = 1 << 16;     // per thread
+    double exploration = 0.7;
+};
+
+struct MctsStats {
+    long long playouts = 0;
+    int nodes = 0;
+    double seconds = 0;
+
+    double playoutsPerSecond() const { return seconds > 0 ? playouts / seconds : 0; }
+};
+
+// Root-parallel, open-loop Monte Carlo tree search. Each thread grows its own
+// tree from the same root and replays moves on a scratch copy of the game with
+// a fresh food seed every playout, so the tree averages over where future food
+// (and bonus food) may spawn. Trees are keyed only by moves; root visit counts
+// are summed across threads to pick the move. Node pools and scratch games are
+// kept between searches, so a playout never allocates. The helper threads
+// are started once and sleep between searches; think() wakes them, searches
+// on the calling thread too, and waits for them at the deadline.
+class MctsPlayer {
+public:
+    explicit MctsPlayer(const MctsConfig& config = MctsConfig()) : config_(config) {
+        int n = config_.threads > 0 ? config_.threads : static_cast<int>(std::thread::hardware_concurrency());
+        workers_.resize(n > 0 ? n : 1);
+        for (size_t i = 0; i < workers_.size(); i++) {
+            workers_[i].nodes.reserve(config_.maxNodes);
+            workers_[i].rng = Rng(0x5EED + i * 7919);
+        }
+        for (size_t i = 1; i < workers_.size(); i++) {
+            helpers_.emplace_back([this, i] { help(i); });
+        }
+    }
+
+    ~MctsPlayer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& t : helpers_) {
+            t.join();
+        }
+    }
+
+    MctsPlayer(const MctsPlayer&) = delete;
+    MctsPlayer& operator=(const MctsPlayer&) = delete;
+
+    const MctsStats& lastStats() const { return stats_; }
+    int threads() const { return static_cast<int>(workers_.size()); }
+
+    Direction think(const Game& root) {
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::microseconds(static_cast<long long>(config_.thinkMs * 1000));
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            root_ = &root;
+            deadline_ = deadline;
+            busy_ = static_cast<int>(helpers_.size());
+            search_++;
+        }
+        wake_.notify_all();
+        search(workers_[0], root, deadline);
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [this] { return busy_ == 0; });
+            root_ = nullptr;
+        }
+
+        long long visits[4] = { 0, 0, 0, 0 };
+        double value[4] = { 0, 0, 0, 0 };
+        stats_ = MctsStats();
+        for (const Worker& w : workers_) {
+            stats_.playouts += w.playouts;
+            stats_.nodes += static_cast<int>(w.nodes.size());
+            for (int a = 0; a < 4; a++) {
+                int c = w.nodes[0].child[a];
+                if (c >= 0) {
+                    visits[a] += w.nodes[c].visits;
+                    value[a] += w.nodes[c].value;
+                }
+            }
+        }
+        stats_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        int best = static_cast<int>(root.direction);
+        for (int a = 0; a < 4; a++) {
+            if (visits[a] > visits[best] ||
+                (visits[a] == visits[best] && visits[a] > 0 && value[a] / visits[a] > value[best] / visits[best])) {
+                best = a;
+            }
+        }
+        return static_cast<Direction>(best);
+    }
+
+private:
+    struct Node {
+        int child[4];
+        int visits;
+        float value;
+    };
+
+    struct Worker {
+        std::vector<Node> nodes;
+        std::vector<int> path;
+        Game scratch;
+        Rng rng;
+        long long playouts = 0;
+    };
+
+    static const Direction kMoves[4];
+
+    // Helper thread i: one search per think(), until the destructor.
+    void help(size_t i) {
+        uint64_t seen = 0;
+        for (;;) {
+            const Game* root;
+            std::chrono::steady_clock::time_point deadline;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this, seen] { return stopping_ || search_ != seen; });
+                if (stopping_) {
+                    return;
+                }
+                seen = search_;
+                root = root_;
+                deadline = deadline_;
+            }
+            search(workers_[i], *root, deadline);
+            bool last;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                last = --busy_ == 0;
+            }
+            if (last) {
+                done_.notify_one();
+            }
+        }
+    }
+
+    int newNode(Worker& w) {
+        if (static_cast<int>(w.nodes.size()) >= config_.maxNodes) {
+            return -1;
+        }
+        w.nodes.push_back({ { -1, -1, -1, -1 }, 0, 0.0f });
+        return static_cast<int>(w.nodes.size()) - 1;
+    }
+
+    void search(Worker& w, const Game& root, std::chrono::steady_clock::time_point deadline) {
+        w.nodes.clear();
+        w.playouts = 0;
+        newNode(w);
+        w.path.reserve(256);
+        do {
+            for (int batch = 0; batch < 16; batch++) {
+                playout(w, root);
+            }
+        } while (std::chrono::steady_clock::now() < deadline);
+    }
+
+    void playout(Worker& w, const Game& root) {
+        Game& g = w.scratch;
+        g = root;
+        g.rng = Rng(w.rng.next());
+        w.path.clear();
+        w.path.push_back(0);
+
+        double gained = 0;
+        double discount = 1;
+        int node = 0;
+        while (!g.over) {
+            Node& n = w.nodes[node];
+            int head = g.head();
+            int untried = -1;
+            int legal = 0;
+            bool isLegal[4];
+            for (int a = 0, seen = 0; a < 4; a++) {
+                isLegal[a] = g.isFree(stepCell(*g.layout, head, kMoves[a]));
+                legal += isLegal[a];
+                if (isLegal[a] && n.child[a] < 0 && w.rng.below(++seen) == 0) {
+                    untried = a;
+                }
+            }
+            if (legal == 0) {
+                g.step(g.direction);
+                break;
+            }
+            if (untried >= 0) {
+                int c = newNode(w);
+                advance(g, kMoves[untried], gained, discount);
+                if (c >= 0) {
+                    w.nodes[node].child[untried] = c;
+                    w.path.push_back(c);
+                }
+                break;
+            }
+            double logN = std::log(static_cast<double>(n.visits));
+            int best = -1;
+            double bestScore = -1e30;
+            for (int a = 0; a < 4; a++) {
+                if (!isLegal[a]) {
+                    continue;
+                }
+                const Node& c = w.nodes[n.child[a]];
+                double score = c.value / c.visits + config_.exploration * std::sqrt(logN / c.visits);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = a;
+                }
+            }
+            advance(g, kMoves[best], gained, discount);
+            node = n.child[best];
+            w.path.push_back(node);
+        }
+
+        for (int d = 0; d < config_.rolloutDepth && !g.over; d++) {
+            advance(g, rolloutMove(g, w.rng), gained, discount);
+        }
+
+        float reward = static_cast<float>(evaluate(g, gained));
+        for (int idx : w.path) {
+            w.nodes[idx].visits++;
+            w.nodes[idx].value += reward;
+        }
+        w.playouts++;
+    }
+
+    // Score is discounted by how many moves it took, so the search prefers
+    // eating now over eating at the end of the rollout.
+    static void advance(Game& g, Direction d, double& gained, double& discount) {
+        int before = g.score;
+        g.step(d);
+        gained += (g.score - before) * discount;
+        discount *= 0.97;
+    }
+
+    // Survival dominates, then discounted score, then how close the head
+    // ended up to the current food.
+    static double evaluate(const Game& g, double gained) {
+        if (g.over && !g.won) {
+            return 0.1 * gained / (gained + 1.0);
+        }
+        double closeness = 0;
+        if (g.food >= 0) {
+            const Layout& l = *g.layout;
+            int dist = pathDistance(l, g.food, g.head());
+            closeness = std::max(0.0, 1.0 - static_cast<double>(dist) / (l.width + l.height));
+        }
+        return 0.5 + 0.3 * gained / (gained + 1.0) + 0.2 * closeness;
+    }
+
+    // Random safe move, leaning towards the food three times out of four.
+    static Direction rolloutMove(const Game& g, Rng& rng) {
+        const Layout& l = *g.layout;
+        int head = g.head();
+        Direction safe[4];
+        int count = 0;
+        for (Direction d : kMoves) {
+            if (g.isFree(stepCell(l, head, d))) {
+                safe[count++] = d;
+            }
+        }
+        if (count == 0) {
+            return g.direction;
+        }
+        if (g.food >= 0 && rng.below(4) != 0) {
+            int dist = pathDistance(l, head, g.food);
+            for (int i = 0; i < count; i++) {
+                if (pathDistance(l, stepCell(l, head, safe[i]), g.food) < dist) {
+                    return safe[i];
+                }
+            }
+        }
+        return safe[rng.below(count)];
+    }
+
+    MctsConfig config_;
+    std::vector<Worker> workers_;
+    MctsStats stats_;
+
+    // The search the helpers are on, under mutex_.
+    std::vector<std::thread> helpers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const Game* root_ = nullptr;
+    std::chrono::steady_clock::time_point deadline_;
+    uint64_t search_ = 0;
+    int busy_ = 0;
+    bool stopping_ = false;
+};
+
+inline const Direction MctsPlayer::kMoves[4] = { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT };
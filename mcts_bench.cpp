@@ -0,0 +1,45 @@
+#include "board.h"
+#include "mcts.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    int games = argc > 1 ? atoi(argv[1]) : 3;
+    MctsConfig config;
+    config.thinkMs = argc > 2 ? atof(argv[2]) : 10;
+    config.threads = argc > 3 ? atoi(argv[3]) : 0;
+    int maxMoves = argc > 4 ? atoi(argv[4]) : 2000;
+
+    MctsPlayer player(config);
+    printf("MCTS: %d thread(s), %.1f ms per move\n", player.threads(), config.thinkMs);
+
+    for (int level = 1; level <= 2; level++) {
+        long long playouts = 0;
+        double seconds = 0;
+        int totalScore = 0;
+        for (int g = 0; g < games; g++) {
+            Layout layout(40, 30);
+            Game game;
+            game.reset(layout, 100 + g);
+            game.placeDefaultSnake();
+            Rng rng(200 + g);
+            scatterObstacles(layout, game, level == 2 ? 10 : 0, rng);
+            game.spawnFood(false);
+
+            while (!game.over && game.moves < maxMoves) {
+                game.step(player.think(game));
+                playouts += player.lastStats().playouts;
+                seconds += player.lastStats().seconds;
+            }
+            totalScore += game.score;
+            printf("level %d game %d: score %4d  length %4d  moves %5d  %s\n",
+                   level, g, game.score, game.length, game.moves, game.over ? "died" : "alive");
+        }
+        printf("level %d: mean score %.1f  %.0f playouts/s (%.0f per thread)\n", level,
+               double(totalScore) / games, playouts / seconds, playouts / seconds / player.threads());
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "board.h"
+#include "obstacles.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+// The blocked grid must hold exactly one CELL_MOVING per obstacle, at its
+// position, after any number of steps.
+static bool consistent(const MovingObstacles& m) {
+    int moving = 0;
+    for (uint8_t b : m.layout->blocked) moving += b == CELL_MOVING;
+    for (int i = 0; i < m.count(); i++) {
+        if (m.layout->blocked[m.cell(i)] != CELL_MOVING) return false;
+    }
+    return moving == m.count();
+}
+
+static void bench(int width, int height, int walls, int count, int ticks) {
+    Layout layout(width, height);
+    Rng rng(3);
+    for (int i = 0; i < walls; i++) layout.blocked[rng.below(layout.cells())] = CELL_WALL;
+    MovingObstacles movers;
+    movers.reset(layout);
+    while (movers.count() < count) {
+        movers.add(rng.below(layout.cells()), static_cast<Direction>(rng.below(4)));
+    }
+
+    long long moved = 0;
+    double worst = 0;
+    auto start = chrono::steady_clock::now();
+    for (int t = 0; t < ticks; t++) {
+        auto t0 = chrono::steady_clock::now();
+        moved += movers.step();
+        worst = max(worst, chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count());
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / ticks;
+    printf("%6d obstacles %5dx%-5d %6d walls  %7.4f ms/tick  worst %7.4f ms  %5.1f%% moved  grid %s\n",
+           count, width, height, walls, ms, worst, 100.0 * moved / (double(count) * ticks),
+           consistent(movers) ? "consistent" : "BROKEN");
+}
+
+int main(int argc, char* argv[]) {
+    int ticks = argc > 1 ? atoi(argv[1]) : 1000;
+    bench(40, 30, 0, 15, ticks);
+    bench(1000, 1000, 10000, 50000, ticks);
+    bench(2000, 2000, 40000, 50000, ticks);
+    bench(400, 300, 0, 50000, ticks);
+    return 0;
+}
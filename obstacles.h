@@ -0,0 +1,83 @@
+#pragma once
+
+#include "board.h"
+
+#include <vector>
+
+// Values of Layout::blocked. Everything nonzero blocks, so code that only
+// asks "is this cell blocked" does not need to know obstacles can move.
+enum : uint8_t { CELL_OPEN = 0, CELL_WALL = 1, CELL_MOVING = 2 };
+
+inline Direction reverseDirection(Direction d) {
+    // UP/DOWN and LEFT/RIGHT differ only in the lowest bit.
+    return static_cast<Direction>(static_cast<int>(d) ^ 1);
+}
+
+// Obstacles that move one cell per step in their direction and turn round
+// when the next cell is off the board or blocked (a wall or another
+// obstacle), so each patrols back and forth along a line. Positions and
+// directions are parallel arrays walked in one pass, in index order: an
+// obstacle may move into a cell another one left earlier in the same pass.
+// The layout's blocked grid is the occupancy grid and is updated two cells
+// per move, never rebuilt.
+struct MovingObstacles {
+    Layout* layout = nullptr;
+    std::vector<int> x;
+    std::vector<int> y;
+    std::vector<Direction> direction;
+
+    void reset(Layout& l) {
+        layout = &l;
+        x.clear();
+        y.clear();
+        direction.clear();
+    }
+
+    int count() const { return static_cast<int>(x.size()); }
+    int cell(int i) const { return layout->cell(x[i], y[i]); }
+
+    bool add(int cellIndex, Direction d) {
+        if (layout->blocked[cellIndex] != CELL_OPEN) {
+            return false;
+        }
+        layout->blocked[cellIndex] = CELL_MOVING;
+        x.push_back(cellIndex % layout->width);
+        y.push_back(cellIndex / layout->width);
+        direction.push_back(d);
+        return true;
+    }
+
+    // enter(i, cell, d) is asked before obstacle i moves into an open cell
+    // and returns false to make it turn round instead (e.g. the snake is
+    // there and could not be pushed). Returns how many obstacles moved.
+    template <typename Enter>
+    int step(Enter enter) {
+        static const int dx[4] = { 0, 0, -1, 1 };
+        static const int dy[4] = { -1, 1, 0, 0 };
+        Layout& l = *layout;
+        uint8_t* blocked = l.blocked.data();
+        int n = count(), moved = 0;
+        for (int i = 0; i < n; i++) {
+            int d = static_cast<int>(direction[i]);
+            int nx = x[i] + dx[d], ny = y[i] + dy[d];
+            int from = y[i] * l.width + x[i];
+            int to = ny * l.width + nx;
+            if (static_cast<unsigned>(nx) >= static_cast<unsigned>(l.width) ||
+                static_cast<unsigned>(ny) >= static_cast<unsigned>(l.height) ||
+                blocked[to] != CELL_OPEN || !enter(i, to, static_cast<Direction>(d))) {
+                direction[i] = reverseDirection(static_cast<Direction>(d));
+                continue;
+            }
+            blocked[from] = CELL_OPEN;
+            blocked[to] = CELL_MOVING;
+            x[i] = nx;
+            y[i] = ny;
+            moved++;
+        }
+        return moved;
+    }
+
+    int step() {
+        return step([](int, int, Direction) { return true; });
+    }
+};
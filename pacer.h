@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Tick interval for a level whose base tick is baseMs: every point scored
+// multiplies it by `ramp`, and it never drops below minMs.
+inline double rampedTickMs(double baseMs, int score, double ramp, double minMs) {
+    return std::max(minMs, baseMs * std::pow(ramp, std::max(0, score)));
+}
+
+// Timing of the recent ticks, in milliseconds. Lateness is how far past its
+// deadline a tick was let go; a tick more than a whole interval late (a
+// hitch: a level loading, the window being dragged) restarts the schedule
+// instead and is only counted.
+struct TickStats {
+    double intervalMs = 0;       // asked for by the last wait()
+    double meanIntervalMs = 0;   // measured, deadline to deadline
+    double meanLateMs = 0;
+    double worstLateMs = 0;
+    int ticks = 0;
+    int hitches = 0;
+};
+
+// Paces a loop to deadlines a fixed interval apart on a high-resolution
+// counter. Sleeping alone is only as good as the scheduler (SDL_Delay can
+// overshoot by a whole timer period), spinning alone burns the core; so it
+// sleeps a millisecond at a time while the deadline is further off than
+// such a sleep has lately been taking, and spins the rest. Deadlines are
+// kept from the schedule, not from when wait() returned, so lateness does
+// not add up over the ticks.
+//
+// Clock supplies uint64_t now(), uint64_t frequency() (counts per second)
+// and sleepMs(uint32_t).
+template <class Clock>
+class TickPacer {
+public:
+    static constexpr int HISTORY = 128;
+
+    explicit TickPacer(Clock clock = Clock()) : clock_(clock) {}
+
+    // The next wait() counts its interval from now.
+    void restart() {
+        next_ = clock_.now();
+        last_ = next_;
+        count_ = 0;
+        hitches_ = 0;
+    }
+
+    void wait(double intervalMs) {
+        const double perMs = clock_.frequency() / 1000.0;
+        uint64_t interval = static_cast<uint64_t>(std::max(0.0, intervalMs) * perMs);
+        intervalMs_ = intervalMs;
+        next_ += interval;
+        uint64_t now = clock_.now();
+        if (now > next_ + interval) {
+            hitches_++;
+            next_ = now;
+            last_ = now;
+            return;
+        }
+        while (now < next_) {
+            if ((next_ - now) / perMs > sleepMean_ + 2 * sleepDeviation_) {
+                clock_.sleepMs(1);
+                uint64_t woke = clock_.now();
+                learnSleep((woke - now) / perMs);
+                now = woke;
+            }
+            else {
+                now = clock_.now();
+            }
+        }
+        late_[count_ % HISTORY] = (now - next_) / perMs;
+        interval_[count_ % HISTORY] = (now - last_) / perMs;
+        count_++;
+        last_ = now;
+    }
+
+    // Records a tick something else paced, such as a vsynced present; its
+    // lateness is how much longer than intervalMs it took.
+    void mark(double intervalMs) {
+        const double perMs = clock_.frequency() / 1000.0;
+        uint64_t now = clock_.now();
+        double took = (now - last_) / perMs;
+        intervalMs_ = intervalMs;
+        last_ = now;
+        next_ = now;
+        if (took > 2 * intervalMs) {
+            hitches_++;
+            return;
+        }
+        late_[count_ % HISTORY] = std::max(0.0, took - intervalMs);
+        interval_[count_ % HISTORY] = took;
+        count_++;
+    }
+
+    TickStats stats() const {
+        TickStats s;
+        s.intervalMs = intervalMs_;
+        s.hitches = hitches_;
+        s.ticks = static_cast<int>(std::min<uint64_t>(count_, HISTORY));
+        for (int i = 0; i < s.ticks; i++) {
+            s.meanLateMs += late_[i];
+            s.worstLateMs = std::max(s.worstLateMs, late_[i]);
+            s.meanIntervalMs += interval_[i];
+        }
+        if (s.ticks > 0) {
+            s.meanLateMs /= s.ticks;
+            s.meanIntervalMs /= s.ticks;
+        }
+        return s;
+    }
+
+private:
+    // Running mean and mean deviation of a 1 ms sleep, weighted to the last
+    // few dozen, so a change in timer resolution is picked up.
+    void learnSleep(double ms) {
+        sleepMean_ += (ms - sleepMean_) / 16;
+        sleepDeviation_ += (std::fabs(ms - sleepMean_) - sleepDeviation_) / 16;
+    }
+
+    Clock clock_;
+    uint64_t next_ = 0;
+    uint64_t last_ = 0;
+    uint64_t count_ = 0;
+    int hitches_ = 0;
+    double intervalMs_ = 0;
+    double sleepMean_ = 2.0;
+    double sleepDeviation_ = 0.5;
+    double late_[HISTORY] = {};
+    double interval_[HISTORY] = {};
+};
+
+// Fixed-timestep accumulator: real time goes in as frames pass, whole ticks
+// come out, so the simulation runs at its own rate whatever the display's;
+// alpha() is how far the next tick has got, for drawing between the last
+// two states. A frame runs at most MAX_TICKS ticks and counts at most
+// MAX_FRAME_MS of time, so a slow frame slows the game down rather than
+// making every following frame slower still.
+class FixedStep {
+public:
+    static constexpr int MAX_TICKS = 16;
+    static constexpr double MAX_FRAME_MS = 250;
+
+    void reset() {
+        accumulatorMs_ = 0;
+        ticks_ = 0;
+    }
+
+    void add(double elapsedMs) {
+        accumulatorMs_ += std::min(std::max(0.0, elapsedMs), MAX_FRAME_MS);
+        ticks_ = 0;
+    }
+
+    // Takes one tick of tickMs if a whole one has built up.
+    bool next(double tickMs) {
+        if (accumulatorMs_ < tickMs) {
+            return false;
+        }
+        if (ticks_ == MAX_TICKS) {
+            accumulatorMs_ = 0;
+            return false;
+        }
+        accumulatorMs_ -= tickMs;
+        ticks_++;
+        return true;
+    }
+
+    // Forgets the ticks still due, for a caller whose ticks take longer than
+    // the time they stand for.
+    void drop() { accumulatorMs_ = 0; }
+
+    double alpha(double tickMs) const { return tickMs > 0 ? std::min(1.0, accumulatorMs_ / tickMs) : 0.0; }
+
+private:
+    double accumulatorMs_ = 0;
+    int ticks_ = 0;
+};
@@ -0,0 +1,158 @@
+#include "board.h"
+#include "pacer.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+// The game hands TickPacer SDL_GetPerformanceCounter and SDL_Delay; the
+// steady clock and sleep_for stand in for them here.
+struct SteadyClock {
+    uint64_t now() const { return chrono::duration_cast<chrono::nanoseconds>(Clock::now().time_since_epoch()).count(); }
+    uint64_t frequency() const { return 1000000000ull; }
+    void sleepMs(uint32_t ms) const { this_thread::sleep_for(chrono::milliseconds(ms)); }
+};
+
+// A tick's update and render, about `ms` of work.
+static void work(double ms) {
+    auto end = Clock::now() + chrono::duration<double, milli>(ms);
+    while (Clock::now() < end) {
+    }
+}
+
+static double cpuMs() {
+    return 1000.0 * clock() / CLOCKS_PER_SEC;
+}
+
+struct Result {
+    double meanLate, worstLate, meanInterval, cpuShare;
+};
+
+// What the game did: the work, then a sleep of the whole interval, so every
+// tick comes late by the work plus the sleep's overshoot (and the lateness
+// adds up; only each tick's own is counted here).
+static Result plainSleep(double intervalMs, int ticks, double workMs) {
+    Result r = { 0, 0, 0, 0 };
+    auto start = Clock::now(), last = start;
+    double cpu = cpuMs();
+    for (int i = 0; i < ticks; i++) {
+        work(workMs);
+        this_thread::sleep_for(chrono::milliseconds(static_cast<int>(intervalMs)));
+        auto now = Clock::now();
+        double late = chrono::duration<double, milli>(now - last).count() - intervalMs;
+        last = now;
+        r.meanLate += late / ticks;
+        r.worstLate = max(r.worstLate, late);
+    }
+    double wall = chrono::duration<double, milli>(Clock::now() - start).count();
+    r.meanInterval = wall / ticks;
+    r.cpuShare = (cpuMs() - cpu) / wall;
+    return r;
+}
+
+static Result paced(double intervalMs, int ticks, double workMs) {
+    TickPacer<SteadyClock> pacer;
+    pacer.restart();
+    auto start = Clock::now();
+    double cpu = cpuMs();
+    for (int i = 0; i < ticks; i++) {
+        work(workMs);
+        pacer.wait(intervalMs);
+    }
+    double wall = chrono::duration<double, milli>(Clock::now() - start).count();
+    TickStats s = pacer.stats();
+    return { s.meanLateMs, s.worstLateMs, s.meanIntervalMs, (cpuMs() - cpu) / wall };
+}
+
+// A snake heading right at one 20 px cell per tick, drawn once per frame
+// for two seconds of frames `frameMs` apart (give or take 0.3 ms): either
+// where the last tick left it, or interpolated alpha() of the way into the
+// next. Smooth motion moves the same distance every frame; the spread of
+// the per-frame steps says how far from that it is.
+static bool fixedStep(double frameMs, double tickMs) {
+    Rng rng(3);
+    FixedStep step;
+    double x = 0, drawn[2] = { 0, 0 }, sum[2] = { 0, 0 }, sumSq[2] = { 0, 0 };
+    int frames = static_cast<int>(2000 / frameMs), ticks = 0;
+    double time = 0;
+    for (int f = 0; f < frames; f++) {
+        double elapsed = frameMs + (rng.below(601) - 300) / 1000.0;
+        time += elapsed;
+        step.add(elapsed);
+        while (step.next(tickMs)) {
+            x += 20;
+            ticks++;
+        }
+        double at[2] = { x, x - 20 + 20 * step.alpha(tickMs) };
+        for (int i = 0; i < 2; i++) {
+            double moved = at[i] - drawn[i];
+            drawn[i] = at[i];
+            sum[i] += moved;
+            sumSq[i] += moved * moved;
+        }
+    }
+    double spread[2];
+    for (int i = 0; i < 2; i++) {
+        double mean = sum[i] / frames;
+        spread[i] = sqrt(max(0.0, sumSq[i] / frames - mean * mean));
+    }
+    bool ok = abs(ticks - static_cast<int>(time / tickMs)) <= 1;
+    printf("%5.1f Hz frames, %5.1f ms ticks: %4d ticks in %.0f ms, per-frame step %5.2f px, spread %5.2f px snapped, %5.2f px interpolated%s\n",
+           1000 / frameMs, tickMs, ticks, time, sum[1] / frames, spread[0], spread[1], ok ? "" : "  FAILED");
+    return ok && spread[1] < spread[0];
+}
+
+int main() {
+    bool ok = true;
+    const double workMs = 0.3;
+    printf("%-9s %-13s %10s %10s %12s %5s\n", "interval", "wait", "mean late", "worst late", "mean tick", "cpu");
+    for (double intervalMs : { 100.0, 16.0, 8.0, 4.0, 2.0 }) {
+        int ticks = static_cast<int>(min(500.0, 1500.0 / intervalMs));
+        Result plain = plainSleep(intervalMs, ticks, workMs);
+        Result hybrid = paced(intervalMs, ticks, workMs);
+        printf("%6.0f ms %-13s %7.3f ms %7.3f ms %9.3f ms %4.0f%%\n", intervalMs, "sleep", plain.meanLate, plain.worstLate,
+               plain.meanInterval, 100 * plain.cpuShare);
+        printf("%6.0f ms %-13s %7.3f ms %7.3f ms %9.3f ms %4.0f%%\n", intervalMs, "sleep + spin", hybrid.meanLate, hybrid.worstLate,
+               hybrid.meanInterval, 100 * hybrid.cpuShare);
+        ok = ok && hybrid.meanLate < 0.5 && fabs(hybrid.meanInterval - intervalMs) < 0.5;
+    }
+
+    // The tick ramp of a 100 ms level: score and the interval it plays at.
+    printf("ramp 100 ms level:");
+    for (int score : { 0, 10, 50, 100, 200, 300, 500 }) {
+        printf("  %d: %.1f ms", score, rampedTickMs(100, score, 0.99, 4));
+    }
+    printf("\n");
+
+    // A hitch longer than an interval restarts the schedule rather than
+    // letting the ticks after it run back to back.
+    TickPacer<SteadyClock> pacer;
+    pacer.restart();
+    pacer.wait(5);
+    work(30);
+    auto before = Clock::now();
+    pacer.wait(5);
+    pacer.wait(5);
+    double after = chrono::duration<double, milli>(Clock::now() - before).count();
+    bool hitch = pacer.stats().hitches == 1 && after > 4.5;
+    printf("check hitch restarts the schedule: %s\n", hitch ? "ok" : "FAILED");
+    ok = ok && hitch;
+    printf("mean lateness under 0.5 ms with sleep + spin: %s\n", ok ? "ok" : "FAILED");
+
+    bool smooth = true;
+    for (double frameMs : { 1000 / 60.0, 1000 / 144.0 }) {
+        for (double tickMs : { 100.0, 37.0, 4.0 }) {
+            smooth = fixedStep(frameMs, tickMs) && smooth;
+        }
+    }
+    printf("check fixed step keeps the tick rate and interpolation smooths motion: %s\n", smooth ? "ok" : "FAILED");
+    ok = ok && smooth;
+    return ok ? 0 : 1;
+}
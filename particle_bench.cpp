@@ -0,0 +1,66 @@
+#include "board.h"
+#include "particles.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+// Same layout as SDL_Vertex.
+struct Point { float x, y; };
+struct Color { uint8_t r, g, b, a; };
+struct Vertex {
+    Point position;
+    Color color;
+    Point texCoord;
+};
+
+// Keeps about `live` particles alive at 60 frames per second with bursts
+// like the game's, and times the update and the batch building per frame.
+static void bench(int live, int frames) {
+    ParticlePool pool(live + live / 4);
+    Rng rng(1);
+    vector<Vertex> vertices(static_cast<size_t>(pool.capacity()) * 4);
+    vector<int> indices;
+    extendQuadIndices(indices, pool.capacity());
+    const float dt = 1.0f / 60;
+    double updateMs = 0, batchMs = 0, worst = 0;
+    long long drawn = 0;
+    for (int f = 0; f < frames; f++) {
+        // Average life is 0.75 s, so this many new particles a frame holds
+        // the population near `live`.
+        int toEmit = static_cast<int>(live * dt / 0.75f);
+        while (toEmit > 0) {
+            float cx = static_cast<float>(rng.below(800)), cy = static_cast<float>(rng.below(600));
+            toEmit -= pool.burst(cx, cy, min(toEmit, 40), 180, 1.0f, 0xFFD040, rng) + 1;
+        }
+        auto t0 = chrono::steady_clock::now();
+        pool.update(dt, 300, 1.5f);
+        auto t1 = chrono::steady_clock::now();
+        pool.buildQuads(vertices.data(), 3);
+        auto t2 = chrono::steady_clock::now();
+        double u = chrono::duration<double, milli>(t1 - t0).count();
+        double b = chrono::duration<double, milli>(t2 - t1).count();
+        if (f >= 60) {
+            updateMs += u;
+            batchMs += b;
+            worst = max(worst, u + b);
+            drawn += pool.count();
+        }
+    }
+    int measured = frames - 60;
+    printf("%7.0f live particles: update %6.3f ms  batch %6.3f ms  worst %6.3f ms per frame  (%.1f ns/particle, 1 draw call)\n",
+           double(drawn) / measured, updateMs / measured, batchMs / measured, worst,
+           (updateMs + batchMs) * 1e6 / drawn);
+}
+
+int main(int argc, char* argv[]) {
+    int frames = argc > 1 ? atoi(argv[1]) : 600;
+    bench(1000, frames);
+    bench(10000, frames);
+    bench(100000, frames);
+    bench(400000, frames);
+    return 0;
+}
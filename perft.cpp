@@ -0,0 +1,396 @@
+#include "board.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Counts every game state reachable in exactly depth moves, like a chess
+// perft. Each move is one of the four directions (reversing into the neck is
+// a move too, it just dies). Food normally respawns from the game's own RNG;
+// with --food every free cell, as normal and as bonus food, is a separate
+// branch instead. Dead games end their branch and are counted as deaths.
+
+struct PerftOptions {
+    int width = 40;
+    int height = 30;
+    int obstacles = 0;
+    uint64_t seed = 1;
+    string prefix;
+    int depth = 6;
+    int threads = 0;
+    bool foodBranch = false;
+    bool divide = false;
+    bool hash = false;
+    int verify = 0;
+};
+
+struct PerftCounts {
+    uint64_t nodes = 0;
+    uint64_t leaves = 0;
+    uint64_t deaths = 0;
+    uint64_t eats = 0;
+    uint64_t wins = 0;
+    uint64_t hash = 0;
+
+    void add(const PerftCounts& o) {
+        nodes += o.nodes;
+        leaves += o.leaves;
+        deaths += o.deaths;
+        eats += o.eats;
+        wins += o.wins;
+        hash += o.hash;
+    }
+};
+
+static uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    return h ^ (h >> 33);
+}
+
+static uint64_t stateHash(const Game& g) {
+    uint64_t h = mix(static_cast<uint64_t>(g.food + 1) * 2 + g.foodBonus) ^ mix(0x5C0 + g.score);
+    for (int i = 0; i < g.length; i++) {
+        h = mix(h + static_cast<uint64_t>(g.segment(i)) + 1);
+    }
+    return h;
+}
+
+// Action codes along a path: 0-3 are moves, 4 + cell * 2 + bonus places food.
+static const int FOOD_ACTION = 4;
+
+static void perft(Game& g, int depth, const PerftOptions& opt, PerftCounts& c);
+
+static void afterMove(Game& g, const Game::Undo& u, int depth, const PerftOptions& opt, PerftCounts& c) {
+    if (g.over) {
+        if (g.won) c.wins++;
+        else c.deaths++;
+        return;
+    }
+    if (u.ate) {
+        c.eats++;
+    }
+    if (opt.foodBranch && u.ate) {
+        bool any = false;
+        for (int cell = 0; cell < g.layout->cells(); cell++) {
+            if (!g.isFree(cell)) {
+                continue;
+            }
+            any = true;
+            for (int bonus = 0; bonus < 2; bonus++) {
+                g.food = cell;
+                g.foodBonus = bonus != 0;
+                perft(g, depth, opt, c);
+            }
+        }
+        if (!any) {
+            c.wins++;
+        }
+        g.food = -1;
+        return;
+    }
+    perft(g, depth, opt, c);
+}
+
+static void perft(Game& g, int depth, const PerftOptions& opt, PerftCounts& c) {
+    c.nodes++;
+    if (depth == 0) {
+        c.leaves++;
+        if (opt.hash) {
+            c.hash += stateHash(g);
+        }
+        return;
+    }
+    for (int d = 0; d < 4; d++) {
+        Game::Undo u;
+        g.makeMove(static_cast<Direction>(d), u, !opt.foodBranch);
+        afterMove(g, u, depth - 1, opt, c);
+        g.unmakeMove(u);
+    }
+}
+
+struct PerftTask {
+    vector<int> path;
+    int depth;
+};
+
+// Expands the tree on the calling thread down to split moves, so the work
+// can be shared out; branches that end before that are counted here.
+static void splitTasks(Game& g, int depth, int split, const PerftOptions& opt, vector<int>& path,
+                       vector<PerftTask>& tasks, PerftCounts& c) {
+    if (split == 0 || depth == 0) {
+        tasks.push_back({ path, depth });
+        return;
+    }
+    c.nodes++;
+    for (int d = 0; d < 4; d++) {
+        Game::Undo u;
+        g.makeMove(static_cast<Direction>(d), u, !opt.foodBranch);
+        path.push_back(d);
+        if (g.over) {
+            if (g.won) c.wins++;
+            else c.deaths++;
+        } else {
+            if (u.ate) c.eats++;
+            if (opt.foodBranch && u.ate) {
+                for (int cell = 0; cell < g.layout->cells(); cell++) {
+                    if (!g.isFree(cell)) {
+                        continue;
+                    }
+                    for (int bonus = 0; bonus < 2; bonus++) {
+                        g.food = cell;
+                        g.foodBonus = bonus != 0;
+                        path.push_back(FOOD_ACTION + cell * 2 + bonus);
+                        splitTasks(g, depth - 1, split - 1, opt, path, tasks, c);
+                        path.pop_back();
+                    }
+                }
+                g.food = -1;
+            } else {
+                splitTasks(g, depth - 1, split - 1, opt, path, tasks, c);
+            }
+        }
+        path.pop_back();
+        g.unmakeMove(u);
+    }
+}
+
+static void replay(Game& g, const vector<int>& path, bool foodBranch) {
+    for (int a : path) {
+        if (a < FOOD_ACTION) {
+            Game::Undo u;
+            g.makeMove(static_cast<Direction>(a), u, !foodBranch);
+        } else {
+            g.food = (a - FOOD_ACTION) / 2;
+            g.foodBonus = (a - FOOD_ACTION) % 2 != 0;
+        }
+    }
+}
+
+static bool setUp(const PerftOptions& opt, Layout& layout, Game& game) {
+    layout = Layout(opt.width, opt.height);
+    game.reset(layout, opt.seed);
+    game.placeDefaultSnake();
+    Rng rng(opt.seed ^ 0xA5A5A5A5ull);
+    scatterObstacles(layout, game, opt.obstacles, rng);
+    game.spawnFood(false);
+    for (char ch : opt.prefix) {
+        switch (ch) {
+            case 'U': game.step(Direction::UP); break;
+            case 'D': game.step(Direction::DOWN); break;
+            case 'L': game.step(Direction::LEFT); break;
+            case 'R': game.step(Direction::RIGHT); break;
+            default: return false;
+        }
+    }
+    return !game.over;
+}
+
+// Straight transcription of update()/checkCollision() in Task_201.cpp, on
+// cell coordinates, used to check Game::makeMove()/unmakeMove().
+struct ReferenceGame {
+    vector<int> snake;
+    vector<int> obstacles;
+    int food = -1;
+    bool foodBonus = false;
+    int score = 0;
+    bool over = false;
+
+    bool checkCollision(int c) const {
+        for (int s : snake) {
+            if (s == c) return true;
+        }
+        return false;
+    }
+
+    // Returns true if the snake ate; the caller copies the new food over.
+    bool update(const Layout& l, Direction d) {
+        int x = snake.front() % l.width, y = snake.front() / l.width;
+        switch (d) {
+            case Direction::UP: y--; break;
+            case Direction::DOWN: y++; break;
+            case Direction::LEFT: x--; break;
+            case Direction::RIGHT: x++; break;
+        }
+        if (x < 0 || x >= l.width || y < 0 || y >= l.height || checkCollision(l.cell(x, y))) {
+            over = true;
+            return false;
+        }
+        int head = l.cell(x, y);
+        snake.insert(snake.begin(), head);
+        bool ate = head == food;
+        if (ate) {
+            score += foodBonus ? 5 : 1;
+        } else {
+            snake.pop_back();
+        }
+        for (int o : obstacles) {
+            if (o == head) {
+                over = true;
+            }
+        }
+        return ate;
+    }
+};
+
+static bool sameState(const Game& g, const ReferenceGame& r) {
+    if (g.over != r.over || g.score != r.score || (!g.over && g.length != static_cast<int>(r.snake.size()))) {
+        return false;
+    }
+    if (g.over) {
+        return true;
+    }
+    for (int i = 0; i < g.length; i++) {
+        if (g.segment(i) != r.snake[i]) return false;
+    }
+    for (int c = 0; c < g.layout->cells(); c++) {
+        if (g.occupied[c] != r.checkCollision(c)) return false;
+    }
+    return true;
+}
+
+// Random games on both implementations, stepping forward with makeMove and
+// checking that unmakeMove restores the previous state exactly.
+static int verify(const PerftOptions& opt) {
+    int failures = 0;
+    for (int n = 0; n < opt.verify; n++) {
+        PerftOptions o = opt;
+        o.seed = opt.seed + n;
+        o.prefix.clear();
+        Layout layout;
+        Game g;
+        setUp(o, layout, g);
+        ReferenceGame r;
+        for (int i = g.length - 1; i >= 0; i--) r.snake.insert(r.snake.begin(), g.segment(i));
+        for (int c = 0; c < layout.cells(); c++) if (layout.blocked[c]) r.obstacles.push_back(c);
+        r.food = g.food;
+        r.foodBonus = g.foodBonus;
+        Rng moves(o.seed * 77 + 1);
+        while (!g.over) {
+            Direction d = static_cast<Direction>(moves.below(4));
+            Game before = g;
+            Game::Undo u;
+            g.makeMove(d, u);
+            Game undone = g;
+            undone.unmakeMove(u);
+            bool restored = undone.occupied == before.occupied && undone.length == before.length &&
+                            undone.head() == before.head() && undone.food == before.food &&
+                            undone.score == before.score && undone.over == before.over && undone.moves == before.moves;
+            for (int i = 0; restored && i < before.length; i++) {
+                restored = undone.segment(i) == before.segment(i);
+            }
+            r.update(layout, d);
+            r.food = g.food;
+            r.foodBonus = g.foodBonus;
+            if (!restored || !sameState(g, r)) {
+                printf("verify: seed %llu diverged after %d moves (%s)\n", static_cast<unsigned long long>(o.seed),
+                       g.moves, restored ? "rules" : "undo");
+                failures++;
+                break;
+            }
+        }
+    }
+    printf("verify: %d/%d games matched the reference rules and undo\n", opt.verify - failures, opt.verify);
+    return failures;
+}
+
+static bool parseOptions(int argc, char* argv[], PerftOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--food") { opt.foodBranch = true; continue; }
+        if (arg == "--divide") { opt.divide = true; continue; }
+        if (arg == "--hash") { opt.hash = true; continue; }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--depth") opt.depth = atoi(value);
+        else if (arg == "--size") { if (sscanf(value, "%dx%d", &opt.width, &opt.height) != 2) return false; }
+        else if (arg == "--obstacles") opt.obstacles = atoi(value);
+        else if (arg == "--seed") opt.seed = strtoull(value, nullptr, 10);
+        else if (arg == "--prefix") opt.prefix = value;
+        else if (arg == "--threads") opt.threads = atoi(value);
+        else if (arg == "--verify") opt.verify = atoi(value);
+        else return false;
+    }
+    return opt.depth >= 0 && opt.width >= 4 && opt.height >= 2 &&
+           opt.obstacles >= 0 && opt.obstacles < opt.width * opt.height - 3;
+}
+
+int main(int argc, char* argv[]) {
+    PerftOptions opt;
+    if (!parseOptions(argc, argv, opt)) {
+        printf("usage: perft [--depth N] [--size WxH] [--obstacles N] [--seed N] [--prefix UDLR...]\n"
+               "             [--threads N] [--food] [--divide] [--hash] [--verify GAMES]\n");
+        return 1;
+    }
+    if (opt.verify > 0) {
+        return verify(opt) == 0 ? 0 : 1;
+    }
+
+    Layout layout;
+    Game root;
+    if (!setUp(opt, layout, root)) {
+        printf("position is already over after prefix %s\n", opt.prefix.c_str());
+        return 1;
+    }
+    int threads = opt.threads > 0 ? opt.threads : static_cast<int>(thread::hardware_concurrency());
+    if (threads < 1) threads = 1;
+
+    auto start = chrono::steady_clock::now();
+    PerftCounts total;
+    vector<PerftTask> tasks;
+    vector<int> path;
+    Game splitter = root;
+    splitTasks(splitter, opt.depth, opt.depth < 3 ? opt.depth : 3, opt, path, tasks, total);
+
+    vector<PerftCounts> results(tasks.size());
+    atomic<size_t> next(0);
+    auto work = [&] {
+        Game g;
+        for (size_t i = next++; i < tasks.size(); i = next++) {
+            g = root;
+            replay(g, tasks[i].path, opt.foodBranch);
+            perft(g, tasks[i].depth, opt, results[i]);
+        }
+    };
+    vector<thread> pool;
+    for (int t = 1; t < threads; t++) {
+        pool.emplace_back(work);
+    }
+    work();
+    for (auto& th : pool) {
+        th.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    const char* names = "UDLR";
+    PerftCounts perMove[4];
+    for (size_t i = 0; i < tasks.size(); i++) {
+        total.add(results[i]);
+        if (!tasks[i].path.empty()) {
+            perMove[tasks[i].path[0]].add(results[i]);
+        }
+    }
+    if (opt.divide) {
+        for (int d = 0; d < 4; d++) {
+            printf("%c: %llu\n", names[d], static_cast<unsigned long long>(perMove[d].leaves));
+        }
+    }
+    printf("depth %d%s: leaves %llu  deaths %llu  eats %llu  wins %llu  nodes %llu",
+           opt.depth, opt.foodBranch ? " (food branching)" : "",
+           static_cast<unsigned long long>(total.leaves), static_cast<unsigned long long>(total.deaths),
+           static_cast<unsigned long long>(total.eats), static_cast<unsigned long long>(total.wins),
+           static_cast<unsigned long long>(total.nodes));
+    if (opt.hash) {
+        printf("  hash %016llx", static_cast<unsigned long long>(total.hash));
+    }
+    printf("\n%d thread(s), %zu tasks, %.3f s, %.0f nodes/s\n", threads, tasks.size(), seconds, total.nodes / seconds);
+    return 0;
+}
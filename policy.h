@@ -0,0 +1,516 @@
+#pragma once
+
+#include "board.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define POLICY_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+// Observation planes, each width x height floats, in this order.
+enum PolicyPlane { PLANE_BODY, PLANE_HEAD, PLANE_FOOD, PLANE_OBSTACLE, PLANE_COUNT };
+
+enum PolicyLayerType { LAYER_CONV3X3 = 0, LAYER_MAXPOOL2 = 1, LAYER_DENSE = 2 };
+
+// Weight file, all little-endian:
+//   "SNKP", u32 version (1), u32 width, u32 height, u32 planes, u32 layers
+//   per layer: u32 type, u32 outputs, u32 relu, then for
+//     conv3x3: float weights[outputs][inputs][3][3], float bias[outputs]
+//     dense:   float weights[inputs][outputs],       float bias[outputs]
+//     maxpool2: nothing (outputs is ignored)
+// Conv layers pad by one cell; maxpool2 halves width and height (rounding
+// down). The first dense layer flattens channel-major. The last layer must
+// have 4 outputs, one logit per Direction in enum order.
+
+// Limits a weight file is checked against before anything is allocated:
+// board side, and floats in any one layer's input or output per board.
+const int POLICY_MAX_SIDE = 4096;
+const uint64_t POLICY_MAX_ACTIVATIONS = 1u << 24;
+struct PolicyLayer {
+    int type = LAYER_DENSE;
+    bool relu = false;
+    int inChannels = 0, outChannels = 0;
+    int width = 0, height = 0;          // input spatial size (1x1 for dense)
+    std::vector<float> weights;
+    std::vector<float> bias;
+
+    int inputSize() const { return inChannels * width * height; }
+    int outputSize() const {
+        if (type == LAYER_CONV3X3) return outChannels * width * height;
+        if (type == LAYER_MAXPOOL2) return inChannels * (width / 2) * (height / 2);
+        return outChannels;
+    }
+};
+
+namespace policy_kernels {
+
+// y[b][o] = bias[o] + sum_i x[b][i] * w[i][o], accumulated one weight row
+// per non-zero input; board planes are almost all zeros.
+inline void denseScalar(const float* x, int batch, int in, int out, const float* w, const float* bias, float* y) {
+    for (int b = 0; b < batch; b++) {
+        const float* xb = x + static_cast<size_t>(b) * in;
+        float* yb = y + static_cast<size_t>(b) * out;
+        memcpy(yb, bias, out * sizeof(float));
+        for (int i = 0; i < in; i++) {
+            float v = xb[i];
+            if (v == 0.0f) {
+                continue;
+            }
+            const float* row = w + static_cast<size_t>(i) * out;
+            for (int o = 0; o < out; o++) {
+                yb[o] += v * row[o];
+            }
+        }
+    }
+}
+
+// Input is zero-padded to (h + 2) x (w + 2) per channel.
+inline void conv3x3Scalar(const float* padded, int inC, int outC, int w, int h,
+                          const float* weights, const float* bias, float* out) {
+    int pw = w + 2;
+    for (int oc = 0; oc < outC; oc++) {
+        float* o = out + static_cast<size_t>(oc) * w * h;
+        for (int i = 0; i < w * h; i++) {
+            o[i] = bias[oc];
+        }
+        for (int ic = 0; ic < inC; ic++) {
+            const float* k = weights + (static_cast<size_t>(oc) * inC + ic) * 9;
+            const float* in = padded + static_cast<size_t>(ic) * pw * (h + 2);
+            for (int y = 0; y < h; y++) {
+                for (int t = 0; t < 9; t++) {
+                    const float* src = in + (y + t / 3) * pw + t % 3;
+                    float kv = k[t];
+                    float* dst = o + y * w;
+                    for (int x = 0; x < w; x++) {
+                        dst[x] += kv * src[x];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Scatters each non-zero input cell into the (up to) nine outputs it
+// touches. Used instead of the dense kernels when the input is mostly zeros,
+// which is the case for the observation planes.
+inline void conv3x3Sparse(const float* in, int inC, int outC, int w, int h,
+                          const float* weights, const float* bias, float* out) {
+    int cells = w * h;
+    for (int oc = 0; oc < outC; oc++) {
+        for (int i = 0; i < cells; i++) {
+            out[static_cast<size_t>(oc) * cells + i] = bias[oc];
+        }
+    }
+    for (int ic = 0; ic < inC; ic++) {
+        const float* plane = in + static_cast<size_t>(ic) * cells;
+        for (int i = 0; i < cells; i++) {
+            float v = plane[i];
+            if (v == 0.0f) {
+                continue;
+            }
+            int sx = i % w, sy = i / w;
+            for (int t = 0; t < 9; t++) {
+                int x = sx + 1 - t % 3, y = sy + 1 - t / 3;
+                if (x < 0 || x >= w || y < 0 || y >= h) {
+                    continue;
+                }
+                const float* k = weights + static_cast<size_t>(ic) * 9 + t;
+                float* o = out + y * w + x;
+                for (int oc = 0; oc < outC; oc++) {
+                    o[static_cast<size_t>(oc) * cells] += v * k[static_cast<size_t>(oc) * inC * 9];
+                }
+            }
+        }
+    }
+}
+
+#ifdef POLICY_HAVE_AVX2
+// Finds the non-zero inputs eight at a time with a compare and movemask.
+__attribute__((target("avx2,fma")))
+inline void denseAvx2(const float* x, int batch, int in, int out, const float* w, const float* bias, float* y) {
+    int vecOut = out & ~7;
+    int vecIn = in & ~7;
+    __m256 zero = _mm256_setzero_ps();
+    for (int b = 0; b < batch; b++) {
+        const float* xb = x + static_cast<size_t>(b) * in;
+        float* yb = y + static_cast<size_t>(b) * out;
+        memcpy(yb, bias, out * sizeof(float));
+        for (int i0 = 0; i0 < in; i0 += 8) {
+            unsigned mask;
+            if (i0 < vecIn) {
+                mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(xb + i0), zero, _CMP_NEQ_UQ)));
+            } else {
+                mask = 0;
+                for (int i = i0; i < in; i++) {
+                    mask |= (xb[i] != 0.0f) << (i - i0);
+                }
+            }
+            while (mask) {
+                int i = i0 + __builtin_ctz(mask);
+                mask &= mask - 1;
+                const float* row = w + static_cast<size_t>(i) * out;
+                __m256 vv = _mm256_set1_ps(xb[i]);
+                int o = 0;
+                for (; o < vecOut; o += 8) {
+                    _mm256_storeu_ps(yb + o, _mm256_fmadd_ps(vv, _mm256_loadu_ps(row + o), _mm256_loadu_ps(yb + o)));
+                }
+                for (; o < out; o++) {
+                    yb[o] += xb[i] * row[o];
+                }
+            }
+        }
+    }
+}
+
+// Works on 8 output columns of 4 output channels at a time, so each input
+// vector is loaded once per tap and the four FMA chains run independently.
+// The last, partial column group still loads full vectors (the padded buffer
+// has slack past its end) and stores through a mask; a short last channel
+// group recomputes its final channel and drops the copies.
+__attribute__((target("avx2,fma")))
+inline void conv3x3Avx2(const float* padded, int inC, int outC, int w, int h,
+                        const float* weights, const float* bias, float* out) {
+    int pw = w + 2;
+    int plane = pw * (h + 2);
+    alignas(32) static const int lanes[16] = { -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0 };
+    __m256i tailMask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes + 8 - (w & 7)));
+    int offsets[9] = { 0, 1, 2, pw, pw + 1, pw + 2, 2 * pw, 2 * pw + 1, 2 * pw + 2 };
+    for (int oc = 0; oc < outC; oc += 4) {
+        int ocs[4];
+        for (int j = 0; j < 4; j++) {
+            ocs[j] = oc + j < outC ? oc + j : outC - 1;
+        }
+        const float* k0 = weights + static_cast<size_t>(ocs[0]) * inC * 9;
+        const float* k1 = weights + static_cast<size_t>(ocs[1]) * inC * 9;
+        const float* k2 = weights + static_cast<size_t>(ocs[2]) * inC * 9;
+        const float* k3 = weights + static_cast<size_t>(ocs[3]) * inC * 9;
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x += 8) {
+                __m256 acc0 = _mm256_set1_ps(bias[ocs[0]]);
+                __m256 acc1 = _mm256_set1_ps(bias[ocs[1]]);
+                __m256 acc2 = _mm256_set1_ps(bias[ocs[2]]);
+                __m256 acc3 = _mm256_set1_ps(bias[ocs[3]]);
+                const float* src = padded + y * pw + x;
+                for (int ic = 0; ic < inC; ic++, src += plane) {
+                    int kb = ic * 9;
+                    for (int t = 0; t < 9; t++) {
+                        __m256 v = _mm256_loadu_ps(src + offsets[t]);
+                        acc0 = _mm256_fmadd_ps(_mm256_broadcast_ss(k0 + kb + t), v, acc0);
+                        acc1 = _mm256_fmadd_ps(_mm256_broadcast_ss(k1 + kb + t), v, acc1);
+                        acc2 = _mm256_fmadd_ps(_mm256_broadcast_ss(k2 + kb + t), v, acc2);
+                        acc3 = _mm256_fmadd_ps(_mm256_broadcast_ss(k3 + kb + t), v, acc3);
+                    }
+                }
+                __m256 accs[4] = { acc0, acc1, acc2, acc3 };
+                for (int j = 0; j < 4 && oc + j < outC; j++) {
+                    float* dst = out + static_cast<size_t>(oc + j) * w * h + y * w + x;
+                    if (x + 8 <= w) {
+                        _mm256_storeu_ps(dst, accs[j]);
+                    } else {
+                        _mm256_maskstore_ps(dst, tailMask, accs[j]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+inline bool cpuHasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+#else
+inline bool cpuHasAvx2() { return false; }
+#endif
+
+}
+
+// Small MLP/CNN policy read from a flat weight file. AVX2+FMA kernels are
+// picked at run time when the CPU has them, otherwise the scalar ones.
+// Scratch buffers live in the object, so use one Policy per thread.
+class Policy {
+public:
+    int width = 0;
+    int height = 0;
+    bool useSimd = policy_kernels::cpuHasAvx2();
+
+    bool load(const std::string& path) {
+        FILE* f = fopen(path.c_str(), "rb");
+        if (f == nullptr) {
+            return false;
+        }
+        bool ok = read(f);
+        fclose(f);
+        return ok;
+    }
+
+    bool loaded() const { return !layers_.empty(); }
+    int inputSize() const { return PLANE_COUNT * width * height; }
+    const std::vector<PolicyLayer>& layers() const { return layers_; }
+
+    // Board planes for one game; obs must hold inputSize() floats.
+    void observe(const Game& game, float* obs) const {
+        int cells = width * height;
+        memset(obs, 0, inputSize() * sizeof(float));
+        const Layout& l = *game.layout;
+        for (int c = 0; c < cells && c < l.cells(); c++) {
+            obs[PLANE_OBSTACLE * cells + c] = l.blocked[c] ? 1.0f : 0.0f;
+        }
+        for (int i = 0; i < game.length; i++) {
+            obs[PLANE_BODY * cells + game.segment(i)] = 1.0f;
+        }
+        obs[PLANE_HEAD * cells + game.head()] = 1.0f;
+        if (game.food >= 0) {
+            obs[PLANE_FOOD * cells + game.food] = game.foodBonus ? 2.0f : 1.0f;
+        }
+    }
+
+    // obs holds batch observations back to back; logits gets 4 per game.
+    void evaluate(const float* obs, int batch, float* logits) {
+        int maxSize = inputSize();
+        for (const PolicyLayer& layer : layers_) {
+            if (layer.outputSize() > maxSize) maxSize = layer.outputSize();
+        }
+        bufA_.resize(static_cast<size_t>(maxSize) * batch);
+        bufB_.resize(static_cast<size_t>(maxSize) * batch);
+
+        const float* in = obs;
+        float* out = bufA_.data();
+        for (size_t li = 0; li < layers_.size(); li++) {
+            const PolicyLayer& layer = layers_[li];
+            if (li + 1 == layers_.size()) {
+                out = logits;
+            }
+            run(layer, in, batch, out);
+            in = out;
+            out = (out == bufA_.data()) ? bufB_.data() : bufA_.data();
+        }
+    }
+
+    // Highest-scoring move that does not run straight into a wall, obstacle
+    // or body segment (or the highest-scoring one if every move does).
+    Direction choose(const Game& game, const float* logits) const {
+        int best = -1;
+        for (int a = 0; a < 4; a++) {
+            if (game.isFree(stepCell(*game.layout, game.head(), static_cast<Direction>(a))) &&
+                (best < 0 || logits[a] > logits[best])) {
+                best = a;
+            }
+        }
+        if (best < 0) {
+            best = 0;
+            for (int a = 1; a < 4; a++) {
+                if (logits[a] > logits[best]) best = a;
+            }
+        }
+        return static_cast<Direction>(best);
+    }
+
+    Direction act(const Game& game) {
+        obs_.resize(inputSize());
+        observe(game, obs_.data());
+        float logits[4];
+        evaluate(obs_.data(), 1, logits);
+        return choose(game, logits);
+    }
+
+    void actBatch(const Game* const* games, int count, Direction* moves) {
+        obs_.resize(static_cast<size_t>(inputSize()) * count);
+        logits_.resize(static_cast<size_t>(count) * 4);
+        for (int i = 0; i < count; i++) {
+            observe(*games[i], obs_.data() + static_cast<size_t>(i) * inputSize());
+        }
+        evaluate(obs_.data(), count, logits_.data());
+        for (int i = 0; i < count; i++) {
+            moves[i] = choose(*games[i], logits_.data() + i * 4);
+        }
+    }
+
+    // Builds the layer stack for a weight file; the caller fills weights and
+    // bias (sized here) before save().
+    void shape(int w, int h, const std::vector<PolicyLayer>& spec) {
+        width = w;
+        height = h;
+        layers_.clear();
+        int c = PLANE_COUNT, lw = w, lh = h;
+        for (PolicyLayer layer : spec) {
+            place(layer, c, lw, lh);
+            layers_.push_back(layer);
+        }
+    }
+
+    std::vector<PolicyLayer>& mutableLayers() { return layers_; }
+
+    bool save(const std::string& path) const {
+        FILE* f = fopen(path.c_str(), "wb");
+        if (f == nullptr) {
+            return false;
+        }
+        uint32_t header[5] = { 1, static_cast<uint32_t>(width), static_cast<uint32_t>(height),
+                               PLANE_COUNT, static_cast<uint32_t>(layers_.size()) };
+        bool ok = fwrite("SNKP", 1, 4, f) == 4 && fwrite(header, sizeof(header), 1, f) == 1;
+        for (const PolicyLayer& layer : layers_) {
+            uint32_t desc[3] = { static_cast<uint32_t>(layer.type), static_cast<uint32_t>(layer.outChannels),
+                                 layer.relu ? 1u : 0u };
+            ok = ok && fwrite(desc, sizeof(desc), 1, f) == 1;
+            ok = ok && fwrite(layer.weights.data(), sizeof(float), layer.weights.size(), f) == layer.weights.size();
+            ok = ok && fwrite(layer.bias.data(), sizeof(float), layer.bias.size(), f) == layer.bias.size();
+        }
+        fclose(f);
+        return ok;
+    }
+
+private:
+    // Whether a layer of `type` with `outputs` after (c, lw, lh) keeps its
+    // input and output within POLICY_MAX_ACTIVATIONS and its weights within
+    // the `left` bytes of the file; all in 64 bits, before place() sizes it.
+    static bool fits(int type, uint64_t outputs, int c, int lw, int lh, uint64_t left) {
+        uint64_t cells = static_cast<uint64_t>(lw) * lh;
+        uint64_t in = static_cast<uint64_t>(c) * cells;
+        uint64_t out = type == LAYER_CONV3X3 ? outputs * cells : type == LAYER_MAXPOOL2 ? static_cast<uint64_t>(c) * (lw / 2) * (lh / 2) : outputs;
+        uint64_t floats = type == LAYER_CONV3X3 ? (static_cast<uint64_t>(c) * 9 + 1) * outputs : type == LAYER_DENSE ? (in + 1) * outputs : 0;
+        return in <= POLICY_MAX_ACTIVATIONS && out <= POLICY_MAX_ACTIVATIONS && floats <= left / sizeof(float);
+    }
+
+    // Fills in a layer's input shape from the running (channels, w, h) and
+    // sizes its weights; the first dense layer flattens.
+    static void place(PolicyLayer& layer, int& c, int& lw, int& lh) {
+        if (layer.type == LAYER_DENSE && (lw > 1 || lh > 1)) {
+            c = c * lw * lh;
+            lw = lh = 1;
+        }
+        layer.inChannels = c;
+        layer.width = lw;
+        layer.height = lh;
+        if (layer.type == LAYER_MAXPOOL2) {
+            layer.outChannels = c;
+            lw /= 2;
+            lh /= 2;
+            return;
+        }
+        size_t taps = layer.type == LAYER_CONV3X3 ? 9 : 1;
+        layer.weights.resize(static_cast<size_t>(layer.outChannels) * c * taps);
+        layer.bias.resize(layer.outChannels);
+        c = layer.outChannels;
+    }
+
+    // Sizes come from the file, so every layer is checked against the
+    // limits and against the bytes left before its weights are sized.
+    bool read(FILE* f) {
+        char magic[4];
+        uint32_t header[5];
+        if (fseek(f, 0, SEEK_END) != 0) {
+            return false;
+        }
+        long length = ftell(f);
+        if (length < 0 || fseek(f, 0, SEEK_SET) != 0) {
+            return false;
+        }
+        if (fread(magic, 1, 4, f) != 4 || memcmp(magic, "SNKP", 4) != 0 ||
+            fread(header, sizeof(header), 1, f) != 1 || header[0] != 1 || header[3] != PLANE_COUNT ||
+            header[1] == 0 || header[2] == 0 || header[4] == 0 || header[1] > POLICY_MAX_SIDE || header[2] > POLICY_MAX_SIDE) {
+            return false;
+        }
+        uint64_t left = static_cast<uint64_t>(length) - 4 - sizeof(header);
+        width = static_cast<int>(header[1]);
+        height = static_cast<int>(header[2]);
+        layers_.clear();
+        int c = PLANE_COUNT, lw = width, lh = height;
+        for (uint32_t i = 0; i < header[4]; i++) {
+            uint32_t desc[3];
+            PolicyLayer layer;
+            if (fread(desc, sizeof(desc), 1, f) != 1 || desc[0] > LAYER_DENSE || desc[1] > (1u << 20) ||
+                !fits(static_cast<int>(desc[0]), desc[1], c, lw, lh, left - sizeof(desc))) {
+                layers_.clear();
+                return false;
+            }
+            layer.type = static_cast<int>(desc[0]);
+            layer.outChannels = static_cast<int>(desc[1]);
+            layer.relu = desc[2] != 0;
+            place(layer, c, lw, lh);
+            left -= sizeof(desc) + (layer.weights.size() + layer.bias.size()) * sizeof(float);
+            if (fread(layer.weights.data(), sizeof(float), layer.weights.size(), f) != layer.weights.size() ||
+                fread(layer.bias.data(), sizeof(float), layer.bias.size(), f) != layer.bias.size() ||
+                layer.outputSize() == 0) {
+                layers_.clear();
+                return false;
+            }
+            layers_.push_back(layer);
+        }
+        if (layers_.back().type == LAYER_MAXPOOL2 || layers_.back().outputSize() != 4) {
+            layers_.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void run(const PolicyLayer& layer, const float* in, int batch, float* out) {
+        int inSize = layer.inputSize();
+        int outSize = layer.outputSize();
+        if (layer.type == LAYER_DENSE) {
+#ifdef POLICY_HAVE_AVX2
+            if (useSimd) {
+                policy_kernels::denseAvx2(in, batch, inSize, outSize, layer.weights.data(), layer.bias.data(), out);
+            } else
+#endif
+            policy_kernels::denseScalar(in, batch, inSize, outSize, layer.weights.data(), layer.bias.data(), out);
+        } else if (layer.type == LAYER_CONV3X3) {
+            int w = layer.width, h = layer.height, pw = w + 2, ph = h + 2;
+            padded_.assign(static_cast<size_t>(layer.inChannels) * pw * ph + 16, 0.0f);
+            for (int b = 0; b < batch; b++) {
+                const float* src = in + static_cast<size_t>(b) * inSize;
+                int nonZero = 0;
+                for (int i = 0; i < inSize; i++) {
+                    nonZero += src[i] != 0.0f;
+                }
+                if (nonZero * 8 < inSize) {
+                    policy_kernels::conv3x3Sparse(src, layer.inChannels, layer.outChannels, w, h,
+                                                  layer.weights.data(), layer.bias.data(), out + static_cast<size_t>(b) * outSize);
+                    continue;
+                }
+                for (int c = 0; c < layer.inChannels; c++) {
+                    for (int y = 0; y < h; y++) {
+                        memcpy(&padded_[(static_cast<size_t>(c) * ph + y + 1) * pw + 1], src + (c * h + y) * w, w * sizeof(float));
+                    }
+                }
+                float* dst = out + static_cast<size_t>(b) * outSize;
+#ifdef POLICY_HAVE_AVX2
+                if (useSimd) {
+                    policy_kernels::conv3x3Avx2(padded_.data(), layer.inChannels, layer.outChannels, w, h,
+                                                layer.weights.data(), layer.bias.data(), dst);
+                } else
+#endif
+                policy_kernels::conv3x3Scalar(padded_.data(), layer.inChannels, layer.outChannels, w, h,
+                                              layer.weights.data(), layer.bias.data(), dst);
+            }
+        } else {
+            int w = layer.width, h = layer.height, ow = w / 2, oh = h / 2;
+            for (int b = 0; b < batch * layer.inChannels; b++) {
+                const float* src = in + static_cast<size_t>(b) * w * h;
+                float* dst = out + static_cast<size_t>(b) * ow * oh;
+                for (int y = 0; y < oh; y++) {
+                    for (int x = 0; x < ow; x++) {
+                        const float* p = src + 2 * y * w + 2 * x;
+                        float m = p[0] > p[1] ? p[0] : p[1];
+                        float n = p[w] > p[w + 1] ? p[w] : p[w + 1];
+                        dst[y * ow + x] = m > n ? m : n;
+                    }
+                }
+            }
+        }
+        if (layer.relu) {
+            for (size_t i = 0, n = static_cast<size_t>(outSize) * batch; i < n; i++) {
+                out[i] = out[i] > 0.0f ? out[i] : 0.0f;
+            }
+        }
+    }
+
+    std::vector<PolicyLayer> layers_;
+    std::vector<float> bufA_, bufB_, padded_, obs_, logits_;
+};
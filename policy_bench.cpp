@@ -0,0 +1,153 @@
+#include "board.h"
+#include "policy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+
+using namespace std;
+
+static void randomize(Policy& policy, uint64_t seed) {
+    Rng rng(seed);
+    for (PolicyLayer& layer : policy.mutableLayers()) {
+        float scale = layer.type == LAYER_CONV3X3 ? 1.0f / sqrtf(layer.inChannels * 9.0f) : 1.0f / sqrtf(16.0f);
+        for (float& w : layer.weights) {
+            w = (rng.below(2001) - 1000) / 1000.0f * scale;
+        }
+        for (float& b : layer.bias) {
+            b = (rng.below(201) - 100) / 1000.0f;
+        }
+    }
+}
+
+static PolicyLayer layer(int type, int outputs, bool relu) {
+    PolicyLayer l;
+    l.type = type;
+    l.outChannels = outputs;
+    l.relu = relu;
+    return l;
+}
+
+// Batch-1 latency the game's pilot is meant to stay under.
+static const double TARGET_US = 20;
+
+// Returns the fastest kernel's batch-1 time in us, or -1 on failure.
+static double bench(const char* name, const vector<PolicyLayer>& spec, const char* path) {
+    const int width = 40, height = 30, batch = 256;
+    Policy writer;
+    writer.shape(width, height, spec);
+    randomize(writer, 42);
+    if (!writer.save(path)) {
+        printf("%s: could not write %s\n", name, path);
+        return -1;
+    }
+    Policy policy;
+    if (!policy.load(path)) {
+        printf("%s: could not load %s\n", name, path);
+        return -1;
+    }
+    remove(path);
+
+    Layout layout(width, height);
+    vector<Game> games(batch);
+    vector<const Game*> gamePtrs(batch);
+    for (int i = 0; i < batch; i++) {
+        games[i].reset(layout, i + 1);
+        games[i].placeDefaultSnake();
+        games[i].spawnFood(i % 10 == 0);
+        for (int s = 0; s < 30 && !games[i].over; s++) {
+            games[i].step(static_cast<Direction>(games[i].rng.below(4)));
+        }
+        gamePtrs[i] = &games[i];
+    }
+
+    vector<float> obs(static_cast<size_t>(policy.inputSize()) * batch);
+    for (int i = 0; i < batch; i++) {
+        policy.observe(games[i], obs.data() + static_cast<size_t>(i) * policy.inputSize());
+    }
+    vector<float> simdLogits(batch * 4), scalarLogits(batch * 4);
+    bool simd = policy.useSimd;
+    policy.evaluate(obs.data(), batch, simdLogits.data());
+    policy.useSimd = false;
+    policy.evaluate(obs.data(), batch, scalarLogits.data());
+    policy.useSimd = simd;
+    float maxDiff = 0;
+    for (int i = 0; i < batch * 4; i++) {
+        maxDiff = fmaxf(maxDiff, fabsf(simdLogits[i] - scalarLogits[i]));
+    }
+
+    double best = -1;
+    for (int pass = 0; pass < 2; pass++) {
+        policy.useSimd = pass == 0 ? simd : false;
+        const char* kernel = policy.useSimd ? "avx2" : "scalar";
+
+        int reps = 2000;
+        Direction move = Direction::UP;
+        auto start = chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) {
+            move = policy.act(games[r % batch]);
+        }
+        double single = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / reps;
+        best = best < 0 ? single : min(best, single);
+
+        vector<Direction> moves(batch);
+        int batchReps = 20;
+        start = chrono::steady_clock::now();
+        for (int r = 0; r < batchReps; r++) {
+            policy.actBatch(gamePtrs.data(), batch, moves.data());
+        }
+        double perGame = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / (batchReps * batch);
+
+        printf("%-4s %-6s batch-1 %8.2f us   batch-%d %8.2f us/game (%9.0f games/s)   move %d\n",
+               name, kernel, single, batch, perGame, 1e6 / perGame, static_cast<int>(move));
+        if (!simd) {
+            break;
+        }
+    }
+    printf("%-4s avx2 vs scalar max |diff| %.2e\n", name, maxDiff);
+    return best;
+}
+
+static bool writeFile(const char* path, const vector<uint32_t>& words) {
+    FILE* f = fopen(path, "wb");
+    bool ok = f != nullptr && fwrite("SNKP", 1, 4, f) == 4 && fwrite(words.data(), 4, words.size(), f) == words.size();
+    return f != nullptr && fclose(f) == 0 && ok;
+}
+
+// Files claiming huge boards or layers, or cut short, must be refused
+// before anything is sized from them.
+static bool malformed(const char* path) {
+    const uint32_t planes = PLANE_COUNT;
+    vector<vector<uint32_t>> files = {
+        { 1, 100000, 30, planes, 1, LAYER_DENSE, 4, 0 },
+        { 1, 4096, 4096, planes, 1, LAYER_CONV3X3, 1u << 20, 1 },
+        { 1, 40, 30, planes, 2, LAYER_DENSE, 1u << 20, 1, LAYER_DENSE, 4, 0 },
+        { 1, 40, 30, planes, 1, LAYER_DENSE, 4, 0, 0, 0, 0 },
+    };
+    bool ok = true;
+    for (const auto& words : files) {
+        Policy policy;
+        ok = writeFile(path, words) && !policy.load(path) && !policy.loaded() && ok;
+    }
+    remove(path);
+    printf("check malformed weight files refused: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main() {
+    printf("AVX2+FMA %s\n", policy_kernels::cpuHasAvx2() ? "available" : "not available, scalar only");
+    double mlp = bench("mlp", { layer(LAYER_DENSE, 64, true), layer(LAYER_DENSE, 4, false) }, "policy_bench_mlp.bin");
+    double cnn = bench("cnn", { layer(LAYER_CONV3X3, 8, true), layer(LAYER_MAXPOOL2, 0, false),
+                   layer(LAYER_CONV3X3, 16, true), layer(LAYER_MAXPOOL2, 0, false),
+                   layer(LAYER_DENSE, 64, true), layer(LAYER_DENSE, 4, false) }, "policy_bench_cnn.bin");
+    // The conv stack is bound by FMA throughput over the whole board and
+    // misses the target; the MLP is the model to pilot with.
+    for (auto& r : { make_pair("mlp", mlp), make_pair("cnn", cnn) }) {
+        printf("%-4s batch-1 %.1f us against the %.0f us target: %s\n", r.first, r.second, TARGET_US,
+               r.second < 0 ? "not measured" : r.second <= TARGET_US ? "met" : "MISSED");
+    }
+    return malformed("policy_bench_bad.bin") ? 0 : 1;
+}
@@ -0,0 +1,337 @@
+#include "board.h"
+#include "hamilton.h"
+#include "heuristic.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Plays games [seed, seed + games) headless with one bot. Each worker keeps
+// its own deque of seed ranges: it splits its newest range in half until the
+// range is small, and idle workers steal the oldest (largest) range from a
+// random victim. Results go to one CSV per worker, so nothing is shared on the
+// hot path except the count of games left.
+
+struct SelfPlayOptions {
+    string bot = "heuristic";
+    string weights;
+    int level = 2;
+    int width = 40;
+    int height = 30;
+    uint64_t seed = 1;
+    long long games = 10000;
+    int threads = 0;
+    int grain = 16;
+    string out = "selfplay";
+};
+
+struct SeedRange {
+    uint64_t begin;
+    uint64_t end;
+};
+
+// The lock only guards this worker's own deque; the owner takes it briefly
+// per range and a thief only when it has run dry.
+struct WorkDeque {
+    mutex lock;
+    deque<SeedRange> ranges;
+
+    void push(SeedRange r) {
+        lock_guard<mutex> guard(lock);
+        ranges.push_back(r);
+    }
+
+    bool pop(SeedRange& r) {
+        lock_guard<mutex> guard(lock);
+        if (ranges.empty()) return false;
+        r = ranges.back();
+        ranges.pop_back();
+        return true;
+    }
+
+    bool steal(SeedRange& r) {
+        lock_guard<mutex> guard(lock);
+        if (ranges.empty()) return false;
+        r = ranges.front();
+        ranges.pop_front();
+        return true;
+    }
+};
+
+// Log-spaced latency buckets, 8 per doubling from 1 us; merged at the end so
+// millions of games cost a fixed few kilobytes per worker.
+struct LatencyHistogram {
+    static const int BUCKETS = 8 * 40;
+    vector<uint64_t> counts = vector<uint64_t>(BUCKETS, 0);
+    double maxUs = 0;
+
+    void add(double us) {
+        int b = us <= 1 ? 0 : static_cast<int>(log2(us) * 8);
+        counts[min(b, BUCKETS - 1)]++;
+        maxUs = max(maxUs, us);
+    }
+
+    void merge(const LatencyHistogram& o) {
+        for (int i = 0; i < BUCKETS; i++) counts[i] += o.counts[i];
+        maxUs = max(maxUs, o.maxUs);
+    }
+
+    double percentile(double p) const {
+        uint64_t total = 0;
+        for (uint64_t c : counts) total += c;
+        uint64_t target = static_cast<uint64_t>(ceil(p * total));
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= target && counts[i] > 0) {
+                return min(exp2((i + 1) / 8.0), maxUs);
+            }
+        }
+        return maxUs;
+    }
+};
+
+// Everything a game needs, owned by one worker and reused from game to game:
+// after the first game on a board size nothing is allocated per game.
+struct WorkerArena {
+    Layout layout;
+    Game game;
+    vector<uint8_t> foodMask;
+    HamiltonCycle cycle;
+    HamiltonPilot pilot;
+    HeuristicBot heuristic;
+};
+
+struct Worker {
+    WorkDeque work;
+    WorkerArena arena;
+    LatencyHistogram latency;
+    long long games = 0;
+    long long moves = 0;
+    long long steals = 0;
+    double busySeconds = 0;
+    FILE* out = nullptr;
+};
+
+static Direction greedyMove(const Game& g, Rng& rng) {
+    const Layout& l = *g.layout;
+    Direction best = g.direction;
+    int bestDist = 1 << 30;
+    int ties = 0;
+    for (int d = 0; d < 4; d++) {
+        int n = stepCell(l, g.head(), static_cast<Direction>(d));
+        // makeMove() checks the cell before the tail moves, so the tail
+        // is as deadly as the rest of the body.
+        if (!g.isFree(n)) {
+            continue;
+        }
+        int dist = g.food < 0 ? 0 : cellDistance(l, g.food, n);
+        if (dist < bestDist) {
+            bestDist = dist;
+            best = static_cast<Direction>(d);
+            ties = 1;
+        } else if (dist == bestDist && rng.below(++ties) == 0) {
+            best = static_cast<Direction>(d);
+        }
+    }
+    return best;
+}
+
+static void playGame(const SelfPlayOptions& opt, WorkerArena& a, uint64_t seed) {
+    Layout& layout = a.layout;
+    Game& game = a.game;
+    layout.width = opt.width;
+    layout.height = opt.height;
+    layout.blocked.assign(layout.cells(), 0);
+    game.reset(layout, seed);
+    game.foodMask = nullptr;
+    game.placeDefaultSnake();
+    Rng obstacleRng(seed ^ 0xA5A5A5A5ull);
+    scatterObstacles(layout, game, opt.level == 2 ? 10 : 0, obstacleRng);
+
+    int starveLimit = layout.cells() * 2;
+    if (opt.bot == "hamilton") {
+        if (!a.cycle.build(layout)) {
+            game.over = true;
+            return;
+        }
+        a.foodMask.resize(layout.cells());
+        for (int c = 0; c < layout.cells(); c++) {
+            a.foodMask[c] = a.cycle.contains(c);
+        }
+        game.foodMask = a.foodMask.data();
+        game.spawnFood(false);
+        a.pilot.reset(a.cycle);
+        auto segment = [&](int i) { return game.segment(i); };
+        auto isFree = [&](int c) { return game.isFree(c); };
+        starveLimit = a.cycle.length * 2;
+        int lastEat = 0, lastScore = 0;
+        while (!game.over && game.moves - lastEat < starveLimit) {
+            int next = a.pilot.nextCell(layout, segment, game.length, game.food, isFree);
+            if (next < 0) break;
+            game.step(directionTo(layout, game.head(), next));
+            if (game.score != lastScore) {
+                lastScore = game.score;
+                lastEat = game.moves;
+            }
+        }
+        return;
+    }
+
+    game.spawnFood(false);
+    if (opt.bot == "heuristic") {
+        playHeuristicGame(a.heuristic, game, starveLimit);
+        return;
+    }
+    Rng moveRng(seed * 0x2545F4914F6CDD1Dull + 1);
+    int lastEat = 0, lastScore = 0;
+    while (!game.over && game.moves - lastEat < starveLimit) {
+        Direction d = opt.bot == "greedy" ? greedyMove(game, moveRng) : static_cast<Direction>(moveRng.below(4));
+        game.step(d);
+        if (game.score != lastScore) {
+            lastScore = game.score;
+            lastEat = game.moves;
+        }
+    }
+}
+
+static const char* outcome(const Game& g) {
+    return g.won ? "won" : g.over ? "died" : "starved";
+}
+
+static void runWorker(const SelfPlayOptions& opt, vector<Worker>& workers, int self, atomic<long long>& remaining) {
+    Worker& w = workers[self];
+    Rng victims(opt.seed * 977 + self);
+    auto begin = chrono::steady_clock::now();
+    while (remaining.load(memory_order_relaxed) > 0) {
+        SeedRange r;
+        if (!w.work.pop(r)) {
+            int victim = victims.below(static_cast<int>(workers.size()));
+            if (victim == self || !workers[victim].work.steal(r)) {
+                this_thread::yield();
+                continue;
+            }
+            w.steals++;
+        }
+        // Keep halving, leaving the upper half for the owner or a thief.
+        while (r.end - r.begin > static_cast<uint64_t>(opt.grain)) {
+            uint64_t mid = r.begin + (r.end - r.begin) / 2;
+            w.work.push({ mid, r.end });
+            r.end = mid;
+        }
+        for (uint64_t seed = r.begin; seed < r.end; seed++) {
+            auto start = chrono::steady_clock::now();
+            playGame(opt, w.arena, seed);
+            double us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+            const Game& g = w.arena.game;
+            w.latency.add(us);
+            w.games++;
+            w.moves += g.moves;
+            if (w.out != nullptr) {
+                fprintf(w.out, "%llu,%d,%d,%d,%s,%.1f\n", static_cast<unsigned long long>(seed),
+                        g.score, g.length, g.moves, outcome(g), us);
+            }
+        }
+        remaining.fetch_sub(static_cast<long long>(r.end - r.begin), memory_order_relaxed);
+    }
+    w.busySeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+}
+
+static bool parseOptions(int argc, char* argv[], SelfPlayOptions& opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        const char* value = argv[i + 1];
+        if (arg == "--bot") opt.bot = value;
+        else if (arg == "--weights") opt.weights = value;
+        else if (arg == "--level") opt.level = atoi(value);
+        else if (arg == "--size") { if (sscanf(value, "%dx%d", &opt.width, &opt.height) != 2) return false; }
+        else if (arg == "--seed") opt.seed = strtoull(value, nullptr, 10);
+        else if (arg == "--games") opt.games = atoll(value);
+        else if (arg == "--threads") opt.threads = atoi(value);
+        else if (arg == "--grain") opt.grain = atoi(value);
+        else if (arg == "--out") opt.out = value;
+        else return false;
+    }
+    bool knownBot = opt.bot == "heuristic" || opt.bot == "hamilton" || opt.bot == "greedy" || opt.bot == "random";
+    return argc % 2 == 1 && knownBot && opt.games >= 1 && opt.grain >= 1 && opt.width >= 4 && opt.height >= 2;
+}
+
+int main(int argc, char* argv[]) {
+    SelfPlayOptions opt;
+    if (!parseOptions(argc, argv, opt)) {
+        printf("usage: selfplay [--bot heuristic|hamilton|greedy|random] [--weights FILE] [--level 1|2]\n"
+               "                [--size WxH] [--seed FIRST] [--games N] [--threads N] [--grain N] [--out PREFIX|-]\n");
+        return 1;
+    }
+    int threads = opt.threads > 0 ? opt.threads : static_cast<int>(thread::hardware_concurrency());
+    if (threads < 1) threads = 1;
+
+    vector<Worker> workers(threads);
+    for (int t = 0; t < threads; t++) {
+        Worker& w = workers[t];
+        if (!opt.weights.empty() && !w.arena.heuristic.load(opt.weights)) {
+            printf("could not read weights %s\n", opt.weights.c_str());
+            return 1;
+        }
+        if (opt.out != "-") {
+            string path = opt.out + "." + to_string(t) + ".csv";
+            w.out = fopen(path.c_str(), "w");
+            if (w.out == nullptr) {
+                printf("could not write %s\n", path.c_str());
+                return 1;
+            }
+            setvbuf(w.out, nullptr, _IOFBF, 1 << 16);
+            fprintf(w.out, "seed,score,length,moves,outcome,us\n");
+        }
+        // Each worker starts with an equal contiguous share of the seeds.
+        uint64_t begin = opt.seed + static_cast<uint64_t>(opt.games * t / threads);
+        uint64_t end = opt.seed + static_cast<uint64_t>(opt.games * (t + 1) / threads);
+        if (end > begin) {
+            w.work.push({ begin, end });
+        }
+    }
+
+    atomic<long long> remaining(opt.games);
+    auto start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int t = 1; t < threads; t++) {
+        pool.emplace_back(runWorker, cref(opt), ref(workers), t, ref(remaining));
+    }
+    runWorker(opt, workers, 0, remaining);
+    for (auto& th : pool) {
+        th.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    LatencyHistogram latency;
+    long long games = 0, moves = 0;
+    for (int t = 0; t < threads; t++) {
+        Worker& w = workers[t];
+        if (w.out != nullptr) fclose(w.out);
+        printf("worker %3d  %9lld games  %9.0f games/s  %6lld steals\n", t, w.games,
+               w.busySeconds > 0 ? w.games / w.busySeconds : 0.0, w.steals);
+        latency.merge(w.latency);
+        games += w.games;
+        moves += w.moves;
+    }
+    printf("%s level %d %dx%d: %lld games in %.3f s  %.0f games/s  %.0f games/s/core  %.0f moves/s\n",
+           opt.bot.c_str(), opt.level, opt.width, opt.height, games, seconds,
+           games / seconds, games / seconds / threads, moves / seconds);
+    printf("latency per game: p50 %.0f us  p90 %.0f us  p99 %.0f us  p99.9 %.0f us  max %.0f us\n",
+           latency.percentile(0.5), latency.percentile(0.9), latency.percentile(0.99),
+           latency.percentile(0.999), latency.maxUs);
+    if (opt.out != "-") {
+        printf("results in %s.<worker>.csv\n", opt.out.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "board.h"
+#include "timerwheel.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+static double seconds(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Delays spread over every level of the wheel: mostly short, some long.
+static uint64_t randomDelay(Rng& rng, int maxBits) {
+    int bits = 1 + rng.below(maxBits);
+    return 1 + (rng.next() & ((1ull << bits) - 1));
+}
+
+// Every timer must fire exactly at its tick, cancelled ones never, and
+// timers rescheduled from inside fire() must be honoured too.
+static bool check(int count, int maxBits) {
+    Rng rng(5);
+    TimerWheel wheel;
+    wheel.reset(rng.next() & 0xFFFFF);
+    uint64_t start = wheel.now();
+    vector<uint64_t> due(count);
+    vector<TimerWheel::TimerId> ids(count);
+    vector<uint8_t> cancelled(count, 0), fired(count, 0);
+    uint64_t last = 0;
+    for (int i = 0; i < count; i++) {
+        uint64_t d = randomDelay(rng, maxBits);
+        due[i] = start + d;
+        ids[i] = wheel.schedule(d, 0, i);
+        last = max(last, due[i]);
+    }
+    for (int i = 0; i < count; i += 4) {
+        cancelled[i] = wheel.cancel(ids[i]);
+    }
+    bool ok = true;
+    int chained = 0;
+    wheel.advance(last - start, [&](int kind, int i) {
+        if (kind == 1) {
+            chained++;
+            ok = ok && wheel.now() == static_cast<uint64_t>(i);
+            return;
+        }
+        ok = ok && !cancelled[i] && !fired[i] && wheel.now() == due[i];
+        fired[i] = 1;
+        if (i % 7 == 0) {
+            uint64_t d = randomDelay(rng, maxBits);
+            wheel.schedule(d, 1, static_cast<int>(wheel.now() + d));
+        }
+    });
+    wheel.advance(1ull << maxBits, [&](int kind, int i) {
+        chained++;
+        ok = ok && kind == 1 && wheel.now() == static_cast<uint64_t>(i);
+    });
+    for (int i = 0; i < count; i++) {
+        ok = ok && fired[i] != cancelled[i];
+    }
+    ok = ok && wheel.size() == 0;
+    printf("check %8d timers, delays up to 2^%d: %s (%d chained)\n", count, maxBits, ok ? "ok" : "FAILED", chained);
+    return ok;
+}
+
+// Ids from before a reset stay dead, even once their slots are reused.
+static bool checkReset() {
+    TimerWheel wheel;
+    vector<TimerWheel::TimerId> before, after;
+    for (int i = 0; i < 100; i++) {
+        before.push_back(wheel.schedule(10 + i, 0, i));
+    }
+    wheel.reset();
+    for (int i = 0; i < 100; i++) {
+        after.push_back(wheel.schedule(10 + i, 0, i));
+    }
+    bool ok = wheel.size() == 100;
+    for (int i = 0; i < 100; i++) {
+        ok = ok && before[i] != after[i] && !wheel.pending(before[i]) && !wheel.cancel(before[i]) && wheel.pending(after[i]);
+    }
+    ok = ok && wheel.advance(200, [](int, int) {}) == 100;
+    printf("check ids across reset: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static void bench(int count, int maxBits) {
+    Rng rng(9);
+    TimerWheel wheel;
+    vector<TimerWheel::TimerId> ids(count);
+    vector<uint64_t> delays(count);
+    for (uint64_t& d : delays) d = randomDelay(rng, maxBits);
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        ids[i] = wheel.schedule(delays[i], 0, i);
+    }
+    double insert = seconds(start);
+    start = chrono::steady_clock::now();
+    int cancelled = 0;
+    for (int i = 0; i < count; i += 2) {
+        cancelled += wheel.cancel(ids[i]);
+    }
+    double cancel = seconds(start);
+    start = chrono::steady_clock::now();
+    long long fired = 0;
+    uint64_t ticks = 1ull << maxBits;
+    fired += wheel.advance(ticks + 1, [](int, int) {});
+    double expire = seconds(start);
+    printf("%8d timers up to 2^%-2d ticks: schedule %5.1f ns  cancel %5.1f ns  expire %5.1f ns/timer  (%lld fired over %llu ticks in %.1f ms)\n",
+           count, maxBits, insert * 1e9 / count, cancel * 1e9 / cancelled, expire * 1e9 / fired, fired,
+           static_cast<unsigned long long>(ticks), expire * 1e3);
+}
+
+int main() {
+    bool ok = check(200000, 12) && check(200000, 20) && check(20000, 26) && checkReset();
+    bench(1000000, 10);
+    bench(4000000, 16);
+    bench(4000000, 22);
+    return ok ? 0 : 1;
+}
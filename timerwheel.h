@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timer wheel keyed by game tick: four levels of 256 slots, each
+// level covering 256 times the span of the one below, so delays up to 2^32
+// ticks fit. A timer sits in the level-0 slot of its tick when it is due
+// within 256 ticks, otherwise in a coarser slot, and is moved down a level
+// when the finer wheel wraps round to it (each timer moves at most three
+// times). Slots are intrusive doubly linked lists over a pool, so schedule,
+// cancel and firing are O(1) and nothing is allocated once the pool has grown.
+class TimerWheel {
+public:
+    typedef uint64_t TimerId;  // 0 is never a live timer
+
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 8;
+    static const int SLOTS = 1 << SLOT_BITS;
+
+    TimerWheel() { reset(); }
+
+    // Drops every timer but keeps the pool, each slot on a new generation,
+    // so an id from before the reset never matches a timer scheduled after.
+    void reset(uint64_t now = 0) {
+        now_ = now;
+        count_ = 0;
+        freeList_ = -1;
+        for (int i = static_cast<int>(timers_.size()) - 1; i >= 0; i--) {
+            Timer& t = timers_[i];
+            t.generation++;
+            t.list = -1;
+            t.prev = -1;
+            t.next = freeList_;
+            freeList_ = i;
+        }
+        for (int& h : heads_) {
+            h = -1;
+        }
+    }
+
+    // Last tick advance() processed.
+    uint64_t now() const { return now_; }
+    size_t size() const { return count_; }
+
+    // Fires during the advance() that processes tick now() + delay; a delay
+    // below 1 means the next tick, above 2^32 - 1 is clamped.
+    TimerId schedule(uint64_t delay, int kind, int data = 0) {
+        if (delay < 1) delay = 1;
+        if (delay > 0xFFFFFFFFull) delay = 0xFFFFFFFFull;
+        int i = freeList_;
+        if (i >= 0) {
+            freeList_ = timers_[i].next;
+        } else {
+            i = static_cast<int>(timers_.size());
+            timers_.push_back(Timer());
+        }
+        Timer& t = timers_[i];
+        t.expiry = now_ + delay;
+        t.kind = kind;
+        t.data = data;
+        t.generation++;
+        place(i, now_ + 1);
+        count_++;
+        return (static_cast<uint64_t>(t.generation) << 32) | static_cast<uint32_t>(i + 1);
+    }
+
+    bool pending(TimerId id) const {
+        int i = indexOf(id);
+        return i >= 0 && timers_[i].list >= 0;
+    }
+
+    // Ticks left until the timer fires, 0 if it is not pending.
+    uint64_t remaining(TimerId id) const {
+        return pending(id) ? timers_[indexOf(id)].expiry - now_ : 0;
+    }
+
+    bool cancel(TimerId id) {
+        if (!pending(id)) {
+            return false;
+        }
+        release(indexOf(id));
+        return true;
+    }
+
+    // Processes the next `ticks` ticks, calling fire(kind, data) for every
+    // timer that comes due, in tick order. Timers scheduled from inside fire
+    // count from the tick being processed.
+    template <typename Fire>
+    int advance(uint64_t ticks, Fire fire) {
+        int fired = 0;
+        for (uint64_t n = 0; n < ticks; n++) {
+            uint64_t tick = now_ + 1;
+            int index = static_cast<int>(tick & (SLOTS - 1));
+            for (int level = 1; index == 0 && level < LEVELS; level++) {
+                index = static_cast<int>((tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+                cascade(level, index, tick);
+            }
+            now_ = tick;
+            // Move the due slot to the firing list first, so a timer that
+            // fire() schedules 256 ticks out lands in a fresh list.
+            int& due = heads_[tick & (SLOTS - 1)];
+            int& firing = heads_[LEVELS * SLOTS];
+            firing = due;
+            due = -1;
+            for (int i = firing; i >= 0; i = timers_[i].next) {
+                timers_[i].list = LEVELS * SLOTS;
+            }
+            while (firing >= 0) {
+                int i = firing;
+                int kind = timers_[i].kind, data = timers_[i].data;
+                release(i);
+                fire(kind, data);
+                fired++;
+            }
+        }
+        return fired;
+    }
+
+private:
+    struct Timer {
+        uint64_t expiry = 0;
+        int prev = -1;
+        int next = -1;
+        int list = -1;       // head index this timer is linked into, -1 if free
+        uint32_t generation = 0;
+        int kind = 0;
+        int data = 0;
+    };
+
+    int indexOf(TimerId id) const {
+        int i = static_cast<int>(id & 0xFFFFFFFFu) - 1;
+        if (i < 0 || i >= static_cast<int>(timers_.size()) || timers_[i].generation != static_cast<uint32_t>(id >> 32)) {
+            return -1;
+        }
+        return i;
+    }
+
+    // base is the first tick not processed yet.
+    void place(int i, uint64_t base) {
+        uint64_t expiry = timers_[i].expiry;
+        uint64_t ahead = expiry - base;
+        int level = 0;
+        while (level < LEVELS - 1 && ahead >= (1ull << (SLOT_BITS * (level + 1)))) {
+            level++;
+        }
+        int list = level * SLOTS + static_cast<int>((expiry >> (SLOT_BITS * level)) & (SLOTS - 1));
+        link(i, list);
+    }
+
+    void link(int i, int list) {
+        Timer& t = timers_[i];
+        t.list = list;
+        t.prev = -1;
+        t.next = heads_[list];
+        if (t.next >= 0) {
+            timers_[t.next].prev = i;
+        }
+        heads_[list] = i;
+    }
+
+    void unlink(int i) {
+        Timer& t = timers_[i];
+        if (t.prev >= 0) {
+            timers_[t.prev].next = t.next;
+        } else {
+            heads_[t.list] = t.next;
+        }
+        if (t.next >= 0) {
+            timers_[t.next].prev = t.prev;
+        }
+        t.list = -1;
+    }
+
+    void release(int i) {
+        unlink(i);
+        timers_[i].next = freeList_;
+        freeList_ = i;
+        count_--;
+    }
+
+    void cascade(int level, int index, uint64_t base) {
+        int list = level * SLOTS + index;
+        int i = heads_[list];
+        heads_[list] = -1;
+        while (i >= 0) {
+            int next = timers_[i].next;
+            place(i, base);
+            i = next;
+        }
+    }
+
+    uint64_t now_ = 0;
+    size_t count_ = 0;
+    std::vector<Timer> timers_;
+    int freeList_ = -1;
+    int heads_[LEVELS * SLOTS + 1];
+};
@@ -0,0 +1,567 @@
+#include "board.h"
+#include "bot_plugin.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+using namespace std;
+
+// Round robin between bot plugins. Every bot plays the same boards (one per
+// seed); on each board every pair of bots is a match won by the higher score.
+// A move that goes over the CPU budget, or returns something other than a
+// direction, ends that bot's game and loses its matches on that board.
+// Each game is played in a child process the worker that started it
+// watches, so a move still running at the budget is killed there and then,
+// and a bot that hangs or crashes loses that game and nothing else. The
+// bot's create and destroy are held to the same budget as a move.
+
+struct TournamentOptions {
+    vector<string> plugins;
+    int games = 50;
+    int level = 2;
+    int width = 40;
+    int height = 30;
+    uint64_t seed = 1;
+    int threads = 0;
+    double budgetUs = 1000;
+    // This program and its arguments, to start the children with.
+    string self;
+    vector<string> args;
+    // Set in a child process: the bot and board it plays, and the inherited
+    // mapping (a handle on Windows, a file descriptor elsewhere) it reports
+    // through.
+    int childBot = -1;
+    uint64_t childSeed = 0;
+    uintptr_t childMapping = 0;
+};
+
+struct Plugin {
+    string path;
+    const SnakeBotApi* api = nullptr;
+#ifdef _WIN32
+    HMODULE handle = nullptr;
+#else
+    void* handle = nullptr;
+#endif
+};
+
+static bool loadPlugin(const string& path, Plugin& p) {
+    p.path = path;
+#ifdef _WIN32
+    p.handle = LoadLibraryA(path.c_str());
+    SnakeBotEntry entry = p.handle ? reinterpret_cast<SnakeBotEntry>(GetProcAddress(p.handle, "snake_bot_api")) : nullptr;
+    if (p.handle == nullptr) {
+        printf("%s: could not load (error %lu)\n", path.c_str(), GetLastError());
+        return false;
+    }
+#else
+    p.handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (p.handle == nullptr) {
+        printf("%s: %s\n", path.c_str(), dlerror());
+        return false;
+    }
+    SnakeBotEntry entry = reinterpret_cast<SnakeBotEntry>(dlsym(p.handle, "snake_bot_api"));
+#endif
+    p.api = entry ? entry() : nullptr;
+    if (p.api == nullptr || p.api->version != SNAKE_BOT_API_VERSION || !p.api->create || !p.api->destroy || !p.api->move) {
+        printf("%s: no snake_bot_api() of version %d\n", path.c_str(), SNAKE_BOT_API_VERSION);
+        return false;
+    }
+    return true;
+}
+
+static void unloadPlugin(Plugin& p) {
+#ifdef _WIN32
+    if (p.handle) FreeLibrary(p.handle);
+#else
+    if (p.handle) dlclose(p.handle);
+#endif
+    p.handle = nullptr;
+}
+
+// CPU time used by a process, in microseconds: the child's own, or a child
+// the parent is watching.
+#ifdef _WIN32
+typedef HANDLE CpuClock;
+
+static CpuClock ownCpuClock() {
+    return GetCurrentProcess();
+}
+
+static double cpuMicros(CpuClock clock) {
+    FILETIME created, exited, kernel, user;
+    if (!GetProcessTimes(clock, &created, &exited, &kernel, &user)) {
+        return -1;
+    }
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) / 10.0;
+}
+#else
+typedef clockid_t CpuClock;
+
+static CpuClock ownCpuClock() {
+    return CLOCK_PROCESS_CPUTIME_ID;
+}
+
+static double cpuMicros(CpuClock clock) {
+    timespec ts;
+    if (clock_gettime(clock, &ts) != 0) {
+        return -1;
+    }
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+#endif
+
+struct GameResult {
+    int score = 0;
+    int moves = 0;
+    bool forfeit = false;
+    bool timedOut = false;
+    double cpuUs = 0;
+};
+
+// Steady clock in microseconds; the same clock in every process.
+static double wallMicros() {
+    return chrono::duration<double, micro>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Shared between a game's child process and the worker watching it: the
+// child's CPU and wall clocks when its current call into the bot began (-1
+// between calls), and the result so far, kept up to date after every move
+// so a killed game still has its score.
+struct SharedGame {
+    atomic<double> callStart{ -1 };
+    atomic<double> callWallStart{ -1 };
+    GameResult result;
+};
+static_assert(atomic<double>::is_always_lock_free, "SharedGame lives in memory shared between processes");
+
+struct TournamentWorker {
+    SharedGame* shared = nullptr;
+#ifdef _WIN32
+    HANDLE mapping = nullptr;   // inherited by the children
+#else
+    int mapping = -1;
+#endif
+    long long games = 0;
+    long long moves = 0;
+};
+
+static bool mapShared(TournamentWorker& w) {
+#ifdef _WIN32
+    SECURITY_ATTRIBUTES inherit = { sizeof(inherit), nullptr, TRUE };
+    w.mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, &inherit, PAGE_READWRITE, 0, sizeof(SharedGame), nullptr);
+    void* p = w.mapping ? MapViewOfFile(w.mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedGame)) : nullptr;
+#else
+    // An unlinked temporary file, so the children can map it by descriptor.
+    char path[] = "/tmp/tournament-XXXXXX";
+    w.mapping = mkstemp(path);
+    if (w.mapping >= 0) {
+        unlink(path);
+    }
+    void* p = w.mapping >= 0 && ftruncate(w.mapping, sizeof(SharedGame)) == 0
+                  ? mmap(nullptr, sizeof(SharedGame), PROT_READ | PROT_WRITE, MAP_SHARED, w.mapping, 0)
+                  : MAP_FAILED;
+    if (p == MAP_FAILED) p = nullptr;
+#endif
+    w.shared = p ? new (p) SharedGame() : nullptr;
+    return w.shared != nullptr;
+}
+
+// The child's side of mapShared().
+static SharedGame* openShared(uintptr_t mapping) {
+#ifdef _WIN32
+    void* p = MapViewOfFile(reinterpret_cast<HANDLE>(mapping), FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedGame));
+#else
+    void* p = mmap(nullptr, sizeof(SharedGame), PROT_READ | PROT_WRITE, MAP_SHARED, static_cast<int>(mapping), 0);
+    if (p == MAP_FAILED) p = nullptr;
+#endif
+    return static_cast<SharedGame*>(p);
+}
+
+static void unmapShared(TournamentWorker& w) {
+    if (w.shared == nullptr) return;
+    w.shared->~SharedGame();
+#ifdef _WIN32
+    UnmapViewOfFile(w.shared);
+    CloseHandle(w.mapping);
+#else
+    munmap(w.shared, sizeof(SharedGame));
+    close(w.mapping);
+#endif
+    w.shared = nullptr;
+}
+
+// Runs in the child process.
+static void playGame(const TournamentOptions& opt, const Plugin& plugin, uint64_t seed, SharedGame& shared) {
+    Layout layout;
+    Game game;
+    vector<int> body;
+    GameResult& r = shared.result;
+    CpuClock clock = ownCpuClock();
+    layout.width = opt.width;
+    layout.height = opt.height;
+    layout.blocked.assign(layout.cells(), 0);
+    game.reset(layout, seed);
+    game.placeDefaultSnake();
+    Rng obstacleRng(seed ^ 0xA5A5A5A5ull);
+    scatterObstacles(layout, game, opt.level == 2 ? 10 : 0, obstacleRng);
+    game.spawnFood(false);
+    body.resize(layout.cells());
+
+    // Every call into the bot is timed through `shared`.
+    auto enter = [&] {
+        shared.callWallStart = wallMicros();
+        double start = cpuMicros(clock);
+        shared.callStart = start;
+        return start;
+    };
+    auto leave = [&](double start) {
+        double used = cpuMicros(clock) - start;
+        shared.callStart = -1;
+        shared.callWallStart = -1;
+        return used;
+    };
+
+    const SnakeBotApi* api = plugin.api;
+    double start = enter();
+    void* bot = api->create(seed);
+    if (leave(start) > opt.budgetUs) {
+        r.timedOut = r.forfeit = true;
+    }
+    SnakeBoardView view = {};
+    view.width = layout.width;
+    view.height = layout.height;
+    view.blocked = layout.blocked.data();
+    view.occupied = game.occupied.data();
+    view.body = body.data();
+    int starveLimit = layout.cells() * 2;
+    int lastEat = 0, lastScore = 0;
+    while (!r.forfeit && !game.over && game.moves - lastEat < starveLimit) {
+        for (int i = 0; i < game.length; i++) {
+            body[i] = game.segment(i);
+        }
+        view.length = game.length;
+        view.food = game.food;
+        view.foodBonus = game.foodBonus;
+        view.score = game.score;
+        view.moves = game.moves;
+        view.direction = static_cast<int>(game.direction);
+
+        start = enter();
+        int d = api->move(bot, &view);
+        double used = leave(start);
+        r.cpuUs += used;
+        // The watcher polls; a move that ends between two looks is caught here.
+        if (used > opt.budgetUs) {
+            r.timedOut = r.forfeit = true;
+            break;
+        }
+        if (d < SNAKE_UP || d > SNAKE_RIGHT) {
+            r.forfeit = true;
+            break;
+        }
+        game.step(static_cast<Direction>(d));
+        if (game.score != lastScore) {
+            lastScore = game.score;
+            lastEat = game.moves;
+        }
+        r.score = game.score;
+        r.moves = game.moves;
+    }
+    start = enter();
+    api->destroy(bot);
+    leave(start);
+}
+
+// How often a worker looks at the move its child is in. Sleeps this short
+// are only as fine as the system timer, about 1 ms on Windows.
+static const chrono::microseconds WATCH_PERIOD(50);
+
+// A call that blocks (sleeps, waits on something) uses no CPU time, so it
+// is also cut off after this much wall-clock time, or ten budgets if more.
+static const double CALL_WALL_US = 1e6;
+
+// Whether the child on `clock` has been in one call for more than the
+// budget. The start is read again after the clock so a call that ended in
+// between is not charged with the time of the next.
+static bool overBudget(const TournamentOptions& opt, SharedGame& shared, CpuClock clock, double& usedUs) {
+    double start = shared.callStart, wallStart = shared.callWallStart;
+    if (start < 0) {
+        return false;
+    }
+    double now = cpuMicros(clock);
+    usedUs = now - start;
+    bool blocked = wallStart >= 0 && wallMicros() - wallStart > max(CALL_WALL_US, 10 * opt.budgetUs);
+    return shared.callStart == start && ((now >= 0 && usedUs > opt.budgetUs) || blocked);
+}
+
+// Plays one game in a child process and waits for it, killing it the
+// moment a call runs over budget; that call's CPU time so far is counted.
+// A child that dies any other way than returning forfeits. The child is
+// this program again, told which game to play and where to report: not a
+// bare fork(), as this process has threads and a copy of it could find a
+// lock (malloc's, stdio's) held by one that did not come along.
+static void superviseGame(const TournamentOptions& opt, const vector<Plugin>& plugins, int bot, uint64_t seed,
+                          TournamentWorker& w, GameResult& r) {
+    SharedGame& shared = *w.shared;
+    shared.callStart = -1;
+    shared.callWallStart = -1;
+    shared.result = GameResult();
+    double usedUs = 0;
+    bool killed = false, finished = false;
+#ifdef _WIN32
+    (void)plugins;
+    char self[MAX_PATH];
+    GetModuleFileNameA(nullptr, self, MAX_PATH);
+    string command = string(GetCommandLineA()) + " --child-game " + to_string(bot) + " " + to_string(seed) + " " +
+                     to_string(reinterpret_cast<uintptr_t>(w.mapping));
+    STARTUPINFOA si = {};
+    si.cb = sizeof(si);
+    PROCESS_INFORMATION pi = {};
+    if (CreateProcessA(self, &command[0], nullptr, nullptr, TRUE, 0, nullptr, nullptr, &si, &pi)) {
+        CloseHandle(pi.hThread);
+        while (WaitForSingleObject(pi.hProcess, 0) == WAIT_TIMEOUT) {
+            if (overBudget(opt, shared, pi.hProcess, usedUs)) {
+                TerminateProcess(pi.hProcess, 3);
+                WaitForSingleObject(pi.hProcess, INFINITE);
+                killed = true;
+                break;
+            }
+            this_thread::sleep_for(WATCH_PERIOD);
+        }
+        DWORD code = 1;
+        finished = !killed && GetExitCodeProcess(pi.hProcess, &code) && code == 0;
+        CloseHandle(pi.hProcess);
+    }
+#else
+    (void)plugins;
+    vector<string> args = opt.args;
+    for (string extra : { string("--child-game"), to_string(bot), to_string(seed), to_string(w.mapping) }) {
+        args.push_back(extra);
+    }
+    vector<char*> argv;
+    for (string& a : args) {
+        argv.push_back(&a[0]);
+    }
+    argv.push_back(nullptr);
+    pid_t pid;
+    if (posix_spawn(&pid, opt.self.c_str(), nullptr, nullptr, argv.data(), environ) == 0) {
+        clockid_t clock;
+        bool clocked = clock_getcpuclockid(pid, &clock) == 0;
+        int status = 0;
+        while (waitpid(pid, &status, WNOHANG) == 0) {
+            if (clocked && overBudget(opt, shared, clock, usedUs)) {
+                kill(pid, SIGKILL);
+                waitpid(pid, &status, 0);
+                killed = true;
+                break;
+            }
+            this_thread::sleep_for(WATCH_PERIOD);
+        }
+        finished = !killed && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+#endif
+    r = shared.result;
+    if (killed) {
+        r.cpuUs += usedUs;
+        r.timedOut = r.forfeit = true;
+    }
+    else if (!finished) {
+        r.forfeit = true;
+    }
+}
+
+// Maximum-likelihood Elo over all match results, anchored at a mean of 1500.
+static vector<double> fitElo(int bots, const vector<vector<double>>& points, const vector<vector<int>>& matches) {
+    vector<double> elo(bots, 1500);
+    for (int iter = 0; iter < 2000; iter++) {
+        vector<double> step(bots, 0);
+        for (int a = 0; a < bots; a++) {
+            int played = 0;
+            for (int b = 0; b < bots; b++) {
+                if (matches[a][b] == 0) continue;
+                double expected = 1.0 / (1.0 + pow(10.0, (elo[b] - elo[a]) / 400.0));
+                step[a] += points[a][b] - matches[a][b] * expected;
+                played += matches[a][b];
+            }
+            if (played > 0) step[a] = step[a] / played * 100;
+        }
+        double mean = 0;
+        for (int a = 0; a < bots; a++) {
+            // Bots that won or lost everything drift without bound; cap them.
+            elo[a] = fmin(fmax(elo[a] + step[a], -2000.0), 5000.0);
+            mean += elo[a];
+        }
+        mean /= bots;
+        for (double& e : elo) e += 1500 - mean;
+    }
+    return elo;
+}
+
+static bool parseOptions(int argc, char* argv[], TournamentOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            opt.plugins.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--games") opt.games = atoi(value);
+        else if (arg == "--level") opt.level = atoi(value);
+        else if (arg == "--size") { if (sscanf(value, "%dx%d", &opt.width, &opt.height) != 2) return false; }
+        else if (arg == "--seed") opt.seed = strtoull(value, nullptr, 10);
+        else if (arg == "--threads") opt.threads = atoi(value);
+        else if (arg == "--budget-us") opt.budgetUs = atof(value);
+        else if (arg == "--child-game") {
+            if (i + 2 >= argc) return false;
+            opt.childBot = atoi(value);
+            opt.childSeed = strtoull(argv[++i], nullptr, 10);
+            opt.childMapping = static_cast<uintptr_t>(strtoull(argv[++i], nullptr, 10));
+        }
+        else return false;
+    }
+    return opt.plugins.size() >= 2 && opt.games >= 1 && opt.budgetUs > 0 && opt.width >= 4 && opt.height >= 2;
+}
+
+int main(int argc, char* argv[]) {
+    TournamentOptions opt;
+    if (!parseOptions(argc, argv, opt)) {
+        printf("usage: tournament BOT.so BOT.so [...] [--games N] [--level 1|2] [--size WxH] [--seed N]\n"
+               "                  [--threads N] [--budget-us US]\n");
+        return 1;
+    }
+    int bots = static_cast<int>(opt.plugins.size());
+    vector<Plugin> plugins(bots);
+    if (opt.childBot >= 0) {
+        SharedGame* shared = openShared(opt.childMapping);
+        if (shared == nullptr || opt.childBot >= bots || !loadPlugin(opt.plugins[opt.childBot], plugins[opt.childBot])) {
+            return 1;
+        }
+        playGame(opt, plugins[opt.childBot], opt.childSeed, *shared);
+        return 0;
+    }
+#ifndef _WIN32
+    char self[4096];
+    ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    opt.self = length > 0 ? string(self, length) : string(argv[0]);
+    opt.args.assign(argv, argv + argc);
+#endif
+    for (int b = 0; b < bots; b++) {
+        if (!loadPlugin(opt.plugins[b], plugins[b])) {
+            return 1;
+        }
+    }
+    int threads = opt.threads > 0 ? opt.threads : static_cast<int>(thread::hardware_concurrency());
+    if (threads < 1) threads = 1;
+
+    // A bot's game on a board does not depend on its opponent, so each
+    // (bot, board) is played once and the matches are scored afterwards.
+    vector<vector<GameResult>> results(bots, vector<GameResult>(opt.games));
+    vector<TournamentWorker> workers(threads);
+    for (TournamentWorker& w : workers) {
+        if (!mapShared(w)) {
+            printf("cannot map memory to share with the games\n");
+            return 1;
+        }
+    }
+    atomic<int> next(0);
+    auto work = [&](int t) {
+        TournamentWorker& w = workers[t];
+        for (int job = next++; job < bots * opt.games; job = next++) {
+            int b = job % bots, g = job / bots;
+            superviseGame(opt, plugins, b, opt.seed + g, w, results[b][g]);
+            w.games++;
+            w.moves += results[b][g].moves;
+        }
+    };
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int t = 1; t < threads; t++) {
+        pool.emplace_back(work, t);
+    }
+    work(0);
+    for (auto& th : pool) {
+        th.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<vector<double>> points(bots, vector<double>(bots, 0));
+    vector<vector<int>> matches(bots, vector<int>(bots, 0));
+    for (int g = 0; g < opt.games; g++) {
+        for (int a = 0; a < bots; a++) {
+            for (int b = a + 1; b < bots; b++) {
+                const GameResult& ra = results[a][g];
+                const GameResult& rb = results[b][g];
+                double pa = 0.5;
+                if (ra.forfeit != rb.forfeit) pa = ra.forfeit ? 0 : 1;
+                else if (ra.score != rb.score) pa = ra.score > rb.score ? 1 : 0;
+                points[a][b] += pa;
+                points[b][a] += 1 - pa;
+                matches[a][b]++;
+                matches[b][a]++;
+            }
+        }
+    }
+    vector<double> elo = fitElo(bots, points, matches);
+
+    printf("%-16s %7s %8s %10s %9s %9s %12s\n", "bot", "elo", "points", "mean score", "forfeits", "timeouts", "us/move");
+    for (int b = 0; b < bots; b++) {
+        double total = 0, score = 0, cpu = 0;
+        long long moves = 0;
+        int forfeits = 0, timeouts = 0;
+        for (int o = 0; o < bots; o++) total += points[b][o];
+        for (const GameResult& r : results[b]) {
+            score += r.score;
+            cpu += r.cpuUs;
+            moves += r.moves;
+            forfeits += r.forfeit;
+            timeouts += r.timedOut;
+        }
+        printf("%-16s %7.0f %8.1f %10.2f %9d %9d %12.2f\n", plugins[b].api->name, elo[b], total,
+               score / opt.games, forfeits, timeouts, moves > 0 ? cpu / moves : 0.0);
+    }
+    long long games = 0, moves = 0;
+    for (const TournamentWorker& w : workers) {
+        games += w.games;
+        moves += w.moves;
+    }
+    printf("%d bots, %d boards, %d matches on %d thread(s) in %.3f s: %.0f games/s  %.0f moves/s\n",
+           bots, opt.games, bots * (bots - 1) / 2 * opt.games, threads, seconds, games / seconds, moves / seconds);
+
+    for (TournamentWorker& w : workers) {
+        unmapShared(w);
+    }
+    for (Plugin& p : plugins) {
+        unloadPlugin(p);
+    }
+    return 0;
+}
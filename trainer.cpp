@@ -0,0 +1,278 @@
+#include "board.h"
+#include "heuristic.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct TrainerOptions {
+    int population = 32;
+    int generations = 20;
+    int games = 8;
+    int threads = 0;
+    int level = 2;
+    int width = 40;
+    int height = 30;
+    int tournament = 3;
+    double mutation = 0.3;
+    uint64_t seed = 1;
+    string checkpoint = "trainer_checkpoint.txt";
+    string best = "bot_weights.txt";
+    bool resume = false;
+};
+
+struct Individual {
+    vector<double> weights;
+    double fitness = 0;
+};
+
+// Seeds depend only on (run seed, generation, game), so every individual of a
+// generation plays the same boards and a rerun gives the same fitness.
+static uint64_t evaluationSeed(const TrainerOptions& opt, int generation, int game) {
+    Rng rng(opt.seed * 0x9E3779B97F4A7C15ull + static_cast<uint64_t>(generation) * 1000003 + game);
+    return rng.next();
+}
+
+static double evaluate(const TrainerOptions& opt, const vector<double>& weights, int generation, long long& moves) {
+    HeuristicBot bot(weights);
+    Layout layout;
+    Game game;
+    double total = 0;
+    for (int g = 0; g < opt.games; g++) {
+        uint64_t seed = evaluationSeed(opt, generation, g);
+        layout = Layout(opt.width, opt.height);
+        game.reset(layout, seed);
+        game.placeDefaultSnake();
+        Rng obstacleRng(seed ^ 0xA5A5A5A5ull);
+        scatterObstacles(layout, game, opt.level == 2 ? 10 : 0, obstacleRng);
+        game.spawnFood(false);
+        playHeuristicGame(bot, game, layout.cells() * 2);
+        total += game.score;
+        moves += game.moves;
+    }
+    return total / opt.games;
+}
+
+// Written once a generation has been evaluated and bred: the population is
+// the next generation's, unevaluated except for the two kept parents, and
+// the rng is where breeding left it, so a resumed run goes on exactly as an
+// uninterrupted one would.
+static bool saveCheckpoint(const TrainerOptions& opt, int generation, const vector<Individual>& population, const Rng& rng) {
+    string tmp = opt.checkpoint + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (f == nullptr) {
+        return false;
+    }
+    fprintf(f, "snake-ga 2\ngeneration %d\nseed %llu\nrng %llu\nindividuals %zu %d\n", generation,
+            static_cast<unsigned long long>(opt.seed), static_cast<unsigned long long>(rng.state), population.size(),
+            static_cast<int>(FEATURE_COUNT));
+    for (const Individual& ind : population) {
+        fprintf(f, "%.6f", ind.fitness);
+        for (double w : ind.weights) {
+            fprintf(f, " %.9g", w);
+        }
+        fprintf(f, "\n");
+    }
+    bool ok = fclose(f) == 0;
+    remove(opt.checkpoint.c_str());
+    return ok && rename(tmp.c_str(), opt.checkpoint.c_str()) == 0;
+}
+
+// Just the weights, in the form HeuristicBot::load() reads.
+static bool saveWeights(const string& path, const vector<double>& weights) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (f == nullptr) {
+        return false;
+    }
+    for (double w : weights) {
+        fprintf(f, "%.9g\n", w);
+    }
+    return fclose(f) == 0;
+}
+
+// Breeding keeps two parents, so a population needs at least two.
+static bool loadCheckpoint(TrainerOptions& opt, int& generation, vector<Individual>& population, Rng& rng) {
+    FILE* f = fopen(opt.checkpoint.c_str(), "r");
+    if (f == nullptr) {
+        return false;
+    }
+    unsigned long long seed = 0, state = 0;
+    size_t count = 0;
+    int features = 0;
+    bool ok = fscanf(f, "snake-ga 2 generation %d seed %llu rng %llu individuals %zu %d", &generation, &seed, &state, &count,
+                     &features) == 5 &&
+              features == FEATURE_COUNT && count >= 2;
+    if (ok) {
+        population.assign(count, Individual());
+        for (Individual& ind : population) {
+            ind.weights.resize(FEATURE_COUNT);
+            ok = ok && fscanf(f, "%lf", &ind.fitness) == 1;
+            for (double& w : ind.weights) {
+                ok = ok && fscanf(f, "%lf", &w) == 1;
+            }
+        }
+    }
+    fclose(f);
+    if (ok) {
+        opt.seed = seed;
+        rng.state = state;
+    }
+    return ok;
+}
+
+static const Individual& tournamentPick(const vector<Individual>& population, int size, Rng& rng) {
+    const Individual* best = &population[rng.below(static_cast<int>(population.size()))];
+    for (int i = 1; i < size; i++) {
+        const Individual& c = population[rng.below(static_cast<int>(population.size()))];
+        if (c.fitness > best->fitness) {
+            best = &c;
+        }
+    }
+    return *best;
+}
+
+static double gaussian(Rng& rng) {
+    double u = (rng.next() >> 11) * (1.0 / 9007199254740992.0) + 1e-12;
+    double v = (rng.next() >> 11) * (1.0 / 9007199254740992.0);
+    return sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v);
+}
+
+// Blend crossover: each weight is drawn between (and a little beyond) the two
+// parents' values, then perturbed with probability 1/2.
+static vector<double> crossover(const vector<double>& a, const vector<double>& b, double mutation, Rng& rng) {
+    vector<double> child(a.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        double t = (rng.below(1001) / 1000.0) * 1.5 - 0.25;
+        child[i] = a[i] + t * (b[i] - a[i]);
+        if (rng.below(2) == 0) {
+            child[i] += mutation * gaussian(rng);
+        }
+    }
+    return child;
+}
+
+static bool parseOptions(int argc, char* argv[], TrainerOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--resume") { opt.resume = true; continue; }
+        if (value == nullptr) return false;
+        if (arg == "--population") opt.population = atoi(value);
+        else if (arg == "--generations") opt.generations = atoi(value);
+        else if (arg == "--games") opt.games = atoi(value);
+        else if (arg == "--threads") opt.threads = atoi(value);
+        else if (arg == "--level") opt.level = atoi(value);
+        else if (arg == "--size") { if (sscanf(value, "%dx%d", &opt.width, &opt.height) != 2) return false; }
+        else if (arg == "--tournament") opt.tournament = atoi(value);
+        else if (arg == "--mutation") opt.mutation = atof(value);
+        else if (arg == "--seed") opt.seed = strtoull(value, nullptr, 10);
+        else if (arg == "--checkpoint") opt.checkpoint = value;
+        else if (arg == "--best") opt.best = value;
+        else return false;
+        i++;
+    }
+    return opt.population >= 2 && opt.games >= 1 && opt.width >= 4 && opt.height >= 2 && opt.tournament >= 1;
+}
+
+int main(int argc, char* argv[]) {
+    TrainerOptions opt;
+    if (!parseOptions(argc, argv, opt)) {
+        printf("usage: trainer [--population N] [--generations N] [--games N] [--threads N] [--level 1|2]\n"
+               "               [--size WxH] [--tournament K] [--mutation S] [--seed N] [--checkpoint FILE] [--best FILE]\n"
+               "               [--resume]\n");
+        return 1;
+    }
+    int threads = opt.threads > 0 ? opt.threads : static_cast<int>(thread::hardware_concurrency());
+    if (threads < 1) threads = 1;
+
+    vector<Individual> population;
+    int startGeneration = 0;
+    Rng rng(opt.seed);
+    if (opt.resume && loadCheckpoint(opt, startGeneration, population, rng)) {
+        startGeneration++;
+        printf("resumed %s at generation %d\n", opt.checkpoint.c_str(), startGeneration);
+    } else {
+        population.resize(opt.population);
+        population[0].weights = HeuristicBot::defaultWeights();
+        for (size_t i = 1; i < population.size(); i++) {
+            population[i].weights.resize(FEATURE_COUNT);
+            for (double& w : population[i].weights) {
+                w = gaussian(rng) * 2.0;
+            }
+        }
+    }
+
+    for (int gen = startGeneration; gen < startGeneration + opt.generations; gen++) {
+        atomic<int> next(0);
+        vector<long long> moves(threads, 0);
+        vector<long long> games(threads, 0);
+        vector<double> busy(threads, 0);
+        auto start = chrono::steady_clock::now();
+        auto work = [&](int t) {
+            auto begin = chrono::steady_clock::now();
+            for (int i = next++; i < static_cast<int>(population.size()); i = next++) {
+                population[i].fitness = evaluate(opt, population[i].weights, gen, moves[t]);
+                games[t] += opt.games;
+            }
+            busy[t] = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        };
+        vector<thread> pool;
+        for (int t = 1; t < threads; t++) {
+            pool.emplace_back(work, t);
+        }
+        work(0);
+        for (auto& th : pool) {
+            th.join();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        long long totalGames = 0, totalMoves = 0;
+        double busySeconds = 0;
+        for (int t = 0; t < threads; t++) {
+            totalGames += games[t];
+            totalMoves += moves[t];
+            busySeconds += busy[t];
+        }
+        sort(population.begin(), population.end(), [](const Individual& a, const Individual& b) { return a.fitness > b.fitness; });
+        double mean = 0;
+        for (const Individual& ind : population) {
+            mean += ind.fitness;
+        }
+        mean /= population.size();
+        printf("gen %3d  best %7.2f  mean %7.2f  %6.0f games/s  %6.0f games/s/core  %8.0f moves/s  best:",
+               gen, population[0].fitness, mean, totalGames / seconds, totalGames / busySeconds, totalMoves / seconds);
+        for (double w : population[0].weights) {
+            printf(" %.3f", w);
+        }
+        printf("\n");
+        fflush(stdout);
+
+        if (!saveWeights(opt.best, population[0].weights)) {
+            printf("could not write %s\n", opt.best.c_str());
+        }
+
+        // Keep the two best as they are, breed the rest.
+        vector<Individual> children(population.size());
+        children[0] = population[0];
+        children[1] = population[1];
+        for (size_t i = 2; i < children.size(); i++) {
+            const Individual& a = tournamentPick(population, opt.tournament, rng);
+            const Individual& b = tournamentPick(population, opt.tournament, rng);
+            children[i].weights = crossover(a.weights, b.weights, opt.mutation, rng);
+        }
+        population.swap(children);
+        if (!saveCheckpoint(opt, gen, population, rng)) {
+            printf("could not write checkpoint %s\n", opt.checkpoint.c_str());
+        }
+    }
+    return 0;
+}
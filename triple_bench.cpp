@@ -0,0 +1,133 @@
+#include "triplebuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+// About what the game's Frame carries for a 40x30 board: a draw command per
+// snake cell and wall, some text and particle vertices.
+static const size_t FRAME_WORDS = 16384;
+
+struct Snapshot {
+    uint64_t sequence = 0;
+    vector<uint64_t> words;
+};
+
+static void fill(Snapshot& s, uint64_t sequence) {
+    s.sequence = sequence;
+    s.words.assign(FRAME_WORDS, sequence);
+}
+
+// Whole, and not older than the last one seen.
+static bool intact(const Snapshot& s, uint64_t& last) {
+    bool ok = s.sequence >= last && all_of(s.words.begin(), s.words.end(), [&](uint64_t w) { return w == s.sequence; });
+    last = s.sequence;
+    return ok;
+}
+
+struct Result {
+    uint64_t published = 0, fetched = 0;
+    double writerWorstUs = 0, readerWorstUs = 0;
+    bool ok = true;
+};
+
+static double us(Clock::time_point a, Clock::time_point b) {
+    return chrono::duration<double, micro>(b - a).count();
+}
+
+// Writer fills and publishes as fast as it can, reader takes the newest and
+// checks it, both for `seconds`; the worst time either spent in the hand-over
+// itself is what the other side can hold it up by.
+static Result tripleBuffer(double seconds) {
+    TripleBuffer<Snapshot> buffer;
+    atomic<bool> stop(false);
+    Result r;
+    thread reader([&] {
+        uint64_t last = 0;
+        while (!stop.load(memory_order_acquire)) {
+            auto t0 = Clock::now();
+            bool fresh = buffer.fetch();
+            r.readerWorstUs = max(r.readerWorstUs, us(t0, Clock::now()));
+            if (fresh) {
+                r.fetched++;
+                r.ok = intact(buffer.front(), last) && r.ok;
+            }
+            this_thread::yield();
+        }
+    });
+    auto end = Clock::now() + chrono::duration<double>(seconds);
+    while (Clock::now() < end) {
+        fill(buffer.back(), ++r.published);
+        auto t0 = Clock::now();
+        buffer.publish();
+        r.writerWorstUs = max(r.writerWorstUs, us(t0, Clock::now()));
+        this_thread::yield();
+    }
+    stop = true;
+    reader.join();
+    return r;
+}
+
+// The usual alternative: one shared snapshot under a mutex, copied in by the
+// writer and out by the reader, so each waits while the other copies.
+static Result mutexCopy(double seconds) {
+    Snapshot shared, mine, theirs;
+    mutex m;
+    atomic<bool> stop(false);
+    Result r;
+    thread reader([&] {
+        uint64_t last = 0, seen = 0;
+        while (!stop.load(memory_order_acquire)) {
+            auto t0 = Clock::now();
+            {
+                lock_guard<mutex> lock(m);
+                if (shared.sequence != seen) {
+                    theirs = shared;
+                }
+            }
+            r.readerWorstUs = max(r.readerWorstUs, us(t0, Clock::now()));
+            if (theirs.sequence != seen) {
+                seen = theirs.sequence;
+                r.fetched++;
+                r.ok = intact(theirs, last) && r.ok;
+            }
+            this_thread::yield();
+        }
+    });
+    auto end = Clock::now() + chrono::duration<double>(seconds);
+    while (Clock::now() < end) {
+        fill(mine, ++r.published);
+        auto t0 = Clock::now();
+        {
+            lock_guard<mutex> lock(m);
+            shared = mine;
+        }
+        r.writerWorstUs = max(r.writerWorstUs, us(t0, Clock::now()));
+        this_thread::yield();
+    }
+    stop = true;
+    reader.join();
+    return r;
+}
+
+int main() {
+    Result triple = tripleBuffer(1.0);
+    Result locked = mutexCopy(1.0);
+    printf("%-14s %10s %10s %16s %16s\n", "hand-over", "published", "fetched", "writer worst", "reader worst");
+    printf("%-14s %10llu %10llu %13.2f us %13.2f us\n", "triple buffer", static_cast<unsigned long long>(triple.published),
+           static_cast<unsigned long long>(triple.fetched), triple.writerWorstUs, triple.readerWorstUs);
+    printf("%-14s %10llu %10llu %13.2f us %13.2f us\n", "mutex + copy", static_cast<unsigned long long>(locked.published),
+           static_cast<unsigned long long>(locked.fetched), locked.writerWorstUs, locked.readerWorstUs);
+    bool ok = triple.ok && locked.ok && triple.fetched > 0;
+    printf("check snapshots whole and in order: %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
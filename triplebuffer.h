@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+
+// Hands whole values from one writer thread to one reader thread, newest
+// first: three slots, one the writer fills, one the reader holds, and one in
+// between with the latest value published. publish() and fetch() are a
+// single atomic exchange each, so neither side ever waits for the other; a
+// value the reader was too slow for is written over, never queued. Slots are
+// reused, so a T holding vectors stops allocating once they have grown.
+template <class T>
+class TripleBuffer {
+public:
+    // Writer: the slot to fill. It holds whatever was last written to it,
+    // not necessarily the latest value.
+    T& back() { return slots_[back_]; }
+
+    // Writer: makes back() the latest value and takes the old middle slot.
+    void publish() { back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX; }
+
+    // Reader: moves to the latest value if one was published since the last
+    // fetch; front() stays valid and unchanged until the next fetch().
+    bool fetch() {
+        if ((middle_.load(std::memory_order_acquire) & FRESH) == 0) {
+            return false;
+        }
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& front() const { return slots_[front_]; }
+
+private:
+    static constexpr int INDEX = 3;
+    static constexpr int FRESH = 4;
+
+    T slots_[3];
+    int back_ = 0;
+    int front_ = 1;
+    alignas(64) std::atomic<int> middle_{ 2 };
+};
@@ -0,0 +1,158 @@
+#include "filewatch.h"
+#include "levels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static const int SETTLE_MS = 20;
+
+static double ms(Clock::duration d) {
+    return chrono::duration<double, milli>(d).count();
+}
+
+static void writeFile(const string& path, const string& text) {
+    FILE* f = fopen(path.c_str(), "wb");
+    fwrite(text.data(), 1, text.size(), f);
+    fclose(f);
+}
+
+// What the game does with a reload: the watcher thread compiles levels.txt
+// into a catalog and queues it, the main thread swaps it in between frames.
+struct Reloads {
+    mutex m;
+    vector<string> seen;
+    vector<Clock::time_point> at;
+    unique_ptr<LevelCatalog> pending;
+    string dir;
+
+    void load(const string& name) {
+        unique_ptr<LevelCatalog> catalog;
+        if (name == "levels.txt") {
+            string text, error;
+            vector<uint8_t> bytes;
+            catalog.reset(new LevelCatalog());
+            if (!readTextFile((dir + "/" + name).c_str(), text) || !compileLevels(text, bytes, error) || !catalog->adopt(std::move(bytes), error)) {
+                catalog.reset();
+            }
+        }
+        lock_guard<mutex> lock(m);
+        seen.push_back(name);
+        at.push_back(Clock::now());
+        if (catalog) {
+            pending = std::move(catalog);
+        }
+    }
+
+    size_t count() {
+        lock_guard<mutex> lock(m);
+        return seen.size();
+    }
+};
+
+static bool waitFor(Reloads& r, size_t n, int timeoutMs) {
+    Clock::time_point end = Clock::now() + chrono::milliseconds(timeoutMs);
+    while (r.count() < n && Clock::now() < end) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return r.count() >= n;
+}
+
+static string levelText(int side) {
+    string text = "level Big\nsize " + to_string(side) + " " + to_string(side) + "\nmap\n";
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            text += (x % 7 == 3 && y % 5 != 0) ? '#' : '.';
+        }
+        text += '\n';
+    }
+    return text + "end\n";
+}
+
+int main() {
+    char dirTemplate[] = "/tmp/watch_benchXXXXXX";
+    if (mkdtemp(dirTemplate) == nullptr) {
+        printf("cannot make a temporary directory\n");
+        return 1;
+    }
+    string dir = dirTemplate;
+    Reloads reloads;
+    reloads.dir = dir;
+    FileWatcher watcher;
+    if (!watcher.start(dir, { "back.png", "levels.txt" }, [&](const string& name) { reloads.load(name); }, SETTLE_MS)) {
+        printf("cannot watch %s\n", dir.c_str());
+        return 1;
+    }
+    bool ok = true;
+
+    // One write: one reload, SETTLE_MS after the write plus the wake-up delay.
+    double latency = 0;
+    const int writes = 10;
+    for (int i = 0; i < writes; i++) {
+        Clock::time_point start = Clock::now();
+        writeFile(dir + "/back.png", "image " + to_string(i));
+        ok = ok && waitFor(reloads, i + 1, 2000);
+        latency += ms(reloads.at.back() - start);
+    }
+    printf("check one reload per write: %s (%zu for %d writes), %.1f ms from write to reload (settle %d ms)\n",
+           reloads.count() == writes ? "ok" : "FAILED", reloads.count(), writes, latency / writes, SETTLE_MS);
+    ok = ok && reloads.count() == writes;
+
+    // A burst of writes, as an editor saving in pieces, settles into one.
+    size_t before = reloads.count();
+    for (int i = 0; i < 20; i++) {
+        writeFile(dir + "/back.png", string(1000 * i, 'x'));
+        this_thread::sleep_for(chrono::milliseconds(2));
+    }
+    waitFor(reloads, before + 1, 2000);
+    this_thread::sleep_for(chrono::milliseconds(SETTLE_MS * 5));
+    bool burst = reloads.count() == before + 1;
+    printf("check burst of 20 writes gives one reload: %s\n", burst ? "ok" : "FAILED");
+
+    // Files that are not watched are ignored.
+    before = reloads.count();
+    writeFile(dir + "/other.png", "x");
+    this_thread::sleep_for(chrono::milliseconds(SETTLE_MS * 5));
+    bool ignored = reloads.count() == before;
+    printf("check unwatched file ignored: %s\n", ignored ? "ok" : "FAILED");
+
+    // Replaced by rename, the way levelc and most editors save, with a
+    // level large enough that compiling it takes a while.
+    before = reloads.count();
+    int side = 2048;
+    writeFile(dir + "/levels.txt.tmp", levelText(side));
+    Clock::time_point start = Clock::now();
+    rename((dir + "/levels.txt.tmp").c_str(), (dir + "/levels.txt").c_str());
+    bool renamed = waitFor(reloads, before + 1, 5000);
+    double compiled = ms(Clock::now() - start);
+    LevelCatalog live;
+    Clock::time_point swapStart = Clock::now();
+    {
+        lock_guard<mutex> lock(reloads.m);
+        renamed = renamed && reloads.pending && reloads.pending->count() == 1;
+        if (renamed) {
+            live.swap(*reloads.pending);
+            reloads.pending.reset();
+        }
+    }
+    double swapped = ms(Clock::now() - swapStart);
+    renamed = renamed && live.level(0).width == static_cast<uint32_t>(side) && live.wall(0, 3, 1);
+    printf("check levels.txt replaced by rename reloads: %s, %dx%d compiled on the watcher thread in %.1f ms, main thread swap %.4f ms\n",
+           renamed ? "ok" : "FAILED", side, side, compiled, swapped);
+
+    watcher.stop();
+    remove((dir + "/back.png").c_str());
+    remove((dir + "/other.png").c_str());
+    remove((dir + "/levels.txt").c_str());
+    rmdir(dir.c_str());
+    return ok && burst && ignored && renamed ? 0 : 1;
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "board.h"
+#include "maze.h"
+#include "obstacles.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+const int CHUNK_SIZE = 32;
+const int CHUNK_CELLS = CHUNK_SIZE * CHUNK_SIZE;
+
+// What ChunkWorld::cell() returns for a cell whose chunk is not loaded yet.
+const uint8_t CELL_UNLOADED = 0xFF;
+
+// One CHUNK_SIZE x CHUNK_SIZE square of the endless board, in CELL_* values.
+struct Chunk {
+    int cx = 0, cy = 0;
+    uint8_t blocked[CHUNK_CELLS];
+};
+
+inline uint64_t chunkKey(int cx, int cy) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cy)) << 32) | static_cast<uint32_t>(cx);
+}
+
+// Chunk contents depend only on the world seed and the chunk's coordinates.
+// The outer ring of every chunk is left open and each chunk is joined into
+// one region, so the whole world is connected; the chunk at (0, 0) is kept
+// empty to start in. The interior is one of the maze.h styles or an open
+// field with scattered rocks.
+inline void generateChunk(Chunk& chunk, uint64_t seed) {
+    Rng rng(seed ^ (chunkKey(chunk.cx, chunk.cy) * 0x9E3779B97F4A7C15ull));
+    rng.next();
+    Layout layout(CHUNK_SIZE, CHUNK_SIZE);
+    int kind = (chunk.cx == 0 && chunk.cy == 0) ? -1 : rng.below(4);
+    if (kind >= 0 && kind < MAZE_STYLES) {
+        static const float density[MAZE_STYLES] = { 0.3f, 0.3f, 0.6f };
+        Layout inner(CHUNK_SIZE - 2, CHUNK_SIZE - 2);
+        generateMaze(inner, static_cast<MazeStyle>(kind), density[kind], rng.next());
+        for (int y = 0; y < inner.height; y++) {
+            for (int x = 0; x < inner.width; x++) {
+                layout.blocked[layout.cell(x + 1, y + 1)] = inner.blocked[inner.cell(x, y)];
+            }
+        }
+    } else if (kind == MAZE_STYLES) {
+        for (int y = 1; y < CHUNK_SIZE - 1; y++) {
+            for (int x = 1; x < CHUNK_SIZE - 1; x++) {
+                layout.blocked[layout.cell(x, y)] = rng.below(100) < 4;
+            }
+        }
+    }
+    connectLayout(layout);
+    for (int c = 0; c < CHUNK_CELLS; c++) {
+        chunk.blocked[c] = layout.blocked[c] ? CELL_WALL : CELL_OPEN;
+    }
+}
+
+// Endless board made of chunks generated on demand by a pool of worker
+// threads. Only the main thread calls the public functions: request() queues
+// chunks, poll() picks up finished ones, cell() looks up what is loaded, and
+// evict() drops the farthest chunks once more than the budget is held. None
+// of them waits for a worker beyond a short queue lock, so a chunk that is
+// not ready yet reads as CELL_UNLOADED and the caller decides what to do.
+class ChunkWorld {
+public:
+    ~ChunkWorld() { stop(); }
+
+    void start(int workers) {
+        stop();
+        stopping_ = false;
+        for (int i = 0; i < workers; i++) {
+            threads_.emplace_back([this] { work(); });
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            jobs_.clear();
+        }
+        wake_.notify_all();
+        for (std::thread& t : threads_) {
+            t.join();
+        }
+        threads_.clear();
+    }
+
+    // Forgets every chunk and starts a new world. Chunks still being
+    // generated for the old seed are thrown away when they come back. The
+    // empty chunk at (0, 0), where a game starts, is made here, so the first
+    // food has somewhere to go before any worker has delivered.
+    void reset(uint64_t seed, size_t budgetBytes) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            seed_ = seed;
+            generation_++;
+            jobs_.clear();
+            done_.clear();
+        }
+        chunks_.clear();
+        pending_.clear();
+        cached_ = nullptr;
+        budget_ = budgetBytes / sizeof(Chunk);
+        if (budget_ < 1) budget_ = 1;
+        std::unique_ptr<Chunk> origin(new Chunk());
+        generateChunk(*origin, seed);
+        chunks_[chunkKey(0, 0)] = std::move(origin);
+    }
+
+    uint64_t seed() const { return seed_; }
+    size_t loaded() const { return chunks_.size(); }
+    size_t pending() const { return pending_.size(); }
+    size_t budget() const { return budget_; }
+
+    static int chunkOf(int cell) { return cell >= 0 ? cell / CHUNK_SIZE : (cell + 1) / CHUNK_SIZE - 1; }
+
+    const Chunk* find(int cx, int cy) const {
+        auto it = chunks_.find(chunkKey(cx, cy));
+        return it == chunks_.end() ? nullptr : it->second.get();
+    }
+
+    // CELL_OPEN, CELL_WALL or CELL_UNLOADED. The last chunk looked up is
+    // remembered, so walking along a chunk costs no hashing.
+    uint8_t cell(int x, int y) const {
+        int cx = chunkOf(x), cy = chunkOf(y);
+        if (cached_ == nullptr || cached_->cx != cx || cached_->cy != cy) {
+            cached_ = find(cx, cy);
+            if (cached_ == nullptr) {
+                return CELL_UNLOADED;
+            }
+        }
+        return cached_->blocked[(y - cy * CHUNK_SIZE) * CHUNK_SIZE + (x - cx * CHUNK_SIZE)];
+    }
+
+    // Queues every missing chunk within `radius` chunks of cell (x, y),
+    // nearest rings first.
+    void request(int x, int y, int radius) {
+        int ccx = chunkOf(x), ccy = chunkOf(y);
+        std::vector<uint64_t> wanted;
+        for (int r = 0; r <= radius; r++) {
+            for (int cy = ccy - r; cy <= ccy + r; cy++) {
+                for (int cx = ccx - r; cx <= ccx + r; cx++) {
+                    if (std::max(std::abs(cx - ccx), std::abs(cy - ccy)) != r) {
+                        continue;
+                    }
+                    uint64_t key = chunkKey(cx, cy);
+                    if (chunks_.count(key) == 0 && pending_.insert(key).second) {
+                        wanted.push_back(key);
+                    }
+                }
+            }
+        }
+        if (wanted.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (uint64_t key : wanted) {
+                jobs_.push_back({ key, generation_ });
+            }
+        }
+        wake_.notify_all();
+    }
+
+    // Moves finished chunks into the lookup table; returns how many arrived.
+    int poll() {
+        std::vector<Result> arrived;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            arrived.swap(done_);
+        }
+        int count = 0;
+        for (Result& r : arrived) {
+            if (r.generation != generation_) {
+                continue;
+            }
+            uint64_t key = chunkKey(r.chunk->cx, r.chunk->cy);
+            pending_.erase(key);
+            chunks_[key] = std::move(r.chunk);
+            count++;
+        }
+        return count;
+    }
+
+    // Drops the chunks farthest from cell (x, y) until the budget is met,
+    // never one within `keep` chunks of it. Dropped chunks are regenerated
+    // identically if they are needed again.
+    int evict(int x, int y, int keep) {
+        if (chunks_.size() <= budget_) {
+            return 0;
+        }
+        int ccx = chunkOf(x), ccy = chunkOf(y);
+        std::vector<std::pair<int, uint64_t>> far;
+        far.reserve(chunks_.size());
+        for (const auto& entry : chunks_) {
+            int d = std::max(std::abs(entry.second->cx - ccx), std::abs(entry.second->cy - ccy));
+            if (d > keep) {
+                far.push_back({ d, entry.first });
+            }
+        }
+        size_t excess = std::min(chunks_.size() - budget_, far.size());
+        std::nth_element(far.begin(), far.begin() + excess, far.end(),
+                         [](const std::pair<int, uint64_t>& a, const std::pair<int, uint64_t>& b) { return a.first > b.first; });
+        for (size_t i = 0; i < excess; i++) {
+            chunks_.erase(far[i].second);
+        }
+        cached_ = nullptr;
+        return static_cast<int>(excess);
+    }
+
+private:
+    struct Job {
+        uint64_t key;
+        uint64_t generation;
+    };
+    struct Result {
+        std::unique_ptr<Chunk> chunk;
+        uint64_t generation;
+    };
+
+    void work() {
+        for (;;) {
+            Job job;
+            uint64_t seed;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+                if (stopping_) {
+                    return;
+                }
+                job = jobs_.front();
+                jobs_.pop_front();
+                seed = seed_;
+            }
+            std::unique_ptr<Chunk> chunk(new Chunk());
+            chunk->cx = static_cast<int32_t>(static_cast<uint32_t>(job.key));
+            chunk->cy = static_cast<int32_t>(static_cast<uint32_t>(job.key >> 32));
+            generateChunk(*chunk, seed);
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_.push_back({ std::move(chunk), job.generation });
+        }
+    }
+
+    // Main thread only.
+    std::unordered_map<uint64_t, std::unique_ptr<Chunk>> chunks_;
+    std::unordered_set<uint64_t> pending_;
+    mutable const Chunk* cached_ = nullptr;
+    size_t budget_ = 1;
+
+    // Shared with the workers, under mutex_.
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<Job> jobs_;
+    std::vector<Result> done_;
+    uint64_t seed_ = 0;
+    uint64_t generation_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
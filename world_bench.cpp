@@ -0,0 +1,120 @@
+#include "board.h"
+#include "world.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static double ms(Clock::duration d) {
+    return chrono::duration<double, milli>(d).count();
+}
+
+// A block of chunks stitched into one layout must be one region, and a
+// chunk must come out the same every time it is generated.
+static bool check(uint64_t seed, int span) {
+    Layout layout(span * CHUNK_SIZE, span * CHUNK_SIZE);
+    bool same = true;
+    for (int cy = 0; cy < span; cy++) {
+        for (int cx = 0; cx < span; cx++) {
+            Chunk a, b;
+            a.cx = b.cx = cx - span / 2;
+            a.cy = b.cy = cy - span / 2;
+            generateChunk(a, seed);
+            generateChunk(b, seed);
+            same = same && memcmp(a.blocked, b.blocked, CHUNK_CELLS) == 0;
+            for (int y = 0; y < CHUNK_SIZE; y++) {
+                for (int x = 0; x < CHUNK_SIZE; x++) {
+                    layout.blocked[layout.cell(cx * CHUNK_SIZE + x, cy * CHUNK_SIZE + y)] = a.blocked[y * CHUNK_SIZE + x];
+                }
+            }
+        }
+    }
+    bool connected = layoutConnected(layout);
+    printf("check %dx%d chunks: %s, %s\n", span, span, connected ? "connected" : "DISCONNECTED", same ? "deterministic" : "NOT DETERMINISTIC");
+    return connected && same;
+}
+
+static void throughput(int workers, int span) {
+    ChunkWorld world;
+    world.start(workers);
+    world.reset(7, 1u << 30);
+    auto start = Clock::now();
+    world.request(0, 0, span);
+    // reset() has made chunk (0, 0) already.
+    int total = (2 * span + 1) * (2 * span + 1);
+    while (world.loaded() < static_cast<size_t>(total)) {
+        world.poll();
+        this_thread::yield();
+    }
+    double t = ms(Clock::now() - start);
+    printf("%2d workers: %5d chunks in %7.1f ms  (%6.1f us/chunk)\n", workers, total, t, t * 1000 / total);
+}
+
+// A head moving one cell per tick, turning now and then, with the same
+// per-tick calls the game makes, sleeping out the rest of each tick like the
+// game does. The tick period is far shorter than the game's 50-100 ms so the
+// workers are under real pressure.
+static bool walk(int workers, int ticks, double tickMs, int radius, size_t budgetBytes) {
+    ChunkWorld world;
+    world.start(workers);
+    world.reset(11, budgetBytes);
+    Rng rng(3);
+    int x = 16, y = 16, dir = 3, waits = 0;
+    static const int dx[4] = { 0, 0, -1, 1 };
+    static const int dy[4] = { -1, 1, 0, 0 };
+    double worst = 0, total = 0;
+    size_t peak = 0;
+    // The game starts its snake on chunk (0, 0), which reset() has made.
+    world.request(x, y, radius);
+    bool origin = world.find(0, 0) != nullptr;
+    auto next = Clock::now();
+    for (int t = 0; t < ticks; t++) {
+        next += chrono::duration_cast<Clock::duration>(chrono::duration<double, milli>(tickMs));
+        this_thread::sleep_until(next);
+        auto start = Clock::now();
+        world.poll();
+        world.request(x, y, radius);
+        world.evict(x, y, radius);
+        if (rng.below(8) == 0) {
+            dir = rng.below(4);
+        }
+        // Like the snake, turn away from walls; wait on unloaded cells.
+        int turns = 0;
+        uint8_t ahead = world.cell(x + dx[dir], y + dy[dir]);
+        while (ahead == CELL_WALL && turns++ < 4) {
+            dir = rng.below(4);
+            ahead = world.cell(x + dx[dir], y + dy[dir]);
+        }
+        if (ahead == CELL_UNLOADED) {
+            waits++;
+        } else if (ahead == CELL_OPEN) {
+            x += dx[dir];
+            y += dy[dir];
+        }
+        double cost = ms(Clock::now() - start);
+        worst = max(worst, cost);
+        total += cost;
+        peak = max(peak, world.loaded());
+    }
+    printf("%2d workers, radius %d, %.2f ms ticks: main thread %.4f ms/tick (worst %.3f), %d waits, peak %zu/%zu chunks, ended at (%d, %d)\n",
+           workers, radius, tickMs, total / ticks, worst, waits, peak, world.budget(), x, y);
+    return origin;
+}
+
+int main() {
+    bool ok = check(7, 8) && check(12345, 16);
+    int cores = max(1u, thread::hardware_concurrency());
+    throughput(1, 10);
+    throughput(cores, 10);
+    bool origin = walk(1, 5000, 1.0, 2, 64 * sizeof(Chunk));
+    origin = walk(cores, 20000, 0.2, 2, 64 * sizeof(Chunk)) && origin;
+    origin = walk(cores, 20000, 0.05, 3, 128 * sizeof(Chunk)) && origin;
+    printf("check the starting chunk is there straight after reset: %s\n", origin ? "ok" : "FAILED");
+    return ok && origin ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+#include "board.h"
+#include "bitboard.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static double seconds(Clock::time_point start) {
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Plain BFS over the wrapped or bounded board, to check the bitboard fill.
+static int bfsArea(const Layout& l, int start) {
+    if (l.blocked[start]) {
+        return 0;
+    }
+    vector<uint8_t> seen(l.cells(), 0);
+    vector<int> queue(1, start);
+    seen[start] = 1;
+    for (size_t i = 0; i < queue.size(); i++) {
+        for (Direction d : { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT }) {
+            int n = stepCell(l, queue[i], d);
+            if (n >= 0 && !l.blocked[n] && !seen[n]) {
+                seen[n] = 1;
+                queue.push_back(n);
+            }
+        }
+    }
+    return static_cast<int>(queue.size());
+}
+
+static bool check() {
+    bool ok = true;
+    for (int n = 1; n <= 70; n++) {
+        for (int c = -n; c < 2 * n; c++) {
+            ok = ok && wrapCoord(c, n) == ((c % n) + n) % n;
+        }
+    }
+    printf("check wrapCoord: %s\n", ok ? "ok" : "FAILED");
+
+    bool steps = true;
+    Layout l(40, 30);
+    l.wrap = true;
+    steps = steps && stepCell(l, l.cell(0, 5), Direction::LEFT) == l.cell(39, 5);
+    steps = steps && stepCell(l, l.cell(39, 5), Direction::RIGHT) == l.cell(0, 5);
+    steps = steps && stepCell(l, l.cell(7, 0), Direction::UP) == l.cell(7, 29);
+    steps = steps && stepCell(l, l.cell(7, 29), Direction::DOWN) == l.cell(7, 0);
+    for (int c = 0; c < l.cells(); c++) {
+        for (Direction d : { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT }) {
+            int n = stepCell(l, c, d);
+            steps = steps && n >= 0 && directionTo(l, c, n) == d && cellDistance(l, c, n) == 1;
+        }
+    }
+    printf("check wrapped steps, directions and distances: %s\n", steps ? "ok" : "FAILED");
+
+    bool fill = true;
+    Rng rng(3);
+    for (int size : { 40, 64, 100 }) {
+        for (int trial = 0; trial < 50; trial++) {
+            Layout w(size, size * 3 / 4);
+            w.wrap = true;
+            for (uint8_t& b : w.blocked) {
+                b = rng.below(100) < 35;
+            }
+            Bitboard open = openCells(w), reach;
+            int start = rng.below(w.cells());
+            fill = fill && reachableArea(open, start % w.width, start / w.width, reach, true) == bfsArea(w, start);
+        }
+    }
+    printf("check wrapped flood fill against BFS: %s\n", fill ? "ok" : "FAILED");
+    return ok && steps && fill;
+}
+
+// The same random (cell, direction) pairs stepped on a bounded and on a
+// wrapped board.
+static void benchStep(int width, int height) {
+    const int n = 1 << 20, passes = 50;
+    Rng rng(11);
+    vector<int> cells(n);
+    vector<Direction> dirs(n);
+    for (int i = 0; i < n; i++) {
+        cells[i] = rng.below(width * height);
+        dirs[i] = static_cast<Direction>(rng.below(4));
+    }
+    double t[2];
+    long long sum[2] = { 0, 0 };
+    for (int wrap = 0; wrap < 2; wrap++) {
+        Layout l(width, height);
+        l.wrap = wrap;
+        auto start = Clock::now();
+        for (int p = 0; p < passes; p++) {
+            for (int i = 0; i < n; i++) {
+                sum[wrap] += stepCell(l, cells[i], dirs[i]);
+            }
+        }
+        t[wrap] = seconds(start) * 1e9 / (static_cast<double>(n) * passes);
+    }
+    printf("stepCell %4dx%-4d: bounded %5.2f ns  wrapped %5.2f ns  (%lld %lld)\n", width, height, t[0], t[1], sum[0] % 1000, sum[1] % 1000);
+}
+
+// Random safe moves until the snake dies or boxes itself in; the wrapped
+// board runs much longer games, so compare the cost per move.
+static void benchGames(int width, int height, int games) {
+    double t[2];
+    long long moves[2] = { 0, 0 };
+    for (int wrap = 0; wrap < 2; wrap++) {
+        Layout l(width, height);
+        l.wrap = wrap;
+        Game g;
+        Rng rng(17);
+        auto start = Clock::now();
+        for (int i = 0; i < games; i++) {
+            g.reset(l, rng.next());
+            g.placeDefaultSnake();
+            g.spawnFood(false);
+            while (!g.over && g.moves < 20000) {
+                Direction safe[4];
+                int count = 0;
+                for (Direction d : { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT }) {
+                    if (g.isFree(stepCell(l, g.head(), d))) {
+                        safe[count++] = d;
+                    }
+                }
+                g.step(count ? safe[rng.below(count)] : g.direction);
+            }
+            moves[wrap] += g.moves;
+        }
+        t[wrap] = seconds(start) * 1e9 / moves[wrap];
+    }
+    printf("playouts %4dx%-4d: bounded %5.1f ns/move (%lld moves)  wrapped %5.1f ns/move (%lld moves)\n",
+           width, height, t[0], moves[0], t[1], moves[1]);
+}
+
+int main() {
+    bool ok = check();
+    benchStep(40, 30);
+    benchStep(2000, 1500);
+    benchGames(40, 30, 20000);
+    benchGames(400, 300, 2000);
+    return ok ? 0 : 1;
+}